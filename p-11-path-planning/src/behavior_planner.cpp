@@ -38,7 +38,7 @@ void Behavior::init() {
 }
 
 
-Behavior::lane Behavior::update_behavior_state(vector<double> trajectory, path *our_path) {
+Behavior::lane Behavior::update_behavior_state(const path::cycle_vector &trajectory, path *our_path) {
 
 	// check if in current maneuver
 	// cout << chrono::high_resolution_clock::to_time_t(State->lane_change_end_time) << endl;
@@ -69,10 +69,10 @@ Behavior::lane Behavior::update_behavior_state(vector<double> trajectory, path *
 }
 
 
-void Behavior::update_lane_costs(vector<double> trajectory, path *our_path) {
+void Behavior::update_lane_costs(const path::cycle_vector &trajectory, path *our_path) {
 
 	// Assign costs to lanes based on sensor data
-	vector<double> t_0, t_1, t_2;
+	path::cycle_vector t_0(cycle_arena), t_1(cycle_arena), t_2(cycle_arena);
 	t_0 = trajectory;
 	t_1 = trajectory;
 	t_2 = trajectory;
@@ -99,6 +99,7 @@ void Behavior::update_lane_costs(vector<double> trajectory, path *our_path) {
 	if (previous_id != 0) {
 		road->L[0].cost += 1 * our_path->collision_cost(t_0);
 		road->L[0].cost += 1 * our_path->buffer_cost(t_0);
+		road->L[0].cost += .5 * our_path->cut_in_cost(t_0);
 	}
 
 	//road->L[1].cost += our_path->buffer_cost_front(t_1);
@@ -107,6 +108,7 @@ void Behavior::update_lane_costs(vector<double> trajectory, path *our_path) {
 	if (previous_id != 1) {
 		road->L[1].cost += 1 * our_path->collision_cost(t_1);
 		road->L[1].cost += 1 * our_path->buffer_cost(t_1);
+		road->L[1].cost += .5 * our_path->cut_in_cost(t_1);
 	}
 
 	//road->L[2].cost +=  1 * our_path->buffer_cost(t_2);
@@ -114,6 +116,7 @@ void Behavior::update_lane_costs(vector<double> trajectory, path *our_path) {
 	if (previous_id != 2) {
 		road->L[2].cost += 1 * our_path->collision_cost(t_2);
 		road->L[2].cost += 1 * our_path->buffer_cost(t_2);
+		road->L[2].cost += .5 * our_path->cut_in_cost(t_2);
 	}
 
 	
@@ -34,9 +34,9 @@ public:
 	};
 
 	void init();
-	lane update_behavior_state(vector<double> trajectory, path *our_path);
+	lane update_behavior_state(const path::cycle_vector &trajectory, path *our_path);
 	void find_best_lane();
-	void update_lane_costs(vector<double> trajectory, path *our_path);
+	void update_lane_costs(const path::cycle_vector &trajectory, path *our_path);
 
 };
 
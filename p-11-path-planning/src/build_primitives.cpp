@@ -0,0 +1,43 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "primitive_library.h"
+
+/*
+Offline tool, writes the motion primitive table loaded by path::init().
+
+usage: build_primitives [output_file] [T_min T_max T_step]
+*/
+
+int main(int argc, char* argv[]) {
+
+	string file_name = "primitives.bin";
+	double T_min = Primitive_library::default_T_min;
+	double T_max = Primitive_library::default_T_max;
+	double T_step = Primitive_library::default_T_step;
+
+	if (argc > 1) {
+		file_name = argv[1];
+	}
+	if (argc > 4) {
+		T_min = atof(argv[2]);
+		T_max = atof(argv[3]);
+		T_step = atof(argv[4]);
+	}
+	if (T_step <= 0 || T_max < T_min) {
+		cerr << "Invalid T grid" << endl;
+		return -1;
+	}
+
+	Primitive_library library;
+	library.build(T_min, T_max, T_step);
+
+	if (!library.save(file_name)) {
+		cerr << "Failed to write " << file_name << endl;
+		return -1;
+	}
+
+	cout << "Wrote " << library.entries.size() << " primitives, T " << T_min << " to " << T_max
+		<< " step " << T_step << " -> " << file_name << endl;
+	return 0;
+}
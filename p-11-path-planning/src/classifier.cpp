@@ -84,6 +84,11 @@ void GNB::train(vector<vector<double>> data, vector<string> labels)
 	vector <vector<double> > data_variance;
 	data_variance.resize(3);
 
+	// all four features, for predict_batch()
+	double feature_sums[n_classes][n_features] = {};
+	double feature_squares[n_classes][n_features] = {};
+	vector<int> label_index(labels.size());
+
 	// refactored for all labels 
 	// TODO do more than first data element
 	for (size_t i = 0; i < len_labels; ++i) {
@@ -101,6 +106,10 @@ void GNB::train(vector<vector<double>> data, vector<string> labels)
 		data_sums[index] += data[i][3];
 		data_variance[index].push_back(data[i][3]);
 
+		for (size_t j = 0; j < n_features; ++j) {
+			feature_sums[index][j] += data[i][j];
+		}
+		label_index[i] = index;
 	}
 
 	cout << "Updating variables\n" << endl;
@@ -132,6 +141,32 @@ void GNB::train(vector<vector<double>> data, vector<string> labels)
 
 	}
 
+	// per feature variance and log space constants
+	for (size_t i = 0; i < len_labels; ++i) {
+		int index = label_index[i];
+		for (size_t j = 0; j < n_features; ++j) {
+			double difference = data[i][j] - feature_sums[index][j] / data_counts[index];
+			feature_squares[index][j] += difference * difference;
+		}
+	}
+
+	for (size_t i = 0; i < n_classes; ++i) {
+
+		log_norm_[i] = log(data_counts[i] / len_labels);
+		for (size_t j = 0; j < n_features; ++j) {
+
+			double mean = feature_sums[i][j] / data_counts[i];
+			double variance = feature_squares[i][j] / data_counts[i];
+
+			mean_[i][j] = mean;
+			inv_two_var_[i][j] = 1 / (2 * variance);
+			if (scored(j)) {
+				log_norm_[i] -= .5 * log(2 * M_PI * variance);
+			}
+		}
+	}
+	trained = len_labels > 0;
+
 }
 
 string GNB::predict(double observation)
@@ -188,4 +223,53 @@ string GNB::predict(double observation)
 
 	return this->possible_labels[winner];
 
-}
\ No newline at end of file
+}
+
+void GNB::predict_batch(const Features &features, vector<Maneuver> &labels)
+{
+	/*
+	Classifies every row of features in one pass.
+
+	Works in log space so each class is a sum of squared, pre scaled
+	distances to the class means, no sqrt / exp / pow per call.
+	Class is the outer loop so the inner loop runs over contiguous arrays.
+
+	labels is resized to features.size(), its storage is reused between frames.
+	*/
+
+	const size_t n = features.size();
+	const double *d = features.d.data();
+	const double *d_dot = features.d_dot.data();
+
+	for (size_t c = 0; c < n_classes; ++c) {
+
+		log_posteriors_[c].resize(n);
+		double *out = log_posteriors_[c].data();
+
+		const double norm = log_norm_[c];
+		const double m_1 = mean_[c][1], m_3 = mean_[c][3];
+		const double k_1 = inv_two_var_[c][1], k_3 = inv_two_var_[c][3];
+
+		for (size_t i = 0; i < n; ++i) {
+			double e_1 = d[i] - m_1;
+			double e_3 = d_dot[i] - m_3;
+			out[i] = norm - (e_1 * e_1 * k_1 + e_3 * e_3 * k_3);
+		}
+	}
+
+	labels.resize(n);
+	const double *left = log_posteriors_[LEFT].data();
+	const double *keep = log_posteriors_[KEEP].data();
+	const double *right = log_posteriors_[RIGHT].data();
+
+	for (size_t i = 0; i < n; ++i) {
+
+		// ties and non finite scores fall back to keep
+		Maneuver winner = KEEP;
+		double best = keep[i];
+		if (left[i] > best) { winner = LEFT; best = left[i]; }
+		if (right[i] > best) { winner = RIGHT; }
+		labels[i] = winner;
+	}
+
+}
@@ -19,11 +19,51 @@ public:
 	vector<string> possible_labels = { "left","keep","right" };
 	vector <vector <double> >results_;
 
+	// Labels returned by predict_batch(), same order as possible_labels
+	enum Maneuver { LEFT = 0, KEEP = 1, RIGHT = 2 };
+	static const int n_classes = 3;
+	static const int n_features = 4;
+
+	// Struct-of-arrays feature matrix, one row per tracked vehicle.
+	// Only d and d_dot: the training states' s is the position along a short
+	// stretch of road, 0 to about 47 m, and their s_dot about 10 m/s, both
+	// with the same mean for every class. They say nothing about the maneuver,
+	// and the highway's s (to about 6945 m) and speeds aren't in their frame,
+	// far off values would only pick the class with the widest variance.
+	struct Features {
+		vector<double> d;
+		vector<double> d_dot;
+
+		void clear() { d.clear(); d_dot.clear(); }
+		size_t size() const { return d.size(); }
+		void push_back(double d_, double d_dot_) {
+			d.push_back(d_);
+			d_dot.push_back(d_dot_);
+		}
+	};
+
+	bool trained = false;
+
+	// Training columns predict_batch() scores, see Features
+	static bool scored(int feature) { return feature == 1 || feature == 3; }
+
 	vector<vector<double> > load_state(string file_name);
 	vector<string> load_label(string file_name);
 
 	void train(vector<vector<double> > data, vector<string>  labels);
 	string predict(double obseravation);
+	void predict_batch(const Features &features, vector<Maneuver> &labels);
+
+private:
+
+	// Log space constants precomputed by train(), for all four training
+	// columns, s d s_dot d_dot
+	// log_norm_ = log(prior) - sum over d, d_dot of .5 * log(2 * pi * variance)
+	double log_norm_[n_classes];
+	double mean_[n_classes][n_features];
+	double inv_two_var_[n_classes][n_features];
+
+	vector<double> log_posteriors_[n_classes];  // scratch, reused across frames
 
 };
 
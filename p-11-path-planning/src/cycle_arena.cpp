@@ -0,0 +1,48 @@
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include <memory_resource>
+#include "cycle_arena.h"
+
+Cycle_arena::Cycle_arena(size_t initial_bytes) : block_(initial_bytes) {}
+
+Cycle_arena::~Cycle_arena() {
+	reset();
+}
+
+void Cycle_arena::reset() {
+
+	pmr::memory_resource *upstream = pmr::new_delete_resource();
+	for (size_t i = 0; i < overflow_.size(); ++i) {
+		upstream->deallocate(overflow_[i].p, overflow_[i].bytes, overflow_[i].alignment);
+	}
+	overflow_.clear();
+
+	// last cycle didn't fit, grow so the next one does
+	if (overflow_bytes_ > 0) {
+		size_t needed = offset_ + overflow_bytes_;
+		block_.resize(max(needed + needed / 2, 2 * block_.size()));
+		cout << "Cycle arena grown to " << block_.size() << " bytes" << endl;
+	}
+
+	overflow_bytes_ = 0;
+	offset_ = 0;
+}
+
+void *Cycle_arena::do_allocate(size_t bytes, size_t alignment) {
+
+	uintptr_t base = (uintptr_t)block_.data();
+	uintptr_t aligned = (base + offset_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	size_t end = aligned - base + bytes;
+
+	if (end <= block_.size()) {
+		offset_ = end;
+		return (void*)aligned;
+	}
+
+	// only until the next reset() grows the block
+	void *p = pmr::new_delete_resource()->allocate(bytes, alignment);
+	overflow_.push_back({ p, bytes, alignment });
+	overflow_bytes_ += bytes + alignment;
+	return p;
+}
@@ -0,0 +1,49 @@
+#ifndef CYCLE_ARENA_H
+#define CYCLE_ARENA_H
+#include <iostream>
+#include <vector>
+#include <memory_resource>
+
+using namespace std;
+
+/*
+Monotonic memory resource for one planning cycle.
+
+Allocations bump a pointer through one block, deallocate is a no-op and
+reset() at the start of the next cycle frees everything at once. If a cycle
+runs past the block the extra comes from the heap and the block is grown on
+the next reset(), so steady state cycles never reach malloc.
+
+Anything allocated from it must not outlive the cycle.
+*/
+
+class Cycle_arena : public pmr::memory_resource {
+public:
+
+	Cycle_arena(size_t initial_bytes);
+	virtual ~Cycle_arena();
+
+	void reset();
+
+	size_t used() const { return offset_; }
+	size_t capacity() const { return block_.size(); }
+
+private:
+
+	void *do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void *, size_t, size_t) override {}
+	bool do_is_equal(const pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+	vector<char> block_;
+	size_t offset_ = 0;
+
+	struct Overflow {
+		void *p;
+		size_t bytes;
+		size_t alignment;
+	};
+	vector<Overflow> overflow_;  // heap blocks taken this cycle, freed with the size and alignment they were taken with
+	size_t overflow_bytes_ = 0;
+};
+
+#endif
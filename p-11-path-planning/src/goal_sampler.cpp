@@ -0,0 +1,149 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <random>
+#include "goal_sampler.h"
+
+Goal_sampler::Goal_sampler() {}
+Goal_sampler::~Goal_sampler() {}
+
+static const int halton_primes[Goal_sampler::dimensions] = { 2, 3, 5, 7, 11, 13 };
+
+// Sobol direction numbers, Joe and Kuo, first 6 dimensions
+struct sobol_parameters { unsigned int s, a, m[4]; };
+static const sobol_parameters sobol_table[Goal_sampler::dimensions] = {
+	{ 0, 0, { 0, 0, 0, 0 } },  // van der Corput
+	{ 1, 0, { 1, 0, 0, 0 } },
+	{ 2, 1, { 1, 3, 0, 0 } },
+	{ 3, 1, { 1, 3, 1, 0 } },
+	{ 3, 2, { 1, 1, 1, 0 } },
+	{ 4, 1, { 1, 1, 3, 3 } },
+};
+
+static unsigned int sobol_directions[Goal_sampler::dimensions][32];
+static bool sobol_ready = false;
+
+static void init_sobol_directions() {
+
+	for (int k = 0; k < 32; ++k) {
+		sobol_directions[0][k] = 1u << (31 - k);
+	}
+	for (int d = 1; d < Goal_sampler::dimensions; ++d) {
+
+		const sobol_parameters &p = sobol_table[d];
+		unsigned int *v = sobol_directions[d];
+		for (unsigned int k = 0; k < 32; ++k) {
+			if (k < p.s) {
+				v[k] = p.m[k] << (31 - k);
+				continue;
+			}
+			v[k] = v[k - p.s] ^ (v[k - p.s] >> p.s);
+			for (unsigned int j = 1; j < p.s; ++j) {
+				if ((p.a >> (p.s - 1 - j)) & 1) {
+					v[k] ^= v[k - j];
+				}
+			}
+		}
+	}
+	sobol_ready = true;
+}
+
+double Goal_sampler::halton(unsigned int index, int dimension) {
+	// radical inverse of index in a prime base
+	const int base = halton_primes[dimension];
+	double f = 1.0, r = 0.0;
+	while (index > 0) {
+		f /= base;
+		r += f * (index % base);
+		index /= base;
+	}
+	return r;
+}
+
+unsigned int Goal_sampler::sobol(unsigned int index, int dimension) {
+	// 32 bit fraction, xor of the direction numbers of the set bits
+	unsigned int x = 0;
+	for (int k = 0; index > 0; ++k, index >>= 1) {
+		if (index & 1) { x ^= sobol_directions[dimension][k]; }
+	}
+	return x;
+}
+
+void Goal_sampler::begin_frame(int count, default_random_engine &generator) {
+
+	cursor_ = 0;
+	if (method == GAUSSIAN) { return; }
+	if (!sobol_ready) { init_sobol_directions(); }
+
+	// new scramble each frame so goals don't repeat between frames
+	uniform_real_distribution<double> uniform(0.0, 1.0);
+	uniform_int_distribution<unsigned int> bits;
+	for (int d = 0; d < dimensions; ++d) {
+		shift_[d] = uniform(generator);
+		digital_shift_[d] = bits(generator);
+	}
+
+	points_.resize(count * dimensions);
+	fill(0, count);
+}
+
+void Goal_sampler::fill(int from, int to) {
+
+	const double tiny = 1e-10;
+	for (int i = from; i < to; ++i) {
+		for (int d = 0; d < dimensions; ++d) {
+
+			double u;
+			if (method == SOBOL) {
+				u = ((sobol(i, d) ^ digital_shift_[d]) + .5) / 4294967296.0;
+			}
+			else {
+				u = halton(i + 1, d) + shift_[d];
+				if (u >= 1) { u -= 1; }
+			}
+			u = fmin(fmax(u, tiny), 1 - tiny);
+			points_[i * dimensions + d] = inverse_normal(u);
+		}
+	}
+}
+
+void Goal_sampler::next(double *z) {
+
+	int count = points_.size() / dimensions;
+	if (cursor_ >= count) {  // more goals than begin_frame() expected
+		points_.resize((cursor_ + 1) * dimensions);
+		fill(cursor_, cursor_ + 1);
+	}
+	for (int d = 0; d < dimensions; ++d) {
+		z[d] = points_[cursor_ * dimensions + d];
+	}
+	cursor_++;
+}
+
+double Goal_sampler::inverse_normal(double p) {
+	// Acklam's rational approximation, relative error < 1.2e-9
+	static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+		1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+	static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+		6.680131188771972e+01, -1.328068155288572e+01 };
+	static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+		-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+	static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+		3.754408661907416e+00 };
+	const double p_low = 0.02425;
+
+	if (p < p_low) {
+		double q = sqrt(-2 * log(p));
+		return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+			((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+	}
+	if (p > 1 - p_low) {
+		double q = sqrt(-2 * log(1 - p));
+		return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+			((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+	}
+	double q = p - .5;
+	double r = q * q;
+	return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+		(((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
@@ -0,0 +1,50 @@
+#ifndef GOAL_SAMPLER_H
+#define GOAL_SAMPLER_H
+#include <iostream>
+#include <vector>
+#include <random>
+
+using namespace std;
+
+/*
+Standard normal draws for path::wiggle_goal().
+
+GAUSSIAN is the original independent sampling. HALTON and SOBOL use a
+low discrepancy sequence over the 6 goal dimensions (s, s_dot, s_dot_dot,
+d, d_dot, d_dot_dot), scrambled per frame and mapped through the inverse
+normal CDF, so a few goals cover the target distribution evenly.
+*/
+
+class Goal_sampler {
+public:
+
+	Goal_sampler();
+	virtual ~Goal_sampler();
+
+	enum strategy { GAUSSIAN, HALTON, SOBOL };
+	static const int dimensions = 6;
+
+	strategy method = GAUSSIAN;
+
+	// Precompute the scrambled sequence for this frame's goals
+	void begin_frame(int count, default_random_engine &generator);
+
+	// Next standard normal point, z has dimensions entries
+	void next(double *z);
+
+	static double inverse_normal(double p);
+
+private:
+
+	void fill(int from, int to);
+	double halton(unsigned int index, int dimension);
+	unsigned int sobol(unsigned int index, int dimension);
+
+	vector<double> points_;  // count * dimensions, reused across frames
+	int cursor_ = 0;
+
+	double shift_[dimensions];           // Cranley-Patterson rotation, HALTON
+	unsigned int digital_shift_[dimensions];  // xor scramble, SOBOL
+};
+
+#endif
@@ -109,8 +109,6 @@ int main() {
 	// IF different version of uwebsockts replace all "ws" with "ws"!
 
 
-	path::X_Y X_Y_, X_Y_2;
-
 	h.onMessage([&](uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length, uWS::OpCode opCode) {
 
 		// "42" at the start of the message means there's a websocket message event.
@@ -160,7 +158,8 @@ int main() {
 
 						// cout <<  "time_difference " << time_difference << endl;
 
-						// 0. set clock for next round
+						// 0. set clock for next round, free last cycle's planner memory
+						path.begin_cycle();
 						path.behavior_time = chrono::high_resolution_clock::now();
 						path.sensor_fusion_predict_and_behavior(sensor_fusion, time_difference_b);
 
@@ -194,7 +193,7 @@ int main() {
 						//cout << "TIME 5 \t path.build_trajectory(trajectory) \t" << chrono::duration_cast<std::chrono::milliseconds>(chrono::high_resolution_clock::now() - path.start_time).count() << endl;
 
 						// 6. Convert to X and Y and append previous path
-						X_Y_ = path.convert_new_path_to_X_Y_and_merge(MAP, S_D_, Previous_path);
+						auto X_Y_ = path.convert_new_path_to_X_Y_and_merge(MAP, S_D_, Previous_path);
 
 						cout << "\nCycle time \t" << chrono::duration_cast<std::chrono::milliseconds>(chrono::high_resolution_clock::now() - path.start_time).count() << endl;
 
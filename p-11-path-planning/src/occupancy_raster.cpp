@@ -0,0 +1,103 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "occupancy_raster.h"
+
+Occupancy_raster::Occupancy_raster() {}
+Occupancy_raster::~Occupancy_raster() {}
+
+// band radii in multiples of Vehicle::radius, collision_band is collision_cost()'s 2 * radius
+static const double band_factor[Occupancy_raster::n_bands] = { .67, 1.33, 2, 2.67, 3.33, 4.33, 6, 8, 12 };
+
+void Occupancy_raster::reset(double s_min, double T, double radius) {
+
+	this->s_min = s_min;
+	this->T = T;
+	for (int k = 0; k < n_bands; ++k) {
+		band_radius[k] = band_factor[k] * radius;
+	}
+	margin = .5 * sqrt(s_cell * s_cell + d_cell * d_cell);
+
+	cells_.assign((size_t)n_t * n_s * n_layers, 0);
+}
+
+void Occupancy_raster::stamp_disk(int t_index, double s, double d, double radius, int layer) {
+	// a cell is set if its centre is inside the disk
+
+	int row_lo = max(0, (int)ceil((s - radius - s_min) / s_cell - .5));
+	int row_hi = min(n_s - 1, (int)floor((s + radius - s_min) / s_cell - .5));
+
+	for (int row = row_lo; row <= row_hi; ++row) {
+
+		double ds = s_min + (row + .5) * s_cell - s;
+		double w2 = radius * radius - ds * ds;
+		if (w2 < 0) { continue; }
+
+		double w = sqrt(w2);
+		int j_lo = max(0, (int)ceil((d - w - d_min) / d_cell - .5));
+		int j_hi = min(n_d - 1, (int)floor((d + w - d_min) / d_cell - .5));
+		if (j_lo > j_hi) { continue; }
+
+		uint32_t mask = (j_hi - j_lo == n_d - 1) ? 0xFFFFFFFFu : ((1u << (j_hi - j_lo + 1)) - 1) << j_lo;
+		cells_[((size_t)t_index * n_s + row) * n_layers + layer] |= mask;
+	}
+}
+
+void Occupancy_raster::stamp_bands(const vector<double> &S, const vector<double> &D) {
+
+	const double delta_time = T / n_t;
+	for (int index = 0; index < n_t; ++index) {
+
+		double t = delta_time * index;
+		double s = S[0] + (S[1] * t) + S[2] * (t * t) / 2.0;
+		double d = D[0] + (D[1] * t) + D[2] * (t * t) / 2.0;
+
+		for (int k = 0; k < n_bands; ++k) {
+			stamp_disk(index, s, d, band_radius[k] + margin, k);
+		}
+	}
+}
+
+void Occupancy_raster::stamp_layer(int layer, const vector<double> &S, const vector<double> &D, double radius) {
+
+	const double delta_time = T / n_t;
+	for (int index = 0; index < n_t; ++index) {
+
+		double t = delta_time * index;
+		double s = S[0] + (S[1] * t) + S[2] * (t * t) / 2.0;
+		double d = D[0] + (D[1] * t) + D[2] * (t * t) / 2.0;
+		stamp_disk(index, s, d, radius, layer);
+	}
+}
+
+int Occupancy_raster::hit(const double *trajectory, int first_layer, int last_layer) const {
+
+	const double *S = trajectory;
+	const double *D = trajectory + 6;
+	const double delta_time = trajectory[12] / n_t;
+	int best = last_layer + 1;
+
+	for (int index = 0; index < n_t; ++index) {
+
+		double t = delta_time * index;
+		double s = S[0] + t * (S[1] + t * (S[2] + t * (S[3] + t * (S[4] + t * S[5]))));
+		double d = D[0] + t * (D[1] + t * (D[2] + t * (D[3] + t * (D[4] + t * D[5]))));
+
+		double row_f = floor((s - s_min) / s_cell);
+		double col_f = floor((d - d_min) / d_cell);
+		if (!(row_f >= 0 && row_f < n_s && col_f >= 0 && col_f < n_d)) { return -1; }
+		int row = (int)row_f;
+		int col = (int)col_f;
+
+		const uint32_t *cell = &cells_[((size_t)index * n_s + row) * n_layers];
+		for (int k = first_layer; k < best; ++k) {
+			if ((cell[k] >> col) & 1) {
+				best = k;
+				break;
+			}
+		}
+		if (best == first_layer) { return best; }
+	}
+	return best;
+}
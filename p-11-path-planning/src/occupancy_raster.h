@@ -0,0 +1,68 @@
+#ifndef OCCUPANCY_RASTER_H
+#define OCCUPANCY_RASTER_H
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+/*
+Bit packed (s, d, t) occupancy of the other vehicles' predicted footprints.
+
+Time slices are the same T / 100 samples Vehicle::nearest_approach() uses,
+so a raster is only valid for trajectories with that T (trajectory[12]).
+One 32 bit word spans the road in d. Each (t, s) cell holds one word per
+layer, the layers sit next to each other so a lookup touches one cache line.
+
+Layers 0 .. n_bands - 1 are distance bands: a cell is set if any vehicle is
+within band_radius[k] + margin of its centre. margin is half a cell
+diagonal, so every point of the cell that is within band_radius[k] of a
+vehicle sets it: a sample that misses band k is at least band_radius[k]
+away, one that hits it may be up to band_radius[k] + 2 * margin away.
+Layer front_layer is the subset used by buffer_cost_front(), inflated by
+the caller.
+*/
+
+class Occupancy_raster {
+public:
+
+	Occupancy_raster();
+	virtual ~Occupancy_raster();
+
+	static const int n_t = 100;
+	static const int n_d = 32;
+	static const int n_bands = 9;
+	static const int collision_band = 2;
+	static const int front_layer = n_bands;
+	static const int n_layers = n_bands + 1;
+
+	double s_min;
+	double s_cell = .5;
+	int n_s = 600;
+	double d_min = -2;
+	double d_cell = .5;
+	double T = -1;
+
+	double band_radius[n_bands];
+	double margin;
+
+	// Clear and set the grid origin, radius is Vehicle::radius
+	void reset(double s_min, double T, double radius);
+
+	// Stamp a constant acceleration vehicle, same prediction as Vehicle::update_target_state()
+	void stamp_bands(const vector<double> &S, const vector<double> &D);
+	void stamp_layer(int layer, const vector<double> &S, const vector<double> &D, double radius);
+
+	// Smallest layer in [first_layer, last_layer] any sample lands in,
+	// last_layer + 1 if none, -1 if a sample leaves the raster.
+	// trajectory is path's 13 entry layout, S coefficients, D coefficients, T
+	int hit(const double *trajectory, int first_layer, int last_layer) const;
+
+private:
+
+	void stamp_disk(int t_index, double s, double d, double radius, int layer);
+
+	vector<uint32_t> cells_;  // [t][s][layer]
+};
+
+#endif
@@ -20,10 +20,18 @@ Behavior *behavior = new Behavior;
 
 Vehicle *r_daneel_olivaw = new Vehicle;  // our self driving car
 GNB		*classifier = new GNB;
+Primitive_library *primitives = new Primitive_library;
+Goal_sampler	*goal_sampler = new Goal_sampler;
+Occupancy_raster *occupancy = new Occupancy_raster;
+bool			occupancy_dirty = true;  // vehicles or our state changed since last build
+Cycle_arena		*cycle_arena = new Cycle_arena(1 << 18);  // grows to the largest cycle seen
 Vehicle *target = new Vehicle;
 path		*our_path = new path;
 
 map<int, Vehicle>				other_vehicles;
+GNB::Features					frame_features;  // reused every frame
+vector<GNB::Maneuver>			frame_maneuvers;
+vector<Vehicle*>				frame_vehicles;
 vector < path::Weighted_costs > weighted_costs;
 default_random_engine			generator;
 
@@ -38,13 +46,37 @@ void path::init() {
 
 	behavior->init();
 
-	//vector< vector<double> > X_train = classifier->load_state("./train_states.txt");
-	//vector< string > Y_train = classifier->load_label("./train_labels.txt");
-	//classifier->train(X_train, Y_train);
+	vector< vector<double> > X_train = classifier->load_state("./train_states.txt");
+	vector< string > Y_train = classifier->load_label("./train_labels.txt");
+	if (X_train.size() != 0 && X_train.size() == Y_train.size()) {
+		classifier->train(X_train, Y_train);
+
+		// cut_in_cost() acts on the predictions, so steady traffic in every lane has to come out as keep
+		GNB::Features steady;
+		vector<GNB::Maneuver> maneuvers;
+		for (double d : { 6 - 3.8, 6.0, 6 + 3.8 }) {  // Behavior::init()'s lane centres
+			steady.push_back(d, 0);
+		}
+		classifier->predict_batch(steady, maneuvers);
+		if (count(begin(maneuvers), end(maneuvers), GNB::KEEP) != (long)maneuvers.size()) {
+			cout << "Classifier doesn't predict keep for steady traffic, prediction disabled" << endl;
+			classifier->trained = false;
+		}
+	}
+	else {
+		cout << "No classifier training data, prediction disabled" << endl;
+	}
+
+	if (!primitives->load("./primitives.bin")) {
+		cout << "No primitives.bin, building motion primitives" << endl;
+		primitives->build(Primitive_library::default_T_min, Primitive_library::default_T_max,
+			Primitive_library::default_T_step);
+	}
 
 	our_path->timestep = .02;
 	our_path->T = 4;
 	our_path->trajectory_samples = 8;
+	our_path->goal_sampling = Goal_sampler::GAUSSIAN;  // SOBOL / HALTON need far fewer trajectory_samples
 	our_path->distance_goal = our_path->T * 8;
 	our_path->SIGMA_S = { 4., .1, .01 };
 	our_path->SIGMA_D = { .2, .1, .1 };
@@ -52,11 +84,21 @@ void path::init() {
 	our_path->ref_velocity = 0.0001;
 
 	our_path->previous_lane_target = 6;
+
+}
+
+void path::begin_cycle() {
+	// Free the last cycle's temporaries, call before any planning in this cycle
+	cycle_arena->reset();
 }
 
 void path::sensor_fusion_predict_and_behavior(vector< vector<double>> sensor_fusion, long long time_difference_b) {
 	// Store raw sensor_fusion observations and make a prediction 
 
+	frame_features.clear();
+	frame_vehicles.clear();
+	occupancy_dirty = true;
+
 	// 1. Update vehicles list
 	for (size_t i = 0; i < sensor_fusion.size(); ++i) {
 
@@ -75,12 +117,22 @@ void path::sensor_fusion_predict_and_behavior(vector< vector<double>> sensor_fus
 		// 3. Update new sensor readings
 		vehicle->update_sensor_fusion(sensor_fusion, i, time_difference_b);
 
-		// 4. Run classifier for prediction
-		//vehicle->predicted_state = classifier->predict(vehicle->D[1]);
+		// 4. Queue features for prediction, rates are per ms so scale to per second
+		frame_features.push_back(vehicle->D[0], vehicle->D[1] * 1000);
+		frame_vehicles.push_back(vehicle);
+	}
+
+	// 5. Run classifier for prediction, all vehicles at once
+	if (classifier->trained) {
+		classifier->predict_batch(frame_features, frame_maneuvers);
+		for (size_t i = 0; i < frame_vehicles.size(); ++i) {
+			frame_vehicles[i]->predicted_maneuver = frame_maneuvers[i];
+		}
 	}
 
 	if (our_path->last_trajectory.size() != 0) { // needed for last trajectory
-		auto lane = behavior->update_behavior_state(our_path->last_trajectory, our_path);
+		cycle_vector last_trajectory(begin(our_path->last_trajectory), end(our_path->last_trajectory), cycle_arena);
+		auto lane = behavior->update_behavior_state(last_trajectory, our_path);
 		our_path->current_lane_target = lane.d;
 		//cout << our_path->lane_change_state << endl;
 
@@ -113,6 +165,7 @@ void path::update_our_car_state(path::MAP *MAP, double car_x, double car_y, doub
 
 	r_daneel_olivaw->S[0] = car_s;
 	r_daneel_olivaw->D[0] = car_d;
+	occupancy_dirty = true;
 	//cout << "r_daneel_olivaw->S[0] \t " << r_daneel_olivaw->S[0] << endl;
 	//cout << "r_daneel_olivaw->S[1] \t "  << r_daneel_olivaw->S[1] << endl;
 	//cout << "r_daneel_olivaw->S[2] \t \n" << r_daneel_olivaw->S[2] << endl;
@@ -163,7 +216,8 @@ void path::update_our_car_state(path::MAP *MAP, double car_x, double car_y, doub
 	if (our_path->last_trajectory.size() != 0) {
 
 		// this should be in behavior planner?
-		if (our_path->buffer_cost_front(our_path->last_trajectory) == 1.0) {
+		cycle_vector last_trajectory(begin(our_path->last_trajectory), end(our_path->last_trajectory), cycle_arena);
+		if (our_path->buffer_cost_front(last_trajectory) == 1.0) {
 			
 			cout << "Slowing down for car in front " << endl;
 			target->S[0] = car_s + our_path->T * 5.5;
@@ -181,13 +235,13 @@ void path::update_our_car_state(path::MAP *MAP, double car_x, double car_y, doub
 }
 
 
-vector<double> path::trajectory_generation() {
+path::cycle_vector path::trajectory_generation() {
 	/****************************************
 	* find best trajectory according to weighted cost function
 	****************************************/
 
 	// 1. Generate random nearby goals
-	vector< vector<double>> goals;
+	pmr::vector< cycle_vector > goals(cycle_arena);
 
 	// first goal
 	goals.resize(1);
@@ -199,11 +253,14 @@ vector<double> path::trajectory_generation() {
 	goals[0].push_back(t);
 
 	// other goals
+	int t_steps = (int)((b - t) / our_path->timestep + 1.5);
+	goal_sampler->method = our_path->goal_sampling;
+	goal_sampler->begin_frame(t_steps * our_path->trajectory_samples, generator);
+
 	while (t <= b) {
 
 		target->update_target_state(t);
-		vector< vector<double>> target_goals;
-		vector<double> new_goal;
+		pmr::vector< cycle_vector > target_goals(cycle_arena);
 
 		//cout << "target->D[0]" << target->D[0] << endl;
 		target_goals.resize(our_path->trajectory_samples);
@@ -217,11 +274,16 @@ vector<double> path::trajectory_generation() {
 	}
 
 	// 2. Store jerk minimal trajectories for all goals
-	vector< vector<double>> trajectories;
+	pmr::vector< cycle_vector > trajectories(cycle_arena);
 	trajectories.resize(goals.size());
 
-	vector<double> s_goal, d_goal, s_coeffecients, d_coeffecients,
-		start_s, start_d;
+	// comfort features from the primitive library, when T is on its grid
+	pmr::vector< Primitive_library::comfort > comforts(goals.size(), cycle_arena);
+	pmr::vector< bool > has_comfort(goals.size(), false, cycle_arena);
+	const Primitive_library::entry *sample_entry = primitives->find(t);
+
+	cycle_vector s_goal(cycle_arena), d_goal(cycle_arena), s_coeffecients(cycle_arena), d_coeffecients(cycle_arena),
+		start_s(cycle_arena), start_d(cycle_arena);
 	double t_2;
 	start_s = { r_daneel_olivaw->S[0], r_daneel_olivaw->S[1], r_daneel_olivaw->S[2] };
 	start_d = { r_daneel_olivaw->D[0], r_daneel_olivaw->D[1], r_daneel_olivaw->D[2] };
@@ -232,41 +294,80 @@ vector<double> path::trajectory_generation() {
 		d_goal = { goals[i][3], goals[i][4], goals[i][5] };
 		t_2 = goals[i][6];
 
-		s_coeffecients = jerk_minimal_trajectory(start_s, s_goal, t_2);
-		d_coeffecients = jerk_minimal_trajectory(start_d, d_goal, t_2);
+		const Primitive_library::entry *solve_entry = primitives->find(t_2);
+		if (solve_entry != nullptr) {
+
+			// affine shift of the start state plus precomputed primitives, no solve
+			double s_c[Primitive_library::n_coefficients], d_c[Primitive_library::n_coefficients];
+			primitives->coefficients(*solve_entry, start_s.data(), s_goal.data(), s_c);
+			primitives->coefficients(*solve_entry, start_d.data(), d_goal.data(), d_c);
+
+			trajectories[i].insert(end(trajectories[i]), s_c, s_c + Primitive_library::n_coefficients);
+			trajectories[i].insert(end(trajectories[i]), d_c, d_c + Primitive_library::n_coefficients);
+
+			// costs sample over trajectory[12], ie t
+			if (sample_entry != nullptr) {
+				comforts[i] = primitives->features(*sample_entry, s_c);
+				has_comfort[i] = true;
+			}
+		}
+		else {
+			s_coeffecients = jerk_minimal_trajectory(start_s, s_goal, t_2);
+			d_coeffecients = jerk_minimal_trajectory(start_d, d_goal, t_2);
 
-		trajectories[i].insert(end(trajectories[i]), begin(s_coeffecients), end(s_coeffecients));
-		trajectories[i].insert(end(trajectories[i]), begin(d_coeffecients), end(d_coeffecients));
+			trajectories[i].insert(end(trajectories[i]), begin(s_coeffecients), end(s_coeffecients));
+			trajectories[i].insert(end(trajectories[i]), begin(d_coeffecients), end(d_coeffecients));
+		}
 		trajectories[i].push_back(t);
 	}
 
 	// 3. Find best using weighted cost function
 	double min_cost = 1e10;
 	double cost;
-	vector<double> best_trajectory;
+	size_t best = 0;
 	for (size_t i = 0; i < trajectories.size(); ++i) {
 
-		cost = calculate_cost(trajectories[i]);
+		if (has_comfort[i]) {
+			cost = calculate_cost(trajectories[i], comforts[i]);
+		}
+		else {
+			cost = calculate_cost(trajectories[i]);
+		}
 		if (cost < min_cost) {
 			min_cost = cost;
-			best_trajectory = trajectories[i];
+			best = i;
 		}
 		
 	}
+	const cycle_vector &best_trajectory = trajectories[best];
 
 	//cout << "Best trajectory cost: " << cost << endl;
-	our_path->last_trajectory = best_trajectory;
+	our_path->last_trajectory.assign(begin(best_trajectory), end(best_trajectory));
 	our_path->last_n_trajectories.resize(our_path->last_n_trajectories.size() + 1);
 	our_path->last_n_trajectories[our_path->last_n_trajectories.size() - 1].insert(end(our_path->last_n_trajectories[our_path->last_n_trajectories.size() -1]),
 		begin(best_trajectory), end(best_trajectory));
 	
-	return best_trajectory;
+	return cycle_vector(best_trajectory, cycle_arena);
 
 }
 
-vector<double> path::wiggle_goal(double t) {
+path::cycle_vector path::wiggle_goal(double t) {
+
+	cycle_vector new_goal(7, cycle_arena);
+
+	if (goal_sampler->method != Goal_sampler::GAUSSIAN) {
+
+		// low discrepancy point, already standard normal
+		double z[Goal_sampler::dimensions];
+		goal_sampler->next(z);
+		for (size_t i = 0; i < 3; ++i) {
+			new_goal[i] = target->S_TARGETS[i] + our_path->SIGMA_S[i] * z[i];
+			new_goal[i + 3] = target->D_TARGETS[i] + our_path->SIGMA_D[i] * z[i + 3];
+		}
+		new_goal[6] = t;
+		return new_goal;
+	}
 
-	vector<double> new_goal(7);
 	for (size_t i = 0; i < 3; ++i) {
 
 		normal_distribution<double> distribution(target->S_TARGETS[i], our_path->SIGMA_S[i]);
@@ -335,7 +436,7 @@ path::Previous_path path::merge_previous_path(path::MAP *MAP, vector< double> pr
 		//Previous_path.x1 = previous_path_x[1];
 		//Previous_path.y1 = previous_path_y[1];
 
-		vector<double> new_s_d = getFrenet(previous_path_x[p_x_size-1],
+		cycle_vector new_s_d = getFrenet(previous_path_x[p_x_size-1],
 			previous_path_y[p_x_size-1], car_yaw, MAP->waypoints_x_upsampled, MAP->waypoints_y_upsampled);
 
 		Previous_path.s = new_s_d[0];
@@ -358,24 +459,26 @@ path::Previous_path path::merge_previous_path(path::MAP *MAP, vector< double> pr
 
 }
 
-path::X_Y path::convert_new_path_to_X_Y_and_merge(path::MAP* MAP, path::S_D S_D_, path::Previous_path Previous_path) {
+path::X_Y path::convert_new_path_to_X_Y_and_merge(path::MAP* MAP, const path::S_D &S_D_, const path::Previous_path &Previous_path) {
 
 	path::X_Y X_Y, output_points;
 	X_Y.X = Previous_path.X;
 	X_Y.Y = Previous_path.Y;
 
 	auto yaw = Previous_path.yaw;
+	double x0 = Previous_path.x0;
+	double y0 = Previous_path.y0;
 
 	if (Previous_path.X.size() == 0) {  // init case
-		Previous_path.x0 = r_daneel_olivaw->x;
-		Previous_path.y0 = r_daneel_olivaw->y;
+		x0 = r_daneel_olivaw->x;
+		y0 = r_daneel_olivaw->y;
 	}
 	else {
 
 		for (size_t i = 0; i < 1; ++i) {
-			output_points.X.push_back(Previous_path.x0);
-			output_points.Y.push_back(Previous_path.y0);
-			// cout << "output -> x\t" << Previous_path.x0 << "\t y \t" << Previous_path.y0 << endl;
+			output_points.X.push_back(x0);
+			output_points.Y.push_back(y0);
+			// cout << "output -> x\t" << x0 << "\t y \t" << y0 << endl;
 		}
 	}
 
@@ -383,11 +486,11 @@ path::X_Y path::convert_new_path_to_X_Y_and_merge(path::MAP* MAP, path::S_D S_D_
 	int index = 10;
 	while (index < S_D_.S.size()) {
 
-		vector<double> a = getXY(S_D_.S[index], S_D_.D[index], MAP->waypoints_s_upsampled,
+		cycle_vector a = getXY(S_D_.S[index], S_D_.D[index], MAP->waypoints_s_upsampled,
 			MAP->waypoints_x_upsampled, MAP->waypoints_y_upsampled);
 
-		auto x_car_space = (a[0] - Previous_path.x0) * cos(0 - yaw) - (a[1] - Previous_path.y0) * sin(0 - yaw);
-		auto y_car_space = (a[0] - Previous_path.x0) * sin(0 - yaw) + (a[1] - Previous_path.y0) * cos(0 - yaw);
+		auto x_car_space = (a[0] - x0) * cos(0 - yaw) - (a[1] - y0) * sin(0 - yaw);
+		auto y_car_space = (a[0] - x0) * sin(0 - yaw) + (a[1] - y0) * cos(0 - yaw);
 
 		X_Y.X.push_back(x_car_space);
 		X_Y.Y.push_back(y_car_space);
@@ -404,8 +507,13 @@ path::X_Y path::convert_new_path_to_X_Y_and_merge(path::MAP* MAP, path::S_D S_D_
 	*/
 	
 	
+	// tk::spline only takes std::vector, keep its inputs across cycles so they stop reallocating
+	static vector<double> spline_x, spline_y;
+	spline_x.assign(begin(X_Y.X), end(X_Y.X));
+	spline_y.assign(begin(X_Y.Y), end(X_Y.Y));
+
 	tk::spline spline_xy;
-	spline_xy.set_points(X_Y.X, X_Y.Y);
+	spline_xy.set_points(spline_x, spline_y);
 
 	//cout << "Spline created " << endl;
 	double target_x = 30	;   
@@ -504,8 +612,8 @@ path::X_Y path::convert_new_path_to_X_Y_and_merge(path::MAP* MAP, path::S_D S_D_
 		x_point = x * cos(yaw) - y * sin(yaw);
 		y_point = x * sin(yaw) + y * cos(yaw);
 
-		x_point += Previous_path.x0;  // referance x
-		y_point += Previous_path.y0;
+		x_point += x0;  // referance x
+		y_point += y0;
 
 		//cout << "output -> x\t" << x_point << "\t y \t" << y_point << endl;
 
@@ -527,9 +635,9 @@ path::X_Y path::convert_new_path_to_X_Y_and_merge(path::MAP* MAP, path::S_D S_D_
 
 
 
-path::S_D  path::build_trajectory(vector<double> trajectory, long long build_trajectory_time) {
+path::S_D  path::build_trajectory(const cycle_vector &trajectory, long long build_trajectory_time) {
 
-	vector<double> S, D, X, Y; // TODO refactor using S_D struct
+	cycle_vector S(cycle_arena), D(cycle_arena); // TODO refactor using S_D struct
 	S_D S_D_;
 
 
@@ -584,7 +692,7 @@ path::S_D  path::build_trajectory(vector<double> trajectory, long long build_tra
 * Cost functions
 ****************************************/
 
-double path::calculate_cost(vector<double> trajectory) {
+double path::calculate_cost(const cycle_vector &trajectory) {
 	double cost = 0;
 
 	cost += 1 * collision_cost(trajectory);
@@ -602,7 +710,50 @@ double path::calculate_cost(vector<double> trajectory) {
 	return cost;
 }
 
-double path::buffer_cost(vector<double> trajectory) {
+double path::calculate_cost(const cycle_vector &trajectory, Primitive_library::comfort comfort) {
+	// Same as calculate_cost() with the comfort terms taken from the primitive library
+	double cost = 0;
+
+	cost += 1 * collision_cost(trajectory);
+	cost += 1 * total_acceleration_cost(trajectory);
+	cost += .2 * efficiency_cost(trajectory);
+	cost += .5 * buffer_cost(trajectory);
+	cost += .2 * s_diff_cost(trajectory);
+	cost += .2 * d_diff_cost(trajectory);
+	cost += comfort_cost(comfort, trajectory[12]);
+
+	return cost;
+}
+
+double path::comfort_cost(Primitive_library::comfort comfort, double T) {
+	// max_acceleration_cost() + total_jerk_cost() + max_jerk_cost(), weight 1 each
+	double max_acceleration = 8;
+	double expected_jerk_1_second = .1;
+	double max_jerk = 1;
+	double cost = 0;
+
+	if (comfort.max_acceleration > max_acceleration) { cost += 1; }
+	cost += logistic(comfort.integrated_jerk / T / expected_jerk_1_second);
+	if (comfort.max_jerk > max_jerk) { cost += 1; }
+
+	return cost;
+}
+
+double path::buffer_cost(const cycle_vector &trajectory) {
+
+	int band = occupancy_for(trajectory)->hit(trajectory.data(), 0, Occupancy_raster::n_bands - 1);
+	if (band >= 0) {
+		// nearest approach taken as the middle of its band, past the last band use twice its radius
+		double nearest;
+		if (band == Occupancy_raster::n_bands) {
+			nearest = 2 * occupancy->band_radius[band - 1];
+		}
+		else {
+			double inner = band > 0 ? occupancy->band_radius[band - 1] : 0;
+			nearest = (inner + occupancy->band_radius[band]) / 2;
+		}
+		return logistic(3 * r_daneel_olivaw->radius / nearest);
+	}
 
 	double nearest = nearest_approach_to_any_vehicle(trajectory);
 	double cost = logistic(3 * r_daneel_olivaw->radius / nearest);
@@ -610,9 +761,9 @@ double path::buffer_cost(vector<double> trajectory) {
 
 }
 
-double path::s_diff_cost(vector<double> trajectory) {
+double path::s_diff_cost(const cycle_vector &trajectory) {
 
-	vector<double> S, S_coefficients; // TODO better way to do this
+	cycle_vector S(cycle_arena), S_coefficients(cycle_arena); // TODO better way to do this
 	S = { trajectory[0], trajectory[1], trajectory[2], trajectory[3], trajectory[4], trajectory[5] };
 	double T = trajectory[12];
 	double cost = 0;
@@ -631,9 +782,9 @@ double path::s_diff_cost(vector<double> trajectory) {
 
 }
 
-vector<double> path::get_ceoef_and_rates_of_change(vector<double> coefficients) {
+path::cycle_vector path::get_ceoef_and_rates_of_change(const cycle_vector &coefficients) {
 
-	vector<double> coefficients_d, out;
+	cycle_vector coefficients_d(cycle_arena), out(cycle_arena);
 	double a;
 
 	out.push_back(coefficients_to_time_function(coefficients, 2));
@@ -647,9 +798,9 @@ vector<double> path::get_ceoef_and_rates_of_change(vector<double> coefficients)
 	return out;
 }
 
-double path::d_diff_cost(vector<double> trajectory) {
+double path::d_diff_cost(const cycle_vector &trajectory) {
 
-	vector<double> D, D_coefficients; // TODO better way to do this
+	cycle_vector D(cycle_arena), D_coefficients(cycle_arena); // TODO better way to do this
 	D = { trajectory[6], trajectory[7], trajectory[8], trajectory[9], trajectory[10], trajectory[11] };
 	double T = trajectory[12];
 	double cost = 0;
@@ -668,9 +819,9 @@ double path::d_diff_cost(vector<double> trajectory) {
 
 }
 
-double path::total_jerk_cost(vector<double> trajectory) {
+double path::total_jerk_cost(const cycle_vector &trajectory) {
 
-	vector<double> S, S_dot_coefficients, S_dot_dot_coeffecients, jerk;
+	cycle_vector S(cycle_arena), S_dot_coefficients(cycle_arena), S_dot_dot_coeffecients(cycle_arena), jerk(cycle_arena);
 	S = { trajectory[0], trajectory[1], trajectory[2], trajectory[3], trajectory[4], trajectory[5] };
 
 	double T = trajectory[12];
@@ -698,9 +849,9 @@ double path::total_jerk_cost(vector<double> trajectory) {
 	return cost;
 }
 
-double path::max_jerk_cost(vector<double> trajectory) {
+double path::max_jerk_cost(const cycle_vector &trajectory) {
 
-	vector<double> S, S_dot_coefficients, S_dot_dot_coeffecients, jerk, all_jerks;
+	cycle_vector S(cycle_arena), S_dot_coefficients(cycle_arena), S_dot_dot_coeffecients(cycle_arena), jerk(cycle_arena), all_jerks(cycle_arena);
 	S = { trajectory[0], trajectory[1], trajectory[2], trajectory[3], trajectory[4], trajectory[5] };
 
 	double T = trajectory[12];
@@ -732,9 +883,9 @@ double path::max_jerk_cost(vector<double> trajectory) {
 	}
 }
 
-double path::max_acceleration_cost(vector<double> trajectory) {
+double path::max_acceleration_cost(const cycle_vector &trajectory) {
 
-	vector<double> S, S_dot_coefficients, S_dot_dot_coeffecients, all_accelerations;
+	cycle_vector S(cycle_arena), S_dot_coefficients(cycle_arena), S_dot_dot_coeffecients(cycle_arena), all_accelerations(cycle_arena);
 	S = { trajectory[0], trajectory[1], trajectory[2], trajectory[3], trajectory[4], trajectory[5] };
 
 	double t_ = trajectory[12];
@@ -767,9 +918,9 @@ double path::max_acceleration_cost(vector<double> trajectory) {
 
 }
 
-double path::total_acceleration_cost(vector<double> trajectory) {
+double path::total_acceleration_cost(const cycle_vector &trajectory) {
 
-	vector<double> S, S_dot_coefficients, S_dot_dot_coeffecients;
+	cycle_vector S(cycle_arena), S_dot_coefficients(cycle_arena), S_dot_dot_coeffecients(cycle_arena);
 	S = { trajectory[0], trajectory[1], trajectory[2], trajectory[3], trajectory[4], trajectory[5] };
 
 	const double T_ = trajectory[12];
@@ -795,8 +946,8 @@ double path::total_acceleration_cost(vector<double> trajectory) {
 
 }
 
-double path::speed_limit_cost(vector<double> trajectory) {
-	vector<double> S;
+double path::speed_limit_cost(const cycle_vector &trajectory) {
+	cycle_vector S(cycle_arena);
 	S = { trajectory[0], trajectory[1], trajectory[2], trajectory[3], trajectory[4], trajectory[5] };
 	const double T_ = trajectory[12];
 
@@ -817,7 +968,17 @@ double path::speed_limit_cost(vector<double> trajectory) {
 }
 
 
-double path::collision_cost(vector<double> trajectory) {
+double path::collision_cost(const cycle_vector &trajectory) {
+
+	// Missing the collision band is a miss. A hit in a band below it is a hit,
+	// its radius plus twice the margin is still under 2 * radius. The collision
+	// band itself may be up to a cell diagonal too wide, so check those exactly
+	int band = occupancy_for(trajectory)->hit(trajectory.data(), 0, Occupancy_raster::collision_band);
+	if (band > Occupancy_raster::collision_band) { return 0.0; }
+	if (band >= 0 && band < Occupancy_raster::collision_band &&
+		occupancy->band_radius[band] + 2 * occupancy->margin < 2 * r_daneel_olivaw->radius) {
+		return 1.0;
+	}
 
 	double a = nearest_approach_to_any_vehicle(trajectory);
 
@@ -831,7 +992,12 @@ double path::collision_cost(vector<double> trajectory) {
 }
 
 
-double path::buffer_cost_front(vector<double> trajectory) {
+double path::buffer_cost_front(const cycle_vector &trajectory) {
+
+	// Missing the front layer is a miss. It is stamped up to a cell diagonal
+	// wider than .25, so a hit only means the exact check is needed
+	int layer = occupancy_for(trajectory)->hit(trajectory.data(), Occupancy_raster::front_layer, Occupancy_raster::front_layer);
+	if (layer > Occupancy_raster::front_layer) { return 0.0; }
 
 	double a = nearest_approach_to_vehicle_in_front(trajectory);
 	double b = .25;
@@ -843,8 +1009,30 @@ double path::buffer_cost_front(vector<double> trajectory) {
 	else { return 0.0; }
 }
 
-double path::stay_in_lane(vector<double> trajectory){
-	vector<double> D;
+double path::cut_in_cost(const cycle_vector &trajectory) {
+	// Vehicles alongside or just ahead that the classifier expects to change
+	// into the target lane, LEFT toward smaller d, RIGHT toward larger
+
+	const double lane_width = 4;
+	double cut_ins = 0;
+	for (auto it = other_vehicles.begin(); it != other_vehicles.end(); ++it) {
+
+		const Vehicle &vehicle = it->second;
+		if (vehicle.predicted_maneuver == GNB::KEEP) { continue; }
+
+		double ds = vehicle.sf_s - r_daneel_olivaw->S[0];
+		if (ds < -10 || ds > 40) { continue; }
+
+		double d_next = vehicle.sf_d + (vehicle.predicted_maneuver == GNB::LEFT ? -lane_width : lane_width);
+		if (fabs(d_next - trajectory[6]) < lane_width / 2) {
+			cut_ins += 10 / max(10.0, fabs(ds));
+		}
+	}
+	return logistic(cut_ins);
+}
+
+double path::stay_in_lane(const cycle_vector &trajectory){
+	cycle_vector D(cycle_arena);
 	D = { trajectory[6], trajectory[7], trajectory[8], trajectory[9], trajectory[10], trajectory[11] };
 	const double T_ = trajectory[12];
 	const double delta_time = T_ / (our_path->T / our_path->timestep);
@@ -867,7 +1055,7 @@ double path::stay_in_lane(vector<double> trajectory){
 }
 
 
-double path::nearest_approach_to_any_vehicle(vector<double> trajectory) {
+double path::nearest_approach_to_any_vehicle(const cycle_vector &trajectory) {
 	// returns closest distance to any vehicle
 
 	double a = 1e9;
@@ -880,7 +1068,35 @@ double path::nearest_approach_to_any_vehicle(vector<double> trajectory) {
 
 }
 
-double path::nearest_approach_to_vehicle_in_front(vector<double> trajectory) {
+Occupancy_raster *path::occupancy_for(const cycle_vector &trajectory) {
+	// Rebuild once per frame, or when a trajectory with a different T is checked
+
+	double T_ = trajectory[12];
+	if (!occupancy_dirty && occupancy->T == T_) {
+		return occupancy;
+	}
+
+	occupancy->reset(r_daneel_olivaw->S[0] - 50, T_, r_daneel_olivaw->radius);
+
+	for (auto it = other_vehicles.begin(); it != other_vehicles.end(); ++it) {
+
+		Vehicle &vehicle = it->second;
+		occupancy->stamp_bands(vehicle.S, vehicle.D);
+
+		// same selection as nearest_approach_to_vehicle_in_front(), .25 is below the cell size so
+		// inflate by half a cell diagonal to never miss a car in front, buffer_cost_front() checks hits exactly
+		if (vehicle.sf_s > r_daneel_olivaw->S[0] &&
+			vehicle.sf_d < r_daneel_olivaw->D[0] + 2 && vehicle.sf_d > r_daneel_olivaw->D[0] - 2) {
+			occupancy->stamp_layer(Occupancy_raster::front_layer, vehicle.S, vehicle.D,
+				.25 + .5 * sqrt(occupancy->s_cell * occupancy->s_cell + occupancy->d_cell * occupancy->d_cell));
+		}
+	}
+
+	occupancy_dirty = false;
+	return occupancy;
+}
+
+double path::nearest_approach_to_vehicle_in_front(const cycle_vector &trajectory) {
 	// returns closest distance to any vehicle
 
 	double a = 1e9;
@@ -904,13 +1120,13 @@ double path::nearest_approach_to_vehicle_in_front(vector<double> trajectory) {
 
 }
 
-double Vehicle::nearest_approach(vector<double> trajectory, Vehicle vehicle) {
+double Vehicle::nearest_approach(const cycle_vector &trajectory, Vehicle &vehicle) {
 
 	double T_, s_time, d_time, a, b, c, e, t_;
 	a = 1e9;
 	T_ = trajectory[12];
 
-	vector<double> S, D; // TODO better way to do this
+	cycle_vector S(cycle_arena), D(cycle_arena); // TODO better way to do this
 	S = { trajectory[0], trajectory[1], trajectory[2], trajectory[3], trajectory[4], trajectory[5] };
 	D = { trajectory[6], trajectory[7], trajectory[8], trajectory[9], trajectory[10], trajectory[11] };
 
@@ -936,9 +1152,9 @@ double Vehicle::nearest_approach(vector<double> trajectory, Vehicle vehicle) {
 	return a;
 }
 
-double path::efficiency_cost(vector<double> trajectory) {
+double path::efficiency_cost(const cycle_vector &trajectory) {
 	
-	vector<double> S;
+	cycle_vector S(cycle_arena);
 	S = { trajectory[0], trajectory[1], trajectory[2], trajectory[3], trajectory[4], trajectory[5] };
 	double T_ = trajectory[12];
 
@@ -951,9 +1167,9 @@ double path::efficiency_cost(vector<double> trajectory) {
 
 }
 
-vector<double> path::differentiate_polynomial(vector<double> coefficients) {
+path::cycle_vector path::differentiate_polynomial(const cycle_vector &coefficients) {
 	// given a vector of coefficients, returns 
-	vector<double> out;
+	cycle_vector out(cycle_arena);
 	int next_degree;
 	double result;
 
@@ -969,7 +1185,7 @@ double path::logistic(double x) {
 	return 2.0 / (1 + exp(-x)) - 1.0;
 }
 
-double path::coefficients_to_time_function(vector<double> coefficients, double t) {
+double path::coefficients_to_time_function(const cycle_vector &coefficients, double t) {
 	// Returns a function of time given coefficients
 	double total = 0.0;
 	for (size_t i = 0; i < coefficients.size(); ++i) {
@@ -978,7 +1194,7 @@ double path::coefficients_to_time_function(vector<double> coefficients, double t
 	return total;
 }
 
-vector<double> path::jerk_minimal_trajectory(vector< double> start, vector <double> end, double T)
+path::cycle_vector path::jerk_minimal_trajectory(const cycle_vector &start, const cycle_vector &end, double T)
 {
 	/*
 	Calculate the Jerk Minimizing Trajectory that connects the initial state
@@ -1016,27 +1232,29 @@ vector<double> path::jerk_minimal_trajectory(vector< double> start, vector <doub
 	const double s_r_2 = s_f_dot - (s_i_dot + s_i_dot_dot * T);
 	const double s_r_3 = s_f_dot_dot - s_i_dot_dot;
 
-	VectorXd t_1(3), t_2(3), t_3(3);
+	// fixed size so the solve stays off the heap
+	Eigen::RowVector3d t_1, t_2, t_3;
 	t_1 << pow(T, 3), pow(T, 4), pow(T, 5);
 	t_2 << 3 * pow(T, 2), 4 * pow(T, 3), 5 * pow(T, 4);
 	t_3 << 6 * pow(T, 1), 12 * pow(T, 2), 20 * pow(T, 3);
 
-	MatrixXd s_matrix(3, 1), T_matrix(3, 3);
+	Eigen::Vector3d s_matrix;
+	Eigen::Matrix3d T_matrix;
 	s_matrix << s_r_1, s_r_2, s_r_3;
 	T_matrix.row(0) = t_1;
 	T_matrix.row(1) = t_2;
 	T_matrix.row(2) = t_3;
 
-	MatrixXd T_inverse = T_matrix.inverse();
+	Eigen::Matrix3d T_inverse = T_matrix.inverse();
 
-	MatrixXd output(3, 1);
+	Eigen::Vector3d output;
 	output = T_inverse * s_matrix;
 
 	double a_3 = double(output.data()[0]);
 	double a_4 = double(output.data()[1]);
 	double a_5 = double(output.data()[2]);
 
-	vector<double> results;
+	cycle_vector results(cycle_arena);
 	results = { s_i, s_i_dot, s_i_dot_dot, a_3, a_4, a_5 };
 
 	// cout << output << endl;
@@ -1046,7 +1264,7 @@ vector<double> path::jerk_minimal_trajectory(vector< double> start, vector <doub
 }
 
 // Transform from Cartesian x,y coordinates to Frenet s,d coordinates
-vector<double> path::getFrenet(double x, double y, double theta, vector<double> maps_x, vector<double> maps_y)
+path::cycle_vector path::getFrenet(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y)
 {
 	int next_wp = NextWaypoint(x, y, theta, maps_x, maps_y);
 
@@ -1090,12 +1308,12 @@ vector<double> path::getFrenet(double x, double y, double theta, vector<double>
 
 	frenet_s += distance(0, 0, proj_x, proj_y);
 
-	return { frenet_s,frenet_d };
+	return cycle_vector({ frenet_s,frenet_d }, cycle_arena);
 
 }
 
 // Transform from Frenet s,d coordinates to Cartesian x,y
-vector<double> path::getXY(double s, double d, vector<double> maps_s, vector<double> maps_x, vector<double> maps_y)
+path::cycle_vector path::getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y)
 {
 	int prev_wp = -1;
 
@@ -1118,7 +1336,7 @@ vector<double> path::getXY(double s, double d, vector<double> maps_s, vector<dou
 	double x = seg_x + d*cos(perp_heading);
 	double y = seg_y + d*sin(perp_heading);
 
-	return { x,y };
+	return cycle_vector({ x,y }, cycle_arena);
 
 }
 
@@ -1126,7 +1344,7 @@ double path::distance(double x1, double y1, double x2, double y2)
 {
 	return sqrt((x2 - x1)*(x2 - x1) + (y2 - y1)*(y2 - y1));
 }
-int path::ClosestWaypoint(double x, double y, vector<double> maps_x, vector<double> maps_y)
+int path::ClosestWaypoint(double x, double y, const vector<double> &maps_x, const vector<double> &maps_y)
 {
 
 	double closestLen = 100000; //large number
@@ -1148,7 +1366,7 @@ int path::ClosestWaypoint(double x, double y, vector<double> maps_x, vector<doub
 }
 
 
-int path::NextWaypoint(double x, double y, double theta, vector<double> maps_x, vector<double> maps_y)
+int path::NextWaypoint(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y)
 {
 
 	int closestWaypoint = ClosestWaypoint(x, y, maps_x, maps_y);
@@ -6,15 +6,27 @@
 #include <vector>
 #include <ctime>
 #include <queue>
+#include <memory_resource>
+#include "classifier.h"
+#include "primitive_library.h"
+#include "goal_sampler.h"
+#include "occupancy_raster.h"
+#include "cycle_arena.h"
 
 using namespace std;
 
+// Planner temporaries are allocated from this, see path::cycle_vector
+extern Cycle_arena *cycle_arena;
+
 class path {
 public:
 
 	path();
 	virtual ~path();
 
+	// Planner temporaries live in the cycle arena, pass cycle_arena to every one constructed,
+	// they are freed all at once by begin_cycle(), don't keep one across cycles
+	typedef pmr::vector<double> cycle_vector;
 
 	
 	// Data structures
@@ -23,16 +35,16 @@ public:
 		// function
 	};
 	struct X_Y {
-		vector<double> X;
-		vector<double> Y;
+		cycle_vector X{ cycle_arena };
+		cycle_vector Y{ cycle_arena };
 	};
 	struct S_D {
-		vector<double> S;
-		vector<double> D;
+		cycle_vector S{ cycle_arena };
+		cycle_vector D{ cycle_arena };
 	};
 	struct Previous_path {
-		vector<double> X;
-		vector<double> Y;
+		cycle_vector X{ cycle_arena };
+		cycle_vector Y{ cycle_arena };
 		double s;
 		double d;
 		double yaw;
@@ -64,6 +76,7 @@ public:
 	double T;
 	double distance_goal;
 	int trajectory_samples;
+	Goal_sampler::strategy goal_sampling;
 	double previous_lane_target;
 	bool lane_change_state;
 
@@ -71,46 +84,51 @@ public:
 	vector<double> SIGMA_S, SIGMA_D;
 
 	// Cost functions
-	double calculate_cost(vector<double> trajectory);
-	double efficiency_cost(vector<double> trajectory);
-	double collision_cost(vector<double> trajectory);
-	double d_diff_cost(vector<double> trajectory);
-	double max_acceleration_cost(vector<double> trajectory);
-	double total_acceleration_cost(vector<double> trajectory);
-	double total_jerk_cost(vector<double> trajectory);
-	double buffer_cost(vector<double> trajectory);
-	double s_diff_cost(vector<double> trajectory);
-	double speed_limit_cost(vector<double> trajectory);
-	double max_jerk_cost(vector<double> trajectory);
-	double stay_in_lane(vector<double> trajectory);
+	double calculate_cost(const cycle_vector &trajectory);
+	double calculate_cost(const cycle_vector &trajectory, Primitive_library::comfort comfort);
+	double comfort_cost(Primitive_library::comfort comfort, double T);
+	double efficiency_cost(const cycle_vector &trajectory);
+	double collision_cost(const cycle_vector &trajectory);
+	double d_diff_cost(const cycle_vector &trajectory);
+	double max_acceleration_cost(const cycle_vector &trajectory);
+	double total_acceleration_cost(const cycle_vector &trajectory);
+	double total_jerk_cost(const cycle_vector &trajectory);
+	double buffer_cost(const cycle_vector &trajectory);
+	double cut_in_cost(const cycle_vector &trajectory);
+	double s_diff_cost(const cycle_vector &trajectory);
+	double speed_limit_cost(const cycle_vector &trajectory);
+	double max_jerk_cost(const cycle_vector &trajectory);
+	double stay_in_lane(const cycle_vector &trajectory);
 
 
 	// Helper functions
 	void init();
-	double nearest_approach_to_vehicle_in_front(vector<double> trajectory);
-	double buffer_cost_front(vector<double> trajectory);
-	double coefficients_to_time_function(vector<double> coefficients, double t);
+	void begin_cycle();
+	double nearest_approach_to_vehicle_in_front(const cycle_vector &trajectory);
+	double buffer_cost_front(const cycle_vector &trajectory);
+	double coefficients_to_time_function(const cycle_vector &coefficients, double t);
 	double logistic(double x);
-	vector<double> wiggle_goal(double t);
-	vector<double> differentiate_polynomial(vector<double> coefficients);
-	vector<double> getFrenet(double x, double y, double theta, vector<double> maps_x, vector<double> maps_y);
-	vector<double> getXY(double s, double d, vector<double> maps_s, vector<double> maps_x, vector<double> maps_y);
+	cycle_vector wiggle_goal(double t);
+	cycle_vector differentiate_polynomial(const cycle_vector &coefficients);
+	cycle_vector getFrenet(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y);
+	cycle_vector getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y);
 	double distance(double x1, double y1, double x2, double y2);
-	int ClosestWaypoint(double x, double y, vector<double> maps_x, vector<double> maps_y);
-	int NextWaypoint(double x, double y, double theta, vector<double> maps_x, vector<double> maps_y);
-	vector<double> get_ceoef_and_rates_of_change(vector<double> coefficients);
-	double nearest_approach_to_any_vehicle(vector<double> trajectory);
+	int ClosestWaypoint(double x, double y, const vector<double> &maps_x, const vector<double> &maps_y);
+	int NextWaypoint(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y);
+	cycle_vector get_ceoef_and_rates_of_change(const cycle_vector &coefficients);
+	double nearest_approach_to_any_vehicle(const cycle_vector &trajectory);
+	Occupancy_raster *occupancy_for(const cycle_vector &trajectory);
 
 	// Path functions
 	void update_our_car_state(MAP *MAP, double car_x, double car_y, double car_s, double car_d,
 		double car_yaw, double car_speed, long long time_difference);
 	void sensor_fusion_predict_and_behavior(vector< vector<double>> sensor_fusion, long long time_difference_b);
-	vector<double> trajectory_generation();
-	vector<double> jerk_minimal_trajectory(vector< double> start, vector <double> end, double T);
+	cycle_vector trajectory_generation();
+	cycle_vector jerk_minimal_trajectory(const cycle_vector &start, const cycle_vector &end, double T);
 	Previous_path merge_previous_path(MAP *MAP, vector< double> previous_path_x,
 		vector< double> previous_path_y, double car_yaw, double car_s, double car_d, double end_path_s, double end_path_d);
-	X_Y convert_new_path_to_X_Y_and_merge(MAP *MAP, S_D S_D_, Previous_path Previous_path);
-	S_D build_trajectory(vector<double> trajectory, long long build_trajectory_time);
+	X_Y convert_new_path_to_X_Y_and_merge(MAP *MAP, const S_D &S_D_, const Previous_path &Previous_path);
+	S_D build_trajectory(const cycle_vector &trajectory, long long build_trajectory_time);
 
 };
 
@@ -118,7 +136,7 @@ class Vehicle : public path {
 
 public:
 
-	double nearest_approach(vector<double> trajectory, Vehicle vehicle);
+	double nearest_approach(const cycle_vector &trajectory, Vehicle &vehicle);
 
 	double radius = 1.5; // model vehicle as circle to simplify collision detection
 
@@ -126,6 +144,7 @@ public:
 	double sf_x, sf_y, sf_vx, sf_vy, sf_s, sf_d;  // sensor fusion
 	double sf_x_p, sf_y_p, sf_vx_p, sf_vy_p, sf_s_p, sf_d_p;  // previous sensor fusion readings
 	string predicted_state;
+	GNB::Maneuver predicted_maneuver = GNB::KEEP;
 
 	vector<double> S = { 0, 0, 0 }; // longitudinal    S, S_dot, S_dot_dot  s_position, velocity, acceleration
 	vector<double> D = { 0, 0, 0 }; // lateral		D, D_dot, D_dot_dot
@@ -0,0 +1,172 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include "primitive_library.h"
+#include "Eigen-3.3/Eigen/Dense"
+
+using Eigen::Matrix3d;
+
+Primitive_library::Primitive_library() {}
+Primitive_library::~Primitive_library() {}
+
+static const char library_magic[8] = { 'P', 'R', 'I', 'M', 'L', 'I', 'B', '1' };
+
+// Same convention as path::differentiate_polynomial() so sampled costs match
+static vector<double> differentiate(const vector<double> &coefficients) {
+	vector<double> out;
+	for (size_t i = 1; i < coefficients.size(); ++i) {
+		out.push_back((i + 1) * coefficients[i]);
+	}
+	return out;
+}
+
+static double evaluate(const vector<double> &coefficients, double t) {
+	double total = 0.0;
+	for (size_t i = 0; i < coefficients.size(); ++i) {
+		total += coefficients[i] * pow(t, i);
+	}
+	return total;
+}
+
+void Primitive_library::build(double T_min, double T_max, double T_step) {
+
+	this->T_min = T_min;
+	this->T_step = T_step;
+	int count = (int)lround((T_max - T_min) / T_step) + 1;
+	entries.resize(count);
+
+	for (int k = 0; k < count; ++k) {
+
+		entry &e = entries[k];
+		double T = T_min + k * T_step;
+		e.T = T;
+
+		// 1. Unit primitives, same system as path::jerk_minimal_trajectory()
+		Matrix3d T_matrix;
+		T_matrix << pow(T, 3), pow(T, 4), pow(T, 5),
+			3 * pow(T, 2), 4 * pow(T, 3), 5 * pow(T, 4),
+			6 * pow(T, 1), 12 * pow(T, 2), 20 * pow(T, 3);
+		Matrix3d T_inverse = T_matrix.inverse();
+
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				e.inverse[i][j] = T_inverse(i, j);
+			}
+		}
+
+		// 2. Response of each coefficient at the cost function sample times
+		for (int c = 0; c < n_coefficients; ++c) {
+
+			vector<double> unit(n_coefficients, 0.0);
+			unit[c] = 1;
+			vector<double> velocity = differentiate(unit);
+			vector<double> acceleration = differentiate(velocity);
+			vector<double> jerk = differentiate(acceleration);
+
+			for (int i = 0; i < n_samples; ++i) {
+				e.acceleration_samples[i][c] = evaluate(acceleration, T / 10 * i);
+				e.acceleration_samples_coarse[i][c] = evaluate(acceleration, T * i);
+				e.jerk_samples[i][c] = evaluate(jerk, T / 10 * i);
+			}
+		}
+	}
+}
+
+bool Primitive_library::save(string file_name) {
+
+	ofstream out(file_name.c_str(), ofstream::binary);
+	if (!out) { return false; }
+
+	uint32_t count = entries.size();
+	out.write(library_magic, sizeof(library_magic));
+	out.write((const char*)&count, sizeof(count));
+	out.write((const char*)&T_min, sizeof(T_min));
+	out.write((const char*)&T_step, sizeof(T_step));
+	out.write((const char*)entries.data(), count * sizeof(entry));
+
+	return out.good();
+}
+
+bool Primitive_library::load(string file_name) {
+
+	ifstream in(file_name.c_str(), ifstream::binary);
+	if (!in) { return false; }
+
+	char magic[8];
+	uint32_t count = 0;
+	in.read(magic, sizeof(magic));
+	in.read((char*)&count, sizeof(count));
+	in.read((char*)&T_min, sizeof(T_min));
+	in.read((char*)&T_step, sizeof(T_step));
+	if (!in || memcmp(magic, library_magic, sizeof(magic)) != 0 || T_step <= 0) {
+		entries.clear();
+		return false;
+	}
+
+	entries.resize(count);
+	in.read((char*)entries.data(), count * sizeof(entry));
+	if (!in) {
+		entries.clear();
+		return false;
+	}
+	return true;
+}
+
+const Primitive_library::entry *Primitive_library::find(double T) const {
+
+	if (entries.size() == 0) { return nullptr; }
+
+	long k = lround((T - T_min) / T_step);
+	if (k < 0 || k >= (long)entries.size()) { return nullptr; }
+
+	const entry *e = &entries[k];
+	if (fabs(e->T - T) > 1e-6) { return nullptr; }
+	return e;
+}
+
+void Primitive_library::coefficients(const entry &e, const double start[3],
+	const double end[3], double out[n_coefficients]) const {
+
+	// Residual exactly as path::jerk_minimal_trajectory() forms it
+	const double T = e.T;
+	const double s_i = start[0];
+	const double s_i_dot = start[1];
+	const double s_i_dot_dot = start[2] / 2;
+
+	const double r[3] = {
+		end[0] - (s_i + s_i_dot * T + (s_i_dot_dot * T * T) / 2),
+		end[1] - (s_i_dot + s_i_dot_dot * T),
+		end[2] - s_i_dot_dot };
+
+	out[0] = s_i;
+	out[1] = s_i_dot;
+	out[2] = s_i_dot_dot;
+	for (int i = 0; i < 3; ++i) {
+		out[3 + i] = e.inverse[i][0] * r[0] + e.inverse[i][1] * r[1] + e.inverse[i][2] * r[2];
+	}
+}
+
+Primitive_library::comfort Primitive_library::features(const entry &e,
+	const double coefficients[n_coefficients]) const {
+
+	comfort out = { 0, 0, 0 };
+	const double delta_time = e.T / 10;
+
+	for (int i = 0; i < n_samples; ++i) {
+
+		double acceleration = 0, acceleration_coarse = 0, jerk = 0;
+		for (int c = 0; c < n_coefficients; ++c) {
+			acceleration += coefficients[c] * e.acceleration_samples[i][c];
+			acceleration_coarse += coefficients[c] * e.acceleration_samples_coarse[i][c];
+			jerk += coefficients[c] * e.jerk_samples[i][c];
+		}
+
+		out.max_jerk = fmax(out.max_jerk, fabs(acceleration));
+		out.max_acceleration = fmax(out.max_acceleration, fabs(acceleration_coarse));
+		out.integrated_jerk += fabs(jerk * delta_time);
+	}
+	return out;
+}
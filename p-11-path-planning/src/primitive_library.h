@@ -0,0 +1,77 @@
+#ifndef PRIMITIVE_LIBRARY_H
+#define PRIMITIVE_LIBRARY_H
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+/*
+Precomputed jerk minimal (quintic) primitives.
+
+For a fixed duration T the jerk minimal trajectory is linear in the
+relative end state, ie the residual between the goal and where the start
+state would be at T. Each entry stores, for one T on a fixed grid:
+
+	inverse - maps a residual to the a_3, a_4, a_5 coefficients. Its columns
+	are the three unit primitives, any goal is an affine shift of the start
+	state plus a weighted sum of them.
+
+	*_samples - response of each of the 6 polynomial coefficients at the
+	times the comfort cost functions sample, so max acceleration, max jerk
+	and integrated jerk become a handful of dot products.
+
+The table is written offline by build_primitives and loaded by path::init().
+*/
+
+class Primitive_library {
+public:
+
+	Primitive_library();
+	virtual ~Primitive_library();
+
+	static const int n_samples = 10;   // same sample count as the comfort cost functions
+	static const int n_coefficients = 6;
+
+	// Default grid, covers our_path->T +- timestep for lane keep (4) and lane change (8)
+	static constexpr double default_T_min = 1;
+	static constexpr double default_T_max = 10;
+	static constexpr double default_T_step = .02;
+
+	struct entry {
+		double T;
+		double inverse[3][3];
+		double acceleration_samples[n_samples][n_coefficients];         // t = T / 10 * i, max_jerk_cost()
+		double acceleration_samples_coarse[n_samples][n_coefficients];  // t = T * i, max_acceleration_cost()
+		double jerk_samples[n_samples][n_coefficients];                 // t = T / 10 * i, total_jerk_cost()
+	};
+
+	// Cost features of one primitive, see path::comfort_cost()
+	struct comfort {
+		double max_acceleration;
+		double max_jerk;
+		double integrated_jerk;
+	};
+
+	double T_min;
+	double T_step;
+	vector<entry> entries;
+
+	void build(double T_min, double T_max, double T_step);
+	bool save(string file_name);
+	bool load(string file_name);
+
+	// nullptr if T is not on the grid, caller falls back to solving
+	const entry *find(double T) const;
+
+	// Same result as path::jerk_minimal_trajectory(start, end, e.T) without the solve,
+	// start and end are [s, s_dot, s_dot_dot]
+	void coefficients(const entry &e, const double start[3],
+		const double end[3], double out[n_coefficients]) const;
+
+	comfort features(const entry &e, const double coefficients[n_coefficients]) const;
+
+};
+
+#endif
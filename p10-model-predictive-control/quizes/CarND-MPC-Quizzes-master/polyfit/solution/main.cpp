@@ -2,42 +2,12 @@
 
 #include <iostream>
 #include "Eigen-3.3/Eigen/Core"
-#include "Eigen-3.3/Eigen/QR"
 
-using namespace Eigen;
-
-// Evaluate a polynomial.
-double polyeval(Eigen::VectorXd coeffs, double x) {
-  double result = 0.0;
-  for (int i = 0; i < coeffs.size(); i++) {
-    result += coeffs[i] * pow(x, i);
-  }
-  return result;
-}
+// polyfit() and polyeval() now live in the project's src/, shared with the
+// controller. Reference_line fits the cubic and evaluates it.
+#include "MPC_reference_line.h"
 
-// Fit a polynomial.
-// Adapted from
-// https://github.com/JuliaMath/Polynomials.jl/blob/master/src/Polynomials.jl#L676-L716
-Eigen::VectorXd polyfit(Eigen::VectorXd xvals, Eigen::VectorXd yvals,
-                        int order) {
-  assert(xvals.size() == yvals.size());
-  assert(order >= 1 && order <= xvals.size() - 1);
-  Eigen::MatrixXd A(xvals.size(), order + 1);
-
-  for (int i = 0; i < xvals.size(); i++) {
-    A(i, 0) = 1.0;
-  }
-
-  for (int j = 0; j < xvals.size(); j++) {
-    for (int i = 0; i < order; i++) {
-      A(j, i + 1) = A(j, i) * xvals(j);
-    }
-  }
-
-  auto Q = A.householderQr();
-  auto result = Q.solve(yvals);
-  return result;
-}
+using namespace Eigen;
 
 int main() {
   Eigen::VectorXd xvals(6);
@@ -47,15 +17,15 @@ int main() {
   // y waypoint coordinates
   yvals << 5.17, -2.25, -15.306, -29.46, -42.85, -57.6116;
 
-  // Pass the x and y waypoint coordinates along the order of the polynomial.
-  // In this case, 3.
-  auto coeffs = polyfit(xvals, yvals, 3);
+  // Pass the x and y waypoint coordinates and how many there are.
+  // The polynomial is always third order.
+  Reference_line line;
+  line.fit(xvals.data(), yvals.data(), xvals.size());
 
   for (double x = 0; x <= 20; x += 1.0) {
-    // We can evaluate the polynomial at a x coordinate by calling `polyeval`.
-    // The first argument being the coefficients, `coeffs`.
-    // The second being the x coordinate, `x`.
-    auto v = polyeval(coeffs, x);
+    // We can evaluate the polynomial at a x coordinate by calling `value`.
+    // The coefficients are in `line.coeffs`.
+    auto v = line.value(x);
     std::cout << v << std::endl;
   }
 
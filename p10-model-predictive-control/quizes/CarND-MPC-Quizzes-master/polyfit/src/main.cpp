@@ -2,42 +2,12 @@
 
 #include <iostream>
 #include "Eigen-3.3/Eigen/Core"
-#include "Eigen-3.3/Eigen/QR"
 
-using namespace Eigen;
-
-// Evaluate a polynomial.
-double polyeval(Eigen::VectorXd coeffs, double x) {
-  double result = 0.0;
-  for (int i = 0; i < coeffs.size(); i++) {
-    result += coeffs[i] * pow(x, i);
-  }
-  return result;
-}
-
-// Fit a polynomial.
-// Adapted from
-// https://github.com/JuliaMath/Polynomials.jl/blob/master/src/Polynomials.jl#L676-L716
-Eigen::VectorXd polyfit(Eigen::VectorXd xvals, Eigen::VectorXd yvals,
-                        int order) {
-  assert(xvals.size() == yvals.size());
-  assert(order >= 1 && order <= xvals.size() - 1);
-  Eigen::MatrixXd A(xvals.size(), order + 1);
-
-  for (int i = 0; i < xvals.size(); i++) {
-    A(i, 0) = 1.0;
-  }
-
-  for (int j = 0; j < xvals.size(); j++) {
-    for (int i = 0; i < order; i++) {
-      A(j, i + 1) = A(j, i) * xvals(j);
-    }
-  }
+// polyfit() and polyeval() now live in the project's src/, shared with the
+// controller. Reference_line fits the cubic and evaluates it.
+#include "MPC_reference_line.h"
 
-  auto Q = A.householderQr();
-  auto result = Q.solve(yvals);
-  return result;
-}
+using namespace Eigen;
 
 int main() {
   Eigen::VectorXd xvals(6);
@@ -47,11 +17,13 @@ int main() {
   // y waypoint coordinates
   yvals << 5.17, -2.25, -15.306, -29.46, -42.85, -57.6116;
 
-  // TODO: use `polyfit` to fit a third order polynomial to the (x, y)
+  Reference_line line;
+
+  // TODO: use `line.fit` to fit a third order polynomial to the (x, y)
   // coordinates.
 
   for (double x = 0; x <= 20; x += 1.0) {
-    // TODO: use `polyeval` to evaluate the x values.
+    // TODO: use `line.value` to evaluate the x values.
   }
 
   // Expected output
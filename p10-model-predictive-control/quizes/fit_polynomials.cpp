@@ -2,42 +2,10 @@
 
 #include <iostream>
 #include "Eigen\Dense"
+#include "MPC_reference_line.h"
 
 using namespace Eigen;
 
-// Evaluate a polynomial.
-double polyeval(Eigen::VectorXd coeffs, double x) {
-  double result = 0.0;
-  for (int i = 0; i < coeffs.size(); i++) {
-    result += coeffs[i] * pow(x, i);
-  }
-  return result;
-}
-
-// Fit a polynomial.
-// Adapted from
-// https://github.com/JuliaMath/Polynomials.jl/blob/master/src/Polynomials.jl#L676-L716
-Eigen::VectorXd polyfit(Eigen::VectorXd xvals, Eigen::VectorXd yvals,
-                        int order) {
-  assert(xvals.size() == yvals.size());
-  assert(order >= 1 && order <= xvals.size() - 1);
-  Eigen::MatrixXd A(xvals.size(), order + 1);
-
-  for (int i = 0; i < xvals.size(); i++) {
-    A(i, 0) = 1.0;
-  }
-
-  for (int j = 0; j < xvals.size(); j++) {
-    for (int i = 0; i < order; i++) {
-      A(j, i + 1) = A(j, i) * xvals(j);
-    }
-  }
-
-  auto Q = A.householderQr();
-  auto result = Q.solve(yvals);
-  return result;
-}
-
 int main() {
   Eigen::VectorXd xvals(6);
   Eigen::VectorXd yvals(6);
@@ -48,12 +16,13 @@ int main() {
 
   // TODO: use `polyfit` to fit a third order polynomial to the (x, y)
   // coordinates.
-  auto result = polyfit(xvals, yvals, 3) ;
+  Reference_line result ;
+  result.fit(xvals.data(), yvals.data(), xvals.size()) ;
 
   for (double x = 0; x <= 20; x += 1.0) {
     // TODO: use `polyeval` to evaluate the x values.
 
-    auto poly_eval_result = polyeval(result , x) ;
+    auto poly_eval_result = result.value(x) ;
     std::cout << poly_eval_result << std::endl; 
   }
 
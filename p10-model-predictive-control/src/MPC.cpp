@@ -1,380 +1,860 @@
 #include "MPC.h"
-#include <cppad/cppad.hpp>
-#include <cppad/ipopt/solve.hpp>
+#include "MPC_model.h"
+#include "MPC_rti.h"
+#include "MPC_stats.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <coin/IpIpoptApplication.hpp>
+#include <coin/IpTNLP.hpp>
 #include "Eigen-3.3/Eigen/Core"
 
+#ifdef MPC_GENERATED_DERIVATIVES
+#include "MPC_derivatives.h"
+#else
+#include <cppad/cppad.hpp>
 using CppAD::AD;
+#endif
+
 using namespace std ;
 
 
-size_t N = 9;
-double dt = .035;
+static void set_parameters(const Eigen::VectorXd &coeffs, double dt, const MPC_weights &w,
+                           vector<double> &p) {
 
-// This value assumes the model presented in the classroom is used.
-//
-// It was obtained by measuring the radius formed by running the vehicle in the
-// simulator around in a circle with a constant steering angle and velocity on a
-// flat terrain.
-//
-// Lf was tuned until the the radius formed by the simulating the model
-// presented in the classroom matched the previous radius.
-//
-// This is the length from front to CoG that has a similar radius.
-const double Lf = 2.9;
-
-double ref_cte = 0;
-double ref_epsi = 0;
-double ref_v = 115;   
-
-// A. Solver takes 1 vector.
-//  This is to create an index to access variables in that fector
-size_t x_start      = 0 ;
-size_t y_start      = x_start     + N ;
-size_t psi_start    = y_start     + N ;
-size_t v_start      = psi_start   + N ;
-size_t cte_start    = v_start     + N ;
-size_t epsi_start   = cte_start   + N ;
-size_t delta_start  = epsi_start  + N ;
-size_t a_start      = delta_start + N - 1 ;
-/// end A.
-
-double coeff_cost_ref_cte ;
-double coeff_cost_ref_epsi ;
-double coeff_cost_ref_v ;
-double coeff_cost_ref_val_throttle ;
-double coeff_cost_ref_val_steering ;
-double coeff_cost_ref_seq_throttle ;
-double coeff_cost_ref_seq_steering ;
+  p.resize(N_PARAMETERS) ;
+  for (size_t i = 0; i < 4; i++) {
+    p[P_COEFFS + i] = coeffs[i] ;
+  }
+  p[P_DT]           = dt ;
+  p[P_CTE]          = w.cte ;
+  p[P_EPSI]         = w.epsi ;
+  p[P_V]            = w.v ;
+  p[P_VAL_THROTTLE] = w.val_throttle ;
+  p[P_VAL_STEERING] = w.val_steering ;
+  p[P_SEQ_THROTTLE] = w.seq_throttle ;
+  p[P_SEQ_STEERING] = w.seq_steering ;
+  p[P_REF_CTE]      = w.ref_cte ;
+  p[P_REF_EPSI]     = w.ref_epsi ;
+  p[P_REF_V]        = w.ref_v ;
+}
 
+/****************************************
+ * Persistent problem
+ ****************************************/
 
-//
-// MPC class definition implementation.
-//
-MPC::MPC() {}
-MPC::~MPC() {}
+/*
+Why?
+CppAD::ipopt::solve re-records FG_eval and recomputes the Jacobian and
+Hessian sparsity on every call. Only the initial state, the polynomial
+coeffs and the weights change between control cycles, so we tape once with
+coeffs and weights as dynamic parameters, keep the sparsity patterns (and
+CppAD's colorings) and hand Ipopt a TNLP that reuses them. The initial
+state only moves the constraint bounds, it never touches the tape.
 
-void MPC::Init(vector<double> coeff_hyper_parameters ){
+Walking the tape is still most of an Ipopt iteration though. With
+MPC_GENERATED_DERIVATIVES (the CMake default) the build runs MPC_codegen,
+which traces FG_eval symbolically and writes the cost, constraints and
+their derivatives out as straight line C++ per horizon. That is compiled
+with the rest and replaces the tape, CppAD isn't needed at all.
+*/
 
-  /****************************************
-   * cost hyperparamters
-   ****************************************/
+#ifdef MPC_GENERATED_DERIVATIVES
 
-  coeff_cost_ref_cte           = coeff_hyper_parameters[0];
-  coeff_cost_ref_epsi          = coeff_hyper_parameters[1];
-  coeff_cost_ref_v             = coeff_hyper_parameters[2];
-  coeff_cost_ref_val_throttle  = coeff_hyper_parameters[3];
-  coeff_cost_ref_val_steering  = coeff_hyper_parameters[4];
-  coeff_cost_ref_seq_throttle  = coeff_hyper_parameters[5];
-  coeff_cost_ref_seq_steering  = coeff_hyper_parameters[6];
-}
+// [cost, constraints] and derivatives for MPC_nlp, from the generated code
+template <size_t N>
+class MPC_generated {
+
+ public:
 
+  typedef MPC_derivatives<N> D ;
 
+  void new_parameters(const vector<double> &p) { p_ = p ; }
 
-class FG_eval {
+  size_t jac_g_nnz() const { return D::jac_nnz ; }
+  size_t hes_nnz() const { return D::hes_nnz ; }
+
+  void jac_g_structure(Ipopt::Index *iRow, Ipopt::Index *jCol) const {
+    for (size_t k = 0; k < D::jac_nnz; k++) {
+      iRow[k] = D::jac_row[k] ;
+      jCol[k] = D::jac_col[k] ;
+    }
+  }
+
+  void hes_structure(Ipopt::Index *iRow, Ipopt::Index *jCol) const {
+    for (size_t k = 0; k < D::hes_nnz; k++) {
+      iRow[k] = D::hes_row[k] ;
+      jCol[k] = D::hes_col[k] ;
+    }
+  }
+
+  double f(const double *x, bool new_x) { return D::f(x, p_.data()) ; }
+  void g(const double *x, bool new_x, double *g) { D::g(x, p_.data(), g) ; }
+  void grad_f(const double *x, bool new_x, double *grad) { D::grad_f(x, p_.data(), grad) ; }
+  void jac_g(const double *x, bool new_x, double *values) { D::jac_g(x, p_.data(), values) ; }
+
+  void hes(const double *x, bool new_x, double obj_factor, const double *lambda, double *values) {
+    D::hes(x, p_.data(), obj_factor, lambda, values) ;
+  }
+
+ private:
+
+  vector<double> p_ ;
+};
+
+template <size_t N> using MPC_derivative_eval = MPC_generated<N> ;
+
+#else
+
+typedef CppAD::sparse_rc< vector<size_t> > Sparsity;
+typedef CppAD::sparse_rcv< vector<size_t>, vector<double> > Sparse_values;
+
+// [cost, constraints] and derivatives for MPC_nlp, from the tape
+template <size_t N>
+class MPC_tape {
 
  public:
 
-  // Fitted polynomial coefficients
-  Eigen::VectorXd coeffs;
-  FG_eval( Eigen::VectorXd coeffs) { this->coeffs = coeffs; }
+  typedef MPC_layout<N> L ;
 
-  typedef CPPAD_TESTVECTOR(AD<double>) ADvector;
-  void operator()( ADvector& fg, const ADvector& vars) {
+  MPC_tape() {
+    record() ;
+    sparsity() ;
+  }
 
-    // `fg` is a vector containing the cost and constraints.
-    // `vars` is a vector containing the variable values (state & actuators).
-    // The cost is stored is the first element of `fg`.
-    // Any additions to the cost should be added to `fg[0]`.
-    // Reference State Cost
+  void new_parameters(const vector<double> &p) {
+    fun_.new_dynamic(p) ;
+    x_ready_ = false ;
+  }
 
-    /****************************************
-     * Cost vectors
-     ****************************************/
+  size_t jac_g_nnz() const { return jac_g_.size() ; }
+  size_t hes_nnz() const { return hes_.nnz() ; }
 
-    /*
-    Why?
-    Later in our code solve() will need tounderstand what we care about 
-    */
+  void jac_g_structure(Ipopt::Index *iRow, Ipopt::Index *jCol) const {
+    // row 0 of the tape is the cost
+    for (size_t k = 0; k < jac_g_.size(); k++) {
+      iRow[k] = jac_.row()[jac_g_[k]] - 1 ;
+      jCol[k] = jac_.col()[jac_g_[k]] ;
+    }
+  }
 
-    // cout << "coeff_cost_ref_cte" << coeff_cost_ref_cte << endl; 
-    
-    fg[0] = 0 ;
+  void hes_structure(Ipopt::Index *iRow, Ipopt::Index *jCol) const {
+    for (size_t k = 0; k < hes_.nnz(); k++) {
+      iRow[k] = hes_.row()[k] ;
+      jCol[k] = hes_.col()[k] ;
+    }
+  }
 
-    // Cost for reference state
-    for (int t = 0;   t < N;  t++) {
-      fg[0] += coeff_cost_ref_cte   * CppAD::pow( vars[cte_start + t]   - ref_cte,  2) ;
-      fg[0] += coeff_cost_ref_epsi  * CppAD::pow( vars[epsi_start + t]  - ref_epsi,  2) ;
-      fg[0] += coeff_cost_ref_v     * CppAD::pow( vars[v_start + t]     - ref_v,  2) ;
+  double f(const double *x, bool new_x) {
+    forward(x, new_x) ;
+    return fg_[0] ;
+  }
+
+  void g(const double *x, bool new_x, double *g) {
+    forward(x, new_x) ;
+    for (size_t i = 0; i < L::n_constraints; i++) {
+      g[i] = fg_[1 + i] ;
     }
+  }
 
-    // Reduce actuators values
-    for (int t = 0;   t < (N - 1);    t++) {
-      fg[0] += coeff_cost_ref_val_steering * CppAD::pow( vars[delta_start + t],  2) ;
-      fg[0] += coeff_cost_ref_val_throttle * CppAD::pow( vars[a_start     + t],  2) ;
+  void grad_f(const double *x, bool new_x, double *grad) {
+    jacobian(x, new_x) ;
+    for (size_t i = 0; i < L::n_vars; i++) {
+      grad[i] = 0 ;
     }
+    for (size_t k = 0; k < grad_f_.size(); k++) {
+      grad[jac_.col()[grad_f_[k]]] = jac_.val()[grad_f_[k]] ;
+    }
+  }
 
-    // Reduce gap between actuations (sequence)
-    for (int t = 0;   t < (N - 2);   t++) {
+  void jac_g(const double *x, bool new_x, double *values) {
+    jacobian(x, new_x) ;
+    for (size_t k = 0; k < jac_g_.size(); k++) {
+      values[k] = jac_.val()[jac_g_[k]] ;
+    }
+  }
 
-      // (t + 1) - (t)
-      fg[0] += coeff_cost_ref_seq_steering * CppAD::pow( vars[delta_start + t + 1] - vars[delta_start + t],  2) ;
-      fg[0] += coeff_cost_ref_seq_throttle * CppAD::pow( vars[a_start     + t + 1] - vars[a_start + t],  2) ;
+  void hes(const double *x, bool new_x, double obj_factor, const double *lambda, double *values) {
+    set_x(x, new_x) ;
+    w_[0] = obj_factor ;
+    for (size_t i = 0; i < L::n_constraints; i++) {
+      w_[1 + i] = lambda[i] ;
+    }
+    fun_.sparse_hes(x_, w_, hes_, hes_pattern_, "cppad.symmetric", hes_work_) ;
+    for (size_t k = 0; k < hes_.nnz(); k++) {
+      values[k] = hes_.val()[k] ;
     }
+  }
 
-    /****************************************
-     * Initial constraints
-     ****************************************/
+ private:
 
-    /*
-    Why is this next?
-    Solve() doesn't know the car can't teleport. We need to define what's reasonable
+  static constexpr size_t n_vars        = L::n_vars ;
+  static constexpr size_t n_constraints = L::n_constraints ;
 
-    */
+  CppAD::ADFun<double> fun_ ;
 
-    // We add 1 to each of the starting indices due to cost being located at
-    // index 0 of `fg`.
-    // This bumps up the position of all the other values.
-    fg[1 + x_start]     = vars[x_start];
-    fg[1 + y_start]     = vars[y_start];
-    fg[1 + psi_start]   = vars[psi_start];
-    fg[1 + v_start]     = vars[v_start];
-    fg[1 + cte_start]   = vars[cte_start];
-    fg[1 + epsi_start]  = vars[epsi_start];
+  // Jacobian of [cost, constraints], Hessian lower triangle
+  Sparsity jac_pattern_, hes_pattern_ ;
+  Sparse_values jac_, hes_ ;
+  CppAD::sparse_jac_work jac_work_ ;
+  CppAD::sparse_hes_work hes_work_ ;
+  vector<size_t> grad_f_, jac_g_ ;  // indices into jac_ for row 0 / rows 1..
 
-    /****************************************
-     * Kinematic model
-     ****************************************/
+  // Current point
+  vector<double> x_, fg_, w_ ;
+  bool x_ready_ = false ;
+  bool fg_ready_ = false ;
+  bool jac_ready_ = false ;
 
-    for (int i = 0; i < N - 1; i++) {
+  void record() {
 
-      // State time t + 1
-      AD<double> x_t1     = vars[x_start    + i + 1] ;
-      AD<double> y_t1     = vars[y_start    + i + 1] ;
-      AD<double> psi_t1   = vars[psi_start  + i + 1] ;
-      AD<double> v_t1     = vars[v_start    + i + 1] ;
-      AD<double> cte_t1   = vars[cte_start  + i + 1] ;
-      AD<double> e_psi_t1 = vars[epsi_start + i + 1] ;
+    typedef CPPAD_TESTVECTOR(AD<double>) ADvector ;
+    ADvector a_vars(n_vars), a_p(N_PARAMETERS), a_fg(1 + n_constraints) ;
+    for (size_t i = 0; i < n_vars; i++) {
+      a_vars[i] = 0 ;
+    }
+    for (size_t i = 0; i < N_PARAMETERS; i++) {
+      a_p[i] = 0 ;
+    }
 
-      // State at time t
-      AD<double> x_t0     = vars[x_start    + i] ;
-      AD<double> y_t0     = vars[y_start    + i] ;
-      AD<double> v_t0     = vars[v_start    + i] ;
-      AD<double> psi_t0   = vars[psi_start  + i] ;
-      AD<double> cte_t0   = vars[cte_start  + i] ;
-      AD<double> e_psi_t0 = vars[epsi_start + i] ;
+    CppAD::Independent(a_vars, 0, false, a_p) ;
+    FG_eval<N, ADvector> fg_eval(a_p) ;
+    fg_eval(a_fg, a_vars) ;
+    fun_.Dependent(a_vars, a_fg) ;
+    fun_.optimize() ;
+  }
 
-      AD<double> delta_t0 = vars[delta_start + i] ;
-      AD<double> a_t0     = vars[a_start      + i] ;
+  void sparsity() {
 
-      // for 3rd degree polynomial
-      AD<double> f_t0 = coeffs[0] + 
-                        coeffs[1] * x_t0 + 
-                        coeffs[2] * x_t0 * x_t0 +
-                        coeffs[3] * (x_t0 * x_t0 * x_t0) ;
-      
-      // rate of cahnge of f0
-      AD<double> f_t0_rate_of_change = coeffs[1] +
-                                       (2 * coeffs[2] * x_t0) +
-                                       (3 * coeffs[3] * (x_t0 * x_t0) );       
-       
-      AD<double> psides_t0 = CppAD::atan( f_t0_rate_of_change) ;
+    size_t n = n_vars ;
+    size_t m = 1 + n_constraints ;
 
+    Sparsity identity(n, n, n) ;
+    for (size_t k = 0; k < n; k++) {
+      identity.set(k, k, k) ;
+    }
+    fun_.for_jac_sparsity(identity, false, false, false, jac_pattern_) ;
+    jac_ = Sparse_values(jac_pattern_) ;
 
-      // Here's `x` to get you started.
-      // The idea here is to constraint this value to be 0.
-      //
-      // NOTE: The use of `AD<double>` and use of `CppAD`!
-      // This is also CppAD can compute derivatives and pass
-      // these to the solver.
+    for (size_t k = 0; k < jac_pattern_.nnz(); k++) {
+      if (jac_pattern_.row()[k] == 0) { grad_f_.push_back(k) ; }
+      else                            { jac_g_.push_back(k) ; }
+    }
 
-      fg[2 + x_start + i]    = x_t1   - (x_t0 + v_t0 * CppAD::cos(psi_t0) * dt ) ;
-      fg[2 + y_start + i]    = y_t1   - (y_t0 + v_t0 * CppAD::sin(psi_t0) * dt ) ;
+    // Lagrangian Hessian, any weighting of the cost and constraints
+    vector<bool> select_range(m, true) ;
+    fun_.rev_hes_sparsity(select_range, false, false, hes_pattern_) ;
 
-      fg[2 + psi_start + i]  = psi_t1 - (psi_t0 + v_t0 * delta_t0 / Lf * dt ) ;
+    size_t nnz = 0 ;
+    for (size_t k = 0; k < hes_pattern_.nnz(); k++) {
+      if (hes_pattern_.row()[k] >= hes_pattern_.col()[k]) { nnz++ ; }
+    }
+    Sparsity lower(n, n, nnz) ;
+    nnz = 0 ;
+    for (size_t k = 0; k < hes_pattern_.nnz(); k++) {
+      if (hes_pattern_.row()[k] >= hes_pattern_.col()[k]) {
+        lower.set(nnz++, hes_pattern_.row()[k], hes_pattern_.col()[k]) ;
+      }
+    }
+    hes_ = Sparse_values(lower) ;
 
-      fg[2 + v_start + i]    = v_t1   - (v_t0 + a_t0 * dt) ;
+    x_.resize(n) ;
+    fg_.resize(m) ;
+    w_.resize(m) ;
+  }
 
-      fg[2 + cte_start + i]  = cte_t1 - ( (f_t0 - y_t0) + 
-                              (v_t0 * CppAD::sin(e_psi_t0) * dt) ) ;
-      
-      fg[2 + epsi_start + i] = e_psi_t1 - ( ( psi_t0 - psides_t0) + 
-                               v_t0 * delta_t0 / Lf * dt ) ;
+  void set_x(const Ipopt::Number *x, bool new_x) {
+    if (new_x || !x_ready_) {
+      x_.assign(x, x + n_vars) ;
+      x_ready_   = true ;
+      fg_ready_  = false ;
+      jac_ready_ = false ;
+    }
+  }
 
+  void forward(const Ipopt::Number *x, bool new_x) {
+    set_x(x, new_x) ;
+    if (!fg_ready_) {
+      fg_ = fun_.Forward(0, x_) ;
+      fg_ready_ = true ;
+    }
+  }
+
+  void jacobian(const Ipopt::Number *x, bool new_x) {
+    set_x(x, new_x) ;
+    if (!jac_ready_) {
+      fun_.sparse_jac_rev(x_, jac_, jac_pattern_, "cppad", jac_work_) ;
+      jac_ready_ = true ;
     }
   }
 };
 
+template <size_t N> constexpr size_t MPC_tape<N>::n_vars ;
+template <size_t N> constexpr size_t MPC_tape<N>::n_constraints ;
 
+template <size_t N> using MPC_derivative_eval = MPC_tape<N> ;
 
+#endif
 
-vector<double> MPC::Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs) {
-  bool ok = true;
-  size_t i;
-  typedef CPPAD_TESTVECTOR(double) Dvector;
 
-  // Set the number of model variables (includes both states and inputs).
-  // For example: If the state is a 4 element vector, the actuators is a 2
-  // element vector and there are 10 timesteps. The number of variables is:
-  // 4 * 10 + 2 * 9
+template <size_t N>
+class MPC_nlp : public Ipopt::TNLP {
 
-  double x    = state[0];
-  double y    = state[1];
-  double psi  = state[2];
-  double v    = state[3];
-  double cte  = state[4];
-  double epsi = state[5];
+ public:
 
+  typedef MPC_layout<N> L ;
+  static constexpr size_t n_vars        = L::n_vars ;
+  static constexpr size_t n_constraints = L::n_constraints ;
 
-  size_t n_vars = N * 6 + (N - 1) * 2;;
-  // Set the number of constraints
-  size_t n_constraints = N * 6;
+  // Set by finalize_solution()
+  array<double, L::n_vars> solution_x ;
+  double solution_obj ;
+  Ipopt::SolverReturn solution_status ;
+  double solution_constraint_violation ;
 
-  // Initial value of the independent variables.
-  // SHOULD BE 0 besides initial state.
-  Dvector vars(n_vars);
-  for (int i = 0; i < n_vars; i++) {
-    vars[i] = 0;
+  MPC_nlp(double dt) : dt(dt) {
+
+    limits() ;
   }
 
-  // Set the initial variable values
-  vars[x_start] = x;
-  vars[y_start] = y;
-  vars[psi_start] = psi;
-  vars[v_start] = v;
-  vars[cte_start] = cte;
-  vars[epsi_start] = epsi;
+  // Move the problem to a new state, reference polynomial and weights.
+  // Returns true if the initial guess and multipliers are warm started.
+  bool update(const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs, const MPC_weights &weights,
+              bool warm_start) {
+
+    set_parameters(coeffs, dt, weights, p_) ;
+    eval_.new_parameters(p_) ;
+
+    const size_t starts[6] = { L::x_start, L::y_start, L::psi_start, L::v_start, L::cte_start, L::epsi_start } ;
 
-  Dvector vars_lowerbound(n_vars);
-  Dvector vars_upperbound(n_vars);
+    warm_ = warm_start && have_solution_ ;
+    if (warm_) {
+      shift_previous_solution(state) ;
+    }
+    else {
+      // SHOULD BE 0 besides initial state.
+      for (size_t i = 0; i < n_vars; i++) {
+        vars_[i] = 0 ;
+      }
+      for (size_t i = 0; i < 6; i++) {
+        vars_[starts[i]] = state[i] ;
+      }
+    }
+
+    for (size_t i = 0; i < 6; i++) {
+      constraints_lowerbound_[starts[i]] = state[i] ;
+      constraints_upperbound_[starts[i]] = state[i] ;
+    }
+
+    solution_x = vars_ ;  // if Ipopt bails out before finalize_solution()
+    solution_constraint_violation = HUGE_VAL ;
+    return warm_ ;
+  }
 
   /****************************************
-   * Limits
+   * Ipopt::TNLP
    ****************************************/
 
-  // Set lower and upper limits for variables.
-  // Set all non-actuators upper and lowerlimits
-  // to the max negative and positive values.
-  for (int i = 0; i < delta_start; i++) {
-    vars_lowerbound[i] = -1.0e19;
-    vars_upperbound[i] =  1.0e19;
+  bool get_nlp_info(Ipopt::Index &n, Ipopt::Index &m, Ipopt::Index &nnz_jac_g,
+                    Ipopt::Index &nnz_h_lag, IndexStyleEnum &index_style) {
+    n           = n_vars ;
+    m           = n_constraints ;
+    nnz_jac_g   = eval_.jac_g_nnz() ;
+    nnz_h_lag   = eval_.hes_nnz() ;
+    index_style = C_STYLE ;
+    return true ;
   }
 
-  // The upper and lower limits of delta are set to -25 and 25
-  // degrees (values in radians).
-  for (int i = delta_start; i < a_start; i++) {
-    vars_lowerbound[i] = -0.436332;
-    vars_upperbound[i] =  0.436332;
+  bool get_bounds_info(Ipopt::Index n, Ipopt::Number *x_l, Ipopt::Number *x_u,
+                       Ipopt::Index m, Ipopt::Number *g_l, Ipopt::Number *g_u) {
+    for (size_t i = 0; i < n_vars; i++) {
+      x_l[i] = vars_lowerbound_[i] ;
+      x_u[i] = vars_upperbound_[i] ;
+    }
+    for (size_t i = 0; i < n_constraints; i++) {
+      g_l[i] = constraints_lowerbound_[i] ;
+      g_u[i] = constraints_upperbound_[i] ;
+    }
+    return true ;
   }
 
-  // Acceleration/decceleration upper and lower limits.
-  for (int i = a_start; i < n_vars; i++) {
-    vars_lowerbound[i] = -1.;
-    vars_upperbound[i] =  1.;
+  bool get_starting_point(Ipopt::Index n, bool init_x, Ipopt::Number *x,
+                          bool init_z, Ipopt::Number *z_L, Ipopt::Number *z_U,
+                          Ipopt::Index m, bool init_lambda, Ipopt::Number *lambda) {
+    if ((init_z || init_lambda) && !warm_) { return false ; }
+    for (size_t i = 0; i < n_vars; i++) {
+      x[i] = vars_[i] ;
+    }
+    if (init_z) {
+      for (size_t i = 0; i < n_vars; i++) {
+        z_L[i] = z_L_[i] ;
+        z_U[i] = z_U_[i] ;
+      }
+    }
+    if (init_lambda) {
+      for (size_t i = 0; i < n_constraints; i++) {
+        lambda[i] = lambda_[i] ;
+      }
+    }
+    return true ;
   }
 
-  // Lower and upper limits for the constraints
-  // Should be 0 besides initial state.
-  Dvector constraints_lowerbound(n_constraints);
-  Dvector constraints_upperbound(n_constraints);
-  for (int i = 0; i < n_constraints; i++) {
-    constraints_lowerbound[i] = 0;
-    constraints_upperbound[i] = 0;
+  bool eval_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number &obj_value) {
+    obj_value = eval_.f(x, new_x) ;
+    return true ;
   }
 
-  constraints_lowerbound[x_start]     = x;
-  constraints_lowerbound[y_start]     = y;
-  constraints_lowerbound[psi_start]   = psi;
-  constraints_lowerbound[v_start]     = v;
-  constraints_lowerbound[cte_start]   = cte;
-  constraints_lowerbound[epsi_start]  = epsi;
+  bool eval_grad_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number *grad_f) {
+    eval_.grad_f(x, new_x, grad_f) ;
+    return true ;
+  }
 
-  constraints_upperbound[x_start]     = x;
-  constraints_upperbound[y_start]     = y;
-  constraints_upperbound[psi_start]   = psi;
-  constraints_upperbound[v_start]     = v;
-  constraints_upperbound[cte_start]   = cte;
-  constraints_upperbound[epsi_start]  = epsi;
+  bool eval_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Index m, Ipopt::Number *g) {
+    eval_.g(x, new_x, g) ;
+    return true ;
+  }
 
+  bool eval_jac_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Index m,
+                  Ipopt::Index nele_jac, Ipopt::Index *iRow, Ipopt::Index *jCol,
+                  Ipopt::Number *values) {
 
+    if (values == NULL) {
+      eval_.jac_g_structure(iRow, jCol) ;
+    }
+    else {
+      eval_.jac_g(x, new_x, values) ;
+    }
+    return true ;
+  }
 
-  // object that computes objective and constraints
-  FG_eval fg_eval(coeffs);
+  bool eval_h(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number obj_factor,
+              Ipopt::Index m, const Ipopt::Number *lambda, bool new_lambda,
+              Ipopt::Index nele_hess, Ipopt::Index *iRow, Ipopt::Index *jCol,
+              Ipopt::Number *values) {
 
-  // options for IPOPT solver
-  std::string options;
-  // Uncomment this if you'd like more print information
-  options += "Integer print_level  0\n";
-  // NOTE: Setting sparse to true allows the solver to take advantage
-  // of sparse routines, this makes the computation MUCH FASTER. If you
-  // can uncomment 1 of these and see if it makes a difference or not but
-  // if you uncomment both the computation time should go up in orders of
-  // magnitude.
-  options += "Sparse  true        forward\n";
-  options += "Sparse  true        reverse\n";
-  // NOTE: Currently the solver has a maximum time limit of 0.5 seconds.
-  // Change this as you see fit.
-  options += "Numeric max_cpu_time          0.5\n";
+    if (values == NULL) {
+      eval_.hes_structure(iRow, jCol) ;
+    }
+    else {
+      eval_.hes(x, new_x, obj_factor, lambda, values) ;
+    }
+    return true ;
+  }
 
-  // place to return solution
-  CppAD::ipopt::solve_result<Dvector> solution;
+  void finalize_solution(Ipopt::SolverReturn status, Ipopt::Index n, const Ipopt::Number *x,
+                         const Ipopt::Number *z_L, const Ipopt::Number *z_U, Ipopt::Index m,
+                         const Ipopt::Number *g, const Ipopt::Number *lambda,
+                         Ipopt::Number obj_value, const Ipopt::IpoptData *ip_data,
+                         Ipopt::IpoptCalculatedQuantities *ip_cq) {
+    copy(x, x + n_vars, solution_x.begin()) ;
+    solution_obj    = obj_value ;
+    solution_status = status ;
+
+    solution_constraint_violation = 0 ;
+    for (size_t i = 0; i < n_constraints; i++) {
+      solution_constraint_violation = max(solution_constraint_violation,
+                                          max(constraints_lowerbound_[i] - g[i], g[i] - constraints_upperbound_[i])) ;
+    }
 
-  // solve the problem
-  CppAD::ipopt::solve<Dvector, FG_eval>( options, vars, vars_lowerbound, 
-                                         vars_upperbound, constraints_lowerbound,
-                                         constraints_upperbound, fg_eval, solution);
+    // only warm start from a point Ipopt was happy with
+    have_solution_ = status == Ipopt::SUCCESS || status == Ipopt::STOP_AT_ACCEPTABLE_POINT ;
+    if (have_solution_) {
+      copy(z_L, z_L + n_vars, z_L_.begin()) ;
+      copy(z_U, z_U + n_vars, z_U_.begin()) ;
+      copy(lambda, lambda + n_constraints, lambda_.begin()) ;
+    }
+  }
 
-  // Check some of the solution values
-  ok &= solution.status == CppAD::ipopt::solve_result<Dvector>::success;
+ private:
 
+  double dt ;
+  MPC_derivative_eval<N> eval_ ;
+  vector<double> p_ ;  // dynamic parameters
 
-  // Cost
-  auto cost_final = solution.obj_value;
-  std::cout << "Cost " << cost_final << std::endl;
+  array<double, L::n_vars> vars_, vars_lowerbound_, vars_upperbound_ ;
+  array<double, L::n_constraints> constraints_lowerbound_, constraints_upperbound_ ;
 
-  /****************************************
-   * Store values
-   ****************************************/
+  // Last accepted solution's multipliers, for warm starts
+  array<double, L::n_vars> z_L_, z_U_ ;
+  array<double, L::n_constraints> lambda_ ;
+  bool have_solution_ = false ;
+  bool warm_ = false ;
 
-  // store steering and throttle variables in class
-  // TODO rename all "delta" -> steering_angle and "a" -> throttle
-  // for clarity
-  this->steering_angle = solution.x[ delta_start ] ;
-  this->throttle       = solution.x[ a_start ] ;
+  void limits() {
 
-  //cout << "steering_angle" << solution.x[ delta_start ] << 
-  // "throttle" << solution.x[ a_start ] << endl;
+    // Set all non-actuators upper and lowerlimits
+    // to the max negative and positive values.
+    for (size_t i = 0; i < L::delta_start; i++) {
+      vars_lowerbound_[i] = -1.0e19 ;
+      vars_upperbound_[i] =  1.0e19 ;
+    }
 
-  vector<double> results ;
-  results.push_back(solution.x[psi_start + 1]) ;
-  // cout << "psi results " << results[psi_start + 1] << "at index:" << psi_start + 1 << endl ;
-  results.push_back(solution.x[v_start + 1]) ;
-  results.push_back(solution.x[cte_start + 1]) ;
-  results.push_back(solution.x[epsi_start + 1]) ;
+    // The upper and lower limits of delta are set to -25 and 25
+    // degrees (values in radians).
+    for (size_t i = L::delta_start; i < L::a_start; i++) {
+      vars_lowerbound_[i] = -0.436332 ;
+      vars_upperbound_[i] =  0.436332 ;
+    }
 
-  results.push_back(solution.x[delta_start + 1]) ;
-  results.push_back(solution.x[a_start + 1]) ;
+    // Acceleration/decceleration upper and lower limits.
+    for (size_t i = L::a_start; i < n_vars; i++) {
+      vars_lowerbound_[i] = -1. ;
+      vars_upperbound_[i] =  1. ;
+    }
 
-  for (int i = 0 ;  i < N - 1  ;  i++) {
-    results.push_back(solution.x[x_start + 1 + i]) ;
-    results.push_back(solution.x[y_start + 1 + i]) ;
-    // cout << "results x " << results[x_start + 1 + i] << endl ;
-    // cout << "results y " << results[y_start + 1 + i] << endl ;
+    // Should be 0 besides initial state, set in update()
+    constraints_lowerbound_.fill(0) ;
+    constraints_upperbound_.fill(0) ;
   }
 
-  // cout << "results[0] " << results[0] << "results[1]" << results[1] << endl ;
-
   /*
-  Why? We need to pass this for the prediction visauls
+  Why?
+  Consecutive problems are nearly the same, one dt further along. The
+  actuators and multipliers are shifted one step and the last one repeated.
+  x, y and psi are in the previous car frame, so the states are rolled out
+  again from the new initial state with the shifted actuators. That keeps
+  the guess on the model, ie feasible for the dynamics constraints.
   */
+  void shift_previous_solution(const Eigen::VectorXd &state) {
+
+    const array<double, L::n_vars> &previous = solution_x ;
+    const double *p = &p_[P_COEFFS] ;
+
+    constexpr size_t x_start     = L::x_start ;
+    constexpr size_t y_start     = L::y_start ;
+    constexpr size_t psi_start   = L::psi_start ;
+    constexpr size_t v_start     = L::v_start ;
+    constexpr size_t cte_start   = L::cte_start ;
+    constexpr size_t epsi_start  = L::epsi_start ;
+    constexpr size_t delta_start = L::delta_start ;
+    constexpr size_t a_start     = L::a_start ;
+
+    for (size_t i = 0; i < N - 1; i++) {
+      size_t j = i + 1 < N - 2 ? i + 1 : N - 2 ;
+      vars_[delta_start + i] = previous[delta_start + j] ;
+      vars_[a_start     + i] = previous[a_start     + j] ;
+    }
 
-  /*
-  for (int i = 0; i < N; i++) {
-    std::cout << solution.x[i + x_start] << " " << solution.x[i + y_start]
-              << " " << solution.x[i + psi_start] << " "
-              << solution.x[i + v_start] << " " << solution.x[i + cte_start]
-              << " " << solution.x[i + epsi_start] << std::endl;
+    vars_[x_start]    = state[0] ;
+    vars_[y_start]    = state[1] ;
+    vars_[psi_start]  = state[2] ;
+    vars_[v_start]    = state[3] ;
+    vars_[cte_start]  = state[4] ;
+    vars_[epsi_start] = state[5] ;
+
+    // same kinematic model as FG_eval
+    for (size_t i = 0; i < N - 1; i++) {
+
+      double x_t0     = vars_[x_start    + i] ;
+      double y_t0     = vars_[y_start    + i] ;
+      double psi_t0   = vars_[psi_start  + i] ;
+      double v_t0     = vars_[v_start    + i] ;
+      double e_psi_t0 = vars_[epsi_start + i] ;
+      double delta_t0 = vars_[delta_start + i] ;
+      double a_t0     = vars_[a_start     + i] ;
+
+      double f_t0 = p[0] + p[1] * x_t0 + p[2] * x_t0 * x_t0 + p[3] * (x_t0 * x_t0 * x_t0) ;
+      double psides_t0 = atan( p[1] + (2 * p[2] * x_t0) + (3 * p[3] * (x_t0 * x_t0)) ) ;
+
+      vars_[x_start    + i + 1] = x_t0 + v_t0 * cos(psi_t0) * dt ;
+      vars_[y_start    + i + 1] = y_t0 + v_t0 * sin(psi_t0) * dt ;
+      vars_[psi_start  + i + 1] = psi_t0 + v_t0 * delta_t0 / Lf * dt ;
+      vars_[v_start    + i + 1] = v_t0 + a_t0 * dt ;
+      vars_[cte_start  + i + 1] = (f_t0 - y_t0) + (v_t0 * sin(e_psi_t0) * dt) ;
+      vars_[epsi_start + i + 1] = (psi_t0 - psides_t0) + v_t0 * delta_t0 / Lf * dt ;
+    }
+
+    // constraints come in blocks of N per state, variables in blocks per state / actuator
+    const size_t state_starts[6] = { x_start, y_start, psi_start, v_start, cte_start, epsi_start } ;
+    for (size_t k = 0; k < 6; k++) {
+      shift(&lambda_[state_starts[k]], N) ;
+      shift(&z_L_[state_starts[k]], N) ;
+      shift(&z_U_[state_starts[k]], N) ;
+    }
+    shift(&z_L_[delta_start], N - 1) ;
+    shift(&z_U_[delta_start], N - 1) ;
+    shift(&z_L_[a_start], N - 1) ;
+    shift(&z_U_[a_start], N - 1) ;
   }
-  */
 
-  return results;
+  static void shift(double *v, size_t length) {
+    for (size_t i = 0; i + 1 < length; i++) {
+      v[i] = v[i + 1] ;
+    }
+  }
+};
+
+
+template <size_t N> constexpr size_t MPC_nlp<N>::n_vars ;
+template <size_t N> constexpr size_t MPC_nlp<N>::n_constraints ;
+
+
+/****************************************
+ * Horizons
+ ****************************************/
+
+/*
+Why?
+With N fixed at compile time the offsets are constants, all the storage is
+fixed size and every loop over the horizon has a known trip count. Each
+horizon we deploy gets its own compiled problem, MPC picks one at runtime.
+*/
+
+class MPC_solver {
+ public:
+  virtual ~MPC_solver() {}
+  virtual vector<double> Solve(MPC &mpc, const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs) = 0 ;
+};
+
+template <size_t N>
+class MPC_horizon : public MPC_solver {
+
+ public:
+
+  typedef MPC_layout<N> L ;
+
+  MPC_horizon(double dt) : dt(dt) {}
+
+  ~MPC_horizon() {
+    delete rti ;  // tnlp owns nlp
+  }
+
+  vector<double> Solve(MPC &mpc, const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs) {
+
+    double cost_final ;
+    const double *x = mpc.backend == MPC::RTI ? Solve_rti(mpc, state, coeffs, cost_final)
+                                              : Solve_ipopt(mpc, state, coeffs, cost_final) ;
+
+    // Cost
+    if (mpc.verbose) {
+      std::cout << "Cost " << cost_final << std::endl;
+    }
+    mpc.cost = cost_final ;
+
+    /****************************************
+     * Store values
+     ****************************************/
+
+    // store steering and throttle variables in class
+    // TODO rename all "delta" -> steering_angle and "a" -> throttle
+    // for clarity
+    mpc.steering_angle = x[ L::delta_start ] ;
+    mpc.throttle       = x[ L::a_start ] ;
+
+    MPC_trajectory &plan = mpc.trajectory ;
+    plan.cte.assign(x + L::cte_start, x + L::cte_start + N) ;
+    plan.epsi.assign(x + L::epsi_start, x + L::epsi_start + N) ;
+    plan.v.assign(x + L::v_start, x + L::v_start + N) ;
+    plan.delta.assign(x + L::delta_start, x + L::delta_start + N - 1) ;
+    plan.a.assign(x + L::a_start, x + L::a_start + N - 1) ;
+
+    vector<double> results ;
+    results.push_back(x[L::psi_start + 1]) ;
+    results.push_back(x[L::v_start + 1]) ;
+    results.push_back(x[L::cte_start + 1]) ;
+    results.push_back(x[L::epsi_start + 1]) ;
+
+    results.push_back(x[L::delta_start + 1]) ;
+    results.push_back(x[L::a_start + 1]) ;
+
+    /*
+    Why? We need to pass this for the prediction visauls
+    */
+    for (size_t i = 0 ;  i < N - 1  ;  i++) {
+      results.push_back(x[L::x_start + 1 + i]) ;
+      results.push_back(x[L::y_start + 1 + i]) ;
+    }
+
+    return results;
+  }
+
+ private:
+
+  double dt ;
+
+  MPC_nlp<N> *nlp = NULL ;
+  Ipopt::SmartPtr<Ipopt::TNLP> tnlp ;  // owns nlp
+  Ipopt::SmartPtr<Ipopt::IpoptApplication> app ;
+  bool solved_once = false ;
+
+  MPC_rti<N> *rti = NULL ;
+  bool solved_rti = false ;
+  array<double, L::n_vars> rti_vars ;
+
+  const double *Solve_ipopt(MPC &mpc, const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs,
+                            double &cost) {
+    bool ok = true;
+
+    // Tape once, the weights are dynamic parameters like the coeffs
+    if (nlp == NULL) {
+      start_ipopt() ;
+    }
+
+    bool warm = nlp->update(state, coeffs, mpc.weights, mpc.warm_start) ;
+
+    // Ipopt reads these at the start of every solve
+    app->Options()->SetStringValue("warm_start_init_point", warm ? "yes" : "no") ;
+    app->Options()->SetNumericValue("mu_init", warm ? 1e-6 : 0.1) ;
+    app->Options()->SetNumericValue("max_cpu_time", mpc.max_cpu_time) ;
+
+    // solve the problem, later solves reuse Ipopt's internal structures
+    Ipopt::ApplicationReturnStatus status ;
+    if (solved_once) {
+      status = app->ReOptimizeTNLP(tnlp) ;
+    }
+    else {
+      status = app->OptimizeTNLP(tnlp) ;
+      solved_once = true ;
+    }
+
+    // Check some of the solution values
+    ok &= status == Ipopt::Solve_Succeeded ;
+
+    mpc.converged  = ok ;
+    mpc.iterations = Ipopt::IsValid(app->Statistics()) ? app->Statistics()->IterationCount() : 0 ;
+    mpc.status       = status ;
+    mpc.warm_started = warm ;
+    mpc.constraint_violation = nlp->solution_constraint_violation ;
+
+    cost = nlp->solution_obj ;
+    return nlp->solution_x.data() ;
+  }
+
+  void start_ipopt() {
+
+    nlp  = new MPC_nlp<N>(dt) ;
+    tnlp = nlp ;
+    app  = IpoptApplicationFactory() ;
+
+    // options for IPOPT solver
+    app->Options()->SetIntegerValue("print_level", 0) ;
+    app->Options()->SetStringValue("sb", "yes") ;
+
+    // used when warm starting, keep the shifted point and multipliers where they are
+    app->Options()->SetNumericValue("warm_start_bound_push", 1e-6) ;
+    app->Options()->SetNumericValue("warm_start_mult_bound_push", 1e-6) ;
+
+    app->Initialize() ;
+  }
+
+  const double *Solve_rti(MPC &mpc, const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs,
+                          double &cost) {
+
+    if (rti == NULL) {
+      rti = new MPC_rti<N>(dt, Lf) ;
+    }
+    rti->w = mpc.weights ;
+
+    if (!mpc.warm_start) {
+      rti->reset() ;
+    }
+    rti->Solve(state, coeffs) ;
+
+    // same layout as the Ipopt variables
+    const size_t starts[6] = { L::x_start, L::y_start, L::psi_start, L::v_start, L::cte_start, L::epsi_start } ;
+    for (size_t t = 0; t < N; t++) {
+      for (size_t i = 0; i < 6; i++) {
+        rti_vars[starts[i] + t] = rti->s[t][i] ;
+      }
+    }
+    for (size_t t = 0; t < N - 1; t++) {
+      rti_vars[L::delta_start + t] = rti->u[t][0] ;
+      rti_vars[L::a_start     + t] = rti->u[t][1] ;
+    }
+
+    // the forward pass runs the nonlinear model, no defects left
+    mpc.converged  = true ;
+    mpc.iterations = rti->iterations ;
+    mpc.status       = 0 ;
+    mpc.warm_started = mpc.warm_start && solved_rti ;
+    mpc.constraint_violation = 0 ;
+    solved_rti = true ;
+
+    cost = rti->cost ;
+    return rti_vars.data() ;
+  }
+};
+
+
+template <size_t N>
+MPC_solver *make_horizon(double dt) {
+  return new MPC_horizon<N>(dt) ;
+}
+
+// The horizons we deploy, 9 here and 40 in src-files-play-p11.
+// A new one also needs its MPC_rti instantiation at the bottom of MPC_rti.cpp.
+static const struct {
+  size_t N ;
+  MPC_solver *(*make)(double dt) ;
+} horizon_table[] = {
+  {  9, make_horizon<9>  },
+  { 40, make_horizon<40> },
+};
+
+
+//
+// MPC class definition implementation.
+//
+MPC::MPC(size_t N, double dt) : N(N), dt(dt), solver(NULL) {
+
+  for (const auto &horizon : horizon_table) {
+    if (horizon.N == N) {
+      solver = horizon.make(dt) ;
+    }
+  }
+  if (solver == NULL) {
+    cout << "No MPC compiled for N = " << N << ", using N = 9" << endl ;
+    solver = make_horizon<9>(dt) ;
+    this->N = 9 ;
+  }
+}
+
+MPC::~MPC() {
+  delete solver ;
+}
+
+vector<size_t> MPC::horizons() {
+  vector<size_t> Ns ;
+  for (const auto &horizon : horizon_table) {
+    Ns.push_back(horizon.N) ;
+  }
+  return Ns ;
+}
+
+void MPC::Init(vector<double> coeff_hyper_parameters ){
+
+  /****************************************
+   * cost hyperparamters
+   ****************************************/
+
+  weights.cte           = coeff_hyper_parameters[0];
+  weights.epsi          = coeff_hyper_parameters[1];
+  weights.v             = coeff_hyper_parameters[2];
+  weights.val_throttle  = coeff_hyper_parameters[3];
+  weights.val_steering  = coeff_hyper_parameters[4];
+  weights.seq_throttle  = coeff_hyper_parameters[5];
+  weights.seq_steering  = coeff_hyper_parameters[6];
+}
+
+
+vector<double> MPC::Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now() ;
+  vector<double> results = solver->Solve(*this, state, coeffs) ;
+
+  if (stats != NULL) {
+    MPC_solve_record r ;
+    r.wall_ms      = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() ;
+    r.max_cpu_time = max_cpu_time ;
+    r.iterations   = iterations ;
+    r.status       = status ;
+    r.converged    = converged ;
+    r.constraint_violation = constraint_violation ;
+    r.objective    = cost ;
+    r.warm_start   = warm_started ;
+    stats->record(r) ;
+  }
+  return results ;
 }
@@ -6,14 +6,35 @@
 
 using namespace std;
 
-extern double coeff_cost_ref_cte ;
-extern double coeff_cost_ref_epsi ;
-extern double coeff_cost_ref_v ;
-extern double coeff_cost_ref_val_throttle ;
-extern double coeff_cost_ref_val_steering ;
-extern double coeff_cost_ref_seq_throttle ;
-extern double coeff_cost_ref_seq_steering ;
+// Cost weights, in the order of the command line, and the reference state
+struct MPC_weights {
+  double cte ;
+  double epsi ;
+  double v ;
+  double val_throttle ;
+  double val_steering ;
+  double seq_throttle ;
+  double seq_steering ;
 
+  double ref_cte  = 0 ;
+  double ref_epsi = 0 ;
+  double ref_v    = 115 ;
+};
+
+
+// The solved trajectory, cte, epsi and v for the N states, delta and a for
+// the N - 1 actuations
+struct MPC_trajectory {
+  vector<double> cte ;
+  vector<double> epsi ;
+  vector<double> v ;
+  vector<double> delta ;
+  vector<double> a ;
+};
+
+
+class MPC_solver;
+class MPC_stats;
 
 class MPC {
  public:
@@ -21,15 +42,60 @@ class MPC {
   double throttle ;
   double steering_angle ;
 
-  MPC();
+  // Set by Solve()
+  MPC_trajectory trajectory ;
+
+  // Horizon, steps of dt seconds
+  size_t N ;
+  double dt ;
+
+  // Start each solve from the last solution shifted one step, primal and dual
+  bool warm_start = true ;
+
+  // IPOPT solves the nonlinear problem, RTI takes one Riccati based SQP step
+  // per solve (see MPC_rti.h), fast enough for long horizons
+  enum Backend { IPOPT, RTI } ;
+  Backend backend = IPOPT ;
+
+  MPC_weights weights ;
+
+  // NOTE: Currently the solver has a maximum time limit of 0.5 seconds.
+  // Change this as you see fit.
+  double max_cpu_time = 0.5 ;
+
+  // Set by Solve(). Ipopt iterations or Riccati sweeps for RTI, RTI always
+  // counts as converged. status is Ipopt's ApplicationReturnStatus (0 for
+  // RTI), constraint_violation the largest model constraint residual.
+  int iterations = 0 ;
+  bool converged = false ;
+  double cost = 0 ;
+  int status = 0 ;
+  double constraint_violation = 0 ;
+  bool warm_started = false ;
+
+  // If set, every Solve() is recorded there, see MPC_stats.h
+  MPC_stats *stats = NULL ;
+
+  // Print the cost of every solve
+  bool verbose = true ;
+
+  // The problem is compiled per horizon, N has to be one of horizons()
+  MPC(size_t N = 9, double dt = .035);
 
   virtual ~MPC();
 
-  // Solve the model given an initial state and polynomial coefficients.
-  // Return the first actuatotions.
+  static vector<size_t> horizons() ;
+
+  // Set the cost weights, can be changed between solves.
   void Init(vector<double> v) ;
 
+  // Solve the model given an initial state and polynomial coefficients.
+  // Return the first actuatotions.
   vector<double> Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs);
+
+ private:
+
+  MPC_solver *solver ;
 };
 
 #endif /* MPC_H */
@@ -0,0 +1,528 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "MPC_model.h"
+
+using namespace std ;
+
+/*
+Build step, writes the MPC cost, constraints and their derivatives out as
+plain C++ so Ipopt doesn't have to walk a CppAD tape.
+
+  mpc_codegen MPC_derivatives.h MPC_derivatives.cpp 9 40
+
+FG_eval is run once per horizon with Sym as the scalar, which records the
+expression graph like CppAD does. The graph is then differentiated
+symbolically (constants folded, common subexpressions shared) and every
+function is printed as one assignment per node, with the sparsity patterns
+as constant tables. MPC_nlp uses the result through MPC_derivatives<N>.
+*/
+
+
+/****************************************
+ * Expression graph
+ ****************************************/
+
+enum Op { CONST, VAR, PARAM, WEIGHT, ADD, SUB, MUL, DIV, NEG, SIN, COS, ATAN } ;
+
+struct Node {
+  Op op ;
+  int a, b ;      // operands
+  int index ;     // VAR, PARAM and WEIGHT
+  double value ;  // CONST
+};
+
+// Nodes are only ever appended, so operands always come before their users
+class Graph {
+
+ public:
+
+  vector<Node> nodes ;
+
+  int constant(double value) { return add(CONST, -1, -1, 0, value) ; }
+  int leaf(Op op, int index) { return add(op, -1, -1, index, 0) ; }
+
+  bool is_constant(int n, double value) const {
+    return nodes[n].op == CONST && nodes[n].value == value ;
+  }
+
+  // VAR indices n depends on, sorted
+  const vector<int> &variables(int n) const { return variables_[n] ; }
+
+  int unary(Op op, int a) {
+
+    if (nodes[a].op == CONST) {
+      double x = nodes[a].value ;
+      switch (op) {
+        case NEG:  return constant(-x) ;
+        case SIN:  return constant(sin(x)) ;
+        case COS:  return constant(cos(x)) ;
+        case ATAN: return constant(atan(x)) ;
+        default:   break ;
+      }
+    }
+    if (op == NEG && nodes[a].op == NEG) { return nodes[a].a ; }
+
+    return add(op, a, -1, 0, 0) ;
+  }
+
+  int binary(Op op, int a, int b) {
+
+    if (nodes[a].op == CONST && nodes[b].op == CONST) {
+      double x = nodes[a].value, y = nodes[b].value ;
+      switch (op) {
+        case ADD: return constant(x + y) ;
+        case SUB: return constant(x - y) ;
+        case MUL: return constant(x * y) ;
+        case DIV: return constant(x / y) ;
+        default:  break ;
+      }
+    }
+
+    switch (op) {
+      case ADD:
+        if (is_constant(a, 0)) { return b ; }
+        if (is_constant(b, 0)) { return a ; }
+        if (a > b) { swap(a, b) ; }
+        break ;
+      case SUB:
+        if (is_constant(b, 0)) { return a ; }
+        if (is_constant(a, 0)) { return unary(NEG, b) ; }
+        if (a == b)            { return constant(0) ; }
+        break ;
+      case MUL:
+        if (is_constant(a, 0) || is_constant(b, 0)) { return constant(0) ; }
+        if (is_constant(a, 1))  { return b ; }
+        if (is_constant(b, 1))  { return a ; }
+        if (is_constant(a, -1)) { return unary(NEG, b) ; }
+        if (is_constant(b, -1)) { return unary(NEG, a) ; }
+        if (a > b) { swap(a, b) ; }
+        break ;
+      case DIV:
+        if (is_constant(a, 0)) { return constant(0) ; }
+        if (is_constant(b, 1)) { return a ; }
+        break ;
+      default:
+        break ;
+    }
+
+    return add(op, a, b, 0, 0) ;
+  }
+
+  // d n / d vars[var]
+  int derivative(int n, int var) {
+
+    const vector<int> &depends = variables_[n] ;
+    if (!binary_search(depends.begin(), depends.end(), var)) { return constant(0) ; }
+
+    map<pair<int, int>, int>::iterator found = derivatives_.find(make_pair(n, var)) ;
+    if (found != derivatives_.end()) { return found->second ; }
+
+    const Node node = nodes[n] ;
+    int d ;
+    switch (node.op) {
+      case VAR:
+        d = constant(1) ;
+        break ;
+      case ADD:
+        d = binary(ADD, derivative(node.a, var), derivative(node.b, var)) ;
+        break ;
+      case SUB:
+        d = binary(SUB, derivative(node.a, var), derivative(node.b, var)) ;
+        break ;
+      case NEG:
+        d = unary(NEG, derivative(node.a, var)) ;
+        break ;
+      case MUL:
+        d = binary(ADD, binary(MUL, derivative(node.a, var), node.b),
+                        binary(MUL, node.a, derivative(node.b, var))) ;
+        break ;
+      case DIV:
+        // (a' - (a / b) b') / b
+        d = binary(DIV, binary(SUB, derivative(node.a, var), binary(MUL, n, derivative(node.b, var))),
+                   node.b) ;
+        break ;
+      case SIN:
+        d = binary(MUL, unary(COS, node.a), derivative(node.a, var)) ;
+        break ;
+      case COS:
+        d = unary(NEG, binary(MUL, unary(SIN, node.a), derivative(node.a, var))) ;
+        break ;
+      case ATAN:
+        d = binary(DIV, derivative(node.a, var),
+                   binary(ADD, constant(1), binary(MUL, node.a, node.a))) ;
+        break ;
+      default:
+        d = constant(0) ;
+        break ;
+    }
+
+    derivatives_[make_pair(n, var)] = d ;
+    return d ;
+  }
+
+ private:
+
+  map<tuple<int, int, int, int, double>, int> unique_ ;
+  vector<vector<int> > variables_ ;
+  map<pair<int, int>, int> derivatives_ ;
+
+  int add(Op op, int a, int b, int index, double value) {
+
+    tuple<int, int, int, int, double> key(op, a, b, index, value) ;
+    map<tuple<int, int, int, int, double>, int>::iterator found = unique_.find(key) ;
+    if (found != unique_.end()) { return found->second ; }
+
+    Node node = { op, a, b, index, value } ;
+    nodes.push_back(node) ;
+
+    vector<int> depends ;
+    if (op == VAR) {
+      depends.push_back(index) ;
+    }
+    if (a >= 0 && b >= 0) {
+      set_union(variables_[a].begin(), variables_[a].end(), variables_[b].begin(), variables_[b].end(),
+                back_inserter(depends)) ;
+    }
+    else if (a >= 0) {
+      depends = variables_[a] ;
+    }
+    variables_.push_back(depends) ;
+
+    int n = nodes.size() - 1 ;
+    unique_[key] = n ;
+    return n ;
+  }
+};
+
+static Graph graph ;
+
+
+/****************************************
+ * Symbolic scalar for FG_eval
+ ****************************************/
+
+struct Sym {
+
+  int id ;
+
+  Sym() : id(graph.constant(0)) {}
+  Sym(double value) : id(graph.constant(value)) {}
+
+  static Sym node(int id) {
+    Sym s ;
+    s.id = id ;
+    return s ;
+  }
+
+  Sym &operator+=(const Sym &b) {
+    id = graph.binary(ADD, id, b.id) ;
+    return *this ;
+  }
+};
+
+Sym operator+(const Sym &a, const Sym &b) { return Sym::node(graph.binary(ADD, a.id, b.id)) ; }
+Sym operator-(const Sym &a, const Sym &b) { return Sym::node(graph.binary(SUB, a.id, b.id)) ; }
+Sym operator*(const Sym &a, const Sym &b) { return Sym::node(graph.binary(MUL, a.id, b.id)) ; }
+Sym operator/(const Sym &a, const Sym &b) { return Sym::node(graph.binary(DIV, a.id, b.id)) ; }
+Sym operator-(const Sym &a) { return Sym::node(graph.unary(NEG, a.id)) ; }
+
+Sym sin(const Sym &a)  { return Sym::node(graph.unary(SIN, a.id)) ; }
+Sym cos(const Sym &a)  { return Sym::node(graph.unary(COS, a.id)) ; }
+Sym atan(const Sym &a) { return Sym::node(graph.unary(ATAN, a.id)) ; }
+
+Sym pow(const Sym &a, int n) {
+  Sym result(1) ;
+  for (int i = 0; i < n; i++) {
+    result = result * a ;
+  }
+  return result ;
+}
+
+
+/****************************************
+ * Printing
+ ****************************************/
+
+static string name(int n) {
+
+  const Node &node = graph.nodes[n] ;
+  char buffer[64] ;
+  switch (node.op) {
+    case CONST:
+      snprintf(buffer, sizeof(buffer), node.value < 0 ? "(%.17g)" : "%.17g", node.value) ;
+      break ;
+    case VAR:
+      snprintf(buffer, sizeof(buffer), "x[%d]", node.index) ;
+      break ;
+    case PARAM:
+      snprintf(buffer, sizeof(buffer), "p[%d]", node.index) ;
+      break ;
+    case WEIGHT:
+      if (node.index == 0) { snprintf(buffer, sizeof(buffer), "obj_factor") ; }
+      else                 { snprintf(buffer, sizeof(buffer), "lambda[%d]", node.index - 1) ; }
+      break ;
+    default:
+      snprintf(buffer, sizeof(buffer), "t%d", n) ;
+      break ;
+  }
+  return buffer ;
+}
+
+static string expression(int n) {
+
+  const Node &node = graph.nodes[n] ;
+  switch (node.op) {
+    case ADD:  return name(node.a) + " + " + name(node.b) ;
+    case SUB:  return name(node.a) + " - " + name(node.b) ;
+    case MUL:  return name(node.a) + " * " + name(node.b) ;
+    case DIV:  return name(node.a) + " / " + name(node.b) ;
+    case NEG:  return "-" + name(node.a) ;
+    case SIN:  return "sin(" + name(node.a) + ")" ;
+    case COS:  return "cos(" + name(node.a) + ")" ;
+    case ATAN: return "atan(" + name(node.a) + ")" ;
+    default:   return name(n) ;
+  }
+}
+
+// One temporary per node the outputs need, in graph order
+static void print_body(FILE *out, const vector<int> &outputs) {
+
+  vector<bool> needed(graph.nodes.size(), false) ;
+  vector<int> stack(outputs) ;
+  while (!stack.empty()) {
+    int n = stack.back() ;
+    stack.pop_back() ;
+    if (needed[n]) { continue ; }
+    needed[n] = true ;
+    if (graph.nodes[n].a >= 0) { stack.push_back(graph.nodes[n].a) ; }
+    if (graph.nodes[n].b >= 0) { stack.push_back(graph.nodes[n].b) ; }
+  }
+
+  for (size_t n = 0; n < graph.nodes.size(); n++) {
+    if (needed[n] && graph.nodes[n].a >= 0) {
+      fprintf(out, "  const double t%d = %s ;\n", (int)n, expression(n).c_str()) ;
+    }
+  }
+}
+
+static void print_outputs(FILE *out, const char *array, const vector<int> &outputs) {
+  for (size_t i = 0; i < outputs.size(); i++) {
+    fprintf(out, "  %s[%d] = %s ;\n", array, (int)i, name(outputs[i]).c_str()) ;
+  }
+}
+
+static void print_table(FILE *out, const char *type, size_t N, const char *table, const vector<int> &values) {
+  fprintf(out, "const %s MPC_derivatives<%d>::%s[] = {", type, (int)N, table) ;
+  for (size_t k = 0; k < values.size(); k++) {
+    fprintf(out, k % 16 == 0 ? "\n  %d," : " %d,", values[k]) ;
+  }
+  fprintf(out, "\n} ;\n\n") ;
+}
+
+
+/****************************************
+ * Generate one horizon
+ ****************************************/
+
+template <size_t N>
+void generate(FILE *header, FILE *source) {
+
+  typedef MPC_layout<N> L ;
+
+  graph = Graph() ;
+
+  vector<Sym> vars(L::n_vars), p(N_PARAMETERS), fg(1 + L::n_constraints) ;
+  for (size_t i = 0; i < L::n_vars; i++) {
+    vars[i] = Sym::node(graph.leaf(VAR, i)) ;
+  }
+  for (size_t i = 0; i < N_PARAMETERS; i++) {
+    p[i] = Sym::node(graph.leaf(PARAM, i)) ;
+  }
+
+  FG_eval<N, vector<Sym> > fg_eval(p) ;
+  fg_eval(fg, vars) ;
+
+  vector<int> f(1, fg[0].id), g ;
+  for (size_t i = 0; i < L::n_constraints; i++) {
+    g.push_back(fg[1 + i].id) ;
+  }
+
+  // Cost gradient, dense
+  vector<int> grad ;
+  for (size_t j = 0; j < L::n_vars; j++) {
+    grad.push_back(graph.derivative(f[0], j)) ;
+  }
+
+  // Constraint Jacobian, row major
+  vector<int> jac, jac_row, jac_col ;
+  for (size_t i = 0; i < L::n_constraints; i++) {
+    const vector<int> depends = graph.variables(g[i]) ;
+    for (size_t k = 0; k < depends.size(); k++) {
+      int d = graph.derivative(g[i], depends[k]) ;
+      if (graph.is_constant(d, 0)) { continue ; }
+      jac.push_back(d) ;
+      jac_row.push_back(i) ;
+      jac_col.push_back(depends[k]) ;
+    }
+  }
+
+  // Lagrangian Hessian, obj_factor * cost + lambda' constraints, lower triangle
+  map<pair<int, int>, int> lagrangian ;
+  for (size_t i = 0; i <= L::n_constraints; i++) {
+
+    int weight = graph.leaf(WEIGHT, i) ;
+    int root   = fg[i].id ;
+
+    const vector<int> depends = graph.variables(root) ;
+    for (size_t a = 0; a < depends.size(); a++) {
+
+      int d = graph.derivative(root, depends[a]) ;
+      const vector<int> second = graph.variables(d) ;
+      for (size_t b = 0; b < second.size() && second[b] <= depends[a]; b++) {
+
+        int h = graph.derivative(d, second[b]) ;
+        if (graph.is_constant(h, 0)) { continue ; }
+
+        int term = graph.binary(MUL, weight, h) ;
+        pair<int, int> entry(depends[a], second[b]) ;
+        map<pair<int, int>, int>::iterator found = lagrangian.find(entry) ;
+        if (found == lagrangian.end()) { lagrangian[entry] = term ; }
+        else                           { found->second = graph.binary(ADD, found->second, term) ; }
+      }
+    }
+  }
+
+  vector<int> hes, hes_row, hes_col ;
+  for (map<pair<int, int>, int>::iterator it = lagrangian.begin(); it != lagrangian.end(); ++it) {
+    hes_row.push_back(it->first.first) ;
+    hes_col.push_back(it->first.second) ;
+    hes.push_back(it->second) ;
+  }
+
+  fprintf(stderr, "MPC_codegen N = %d: %d nodes, %d jacobian and %d hessian entries\n",
+          (int)N, (int)graph.nodes.size(), (int)jac.size(), (int)hes.size()) ;
+
+  // Declaration
+  fprintf(header,
+          "template <>\n"
+          "struct MPC_derivatives<%d> {\n"
+          "  static constexpr size_t jac_nnz = %d ;\n"
+          "  static constexpr size_t hes_nnz = %d ;\n"
+          "  static const int jac_row[jac_nnz], jac_col[jac_nnz] ;\n"
+          "  static const int hes_row[hes_nnz], hes_col[hes_nnz] ;\n"
+          "  static double f(const double *x, const double *p) ;\n"
+          "  static void g(const double *x, const double *p, double *g) ;\n"
+          "  static void grad_f(const double *x, const double *p, double *grad) ;\n"
+          "  static void jac_g(const double *x, const double *p, double *values) ;\n"
+          "  static void hes(const double *x, const double *p, double obj_factor, const double *lambda,\n"
+          "                  double *values) ;\n"
+          "};\n\n",
+          (int)N, (int)jac.size(), (int)hes.size()) ;
+
+  // Definitions
+  fprintf(source, "/**** N = %d ****/\n\n", (int)N) ;
+  fprintf(source, "constexpr size_t MPC_derivatives<%d>::jac_nnz ;\n", (int)N) ;
+  fprintf(source, "constexpr size_t MPC_derivatives<%d>::hes_nnz ;\n\n", (int)N) ;
+  print_table(source, "int", N, "jac_row", jac_row) ;
+  print_table(source, "int", N, "jac_col", jac_col) ;
+  print_table(source, "int", N, "hes_row", hes_row) ;
+  print_table(source, "int", N, "hes_col", hes_col) ;
+
+  fprintf(source, "double MPC_derivatives<%d>::f(const double *x, const double *p) {\n", (int)N) ;
+  print_body(source, f) ;
+  fprintf(source, "  return %s ;\n}\n\n", name(f[0]).c_str()) ;
+
+  fprintf(source, "void MPC_derivatives<%d>::g(const double *x, const double *p, double *g) {\n", (int)N) ;
+  print_body(source, g) ;
+  print_outputs(source, "g", g) ;
+  fprintf(source, "}\n\n") ;
+
+  fprintf(source, "void MPC_derivatives<%d>::grad_f(const double *x, const double *p, double *grad) {\n",
+          (int)N) ;
+  print_body(source, grad) ;
+  print_outputs(source, "grad", grad) ;
+  fprintf(source, "}\n\n") ;
+
+  fprintf(source, "void MPC_derivatives<%d>::jac_g(const double *x, const double *p, double *values) {\n",
+          (int)N) ;
+  print_body(source, jac) ;
+  print_outputs(source, "values", jac) ;
+  fprintf(source, "}\n\n") ;
+
+  fprintf(source, "void MPC_derivatives<%d>::hes(const double *x, const double *p, double obj_factor,\n"
+                  "                             const double *lambda, double *values) {\n", (int)N) ;
+  print_body(source, hes) ;
+  print_outputs(source, "values", hes) ;
+  fprintf(source, "}\n\n") ;
+}
+
+
+/****************************************
+ * Main
+ ****************************************/
+
+// The horizons MPC.cpp can be built with
+typedef void (*Generator)(FILE *header, FILE *source) ;
+
+static const struct {
+  size_t N ;
+  Generator generate ;
+} generators[] = {
+  {  9, generate<9>  },
+  { 40, generate<40> },
+};
+
+int main(int argc, const char *argv[]) {
+
+  if (argc < 4) {
+    fprintf(stderr, "Usage ./mpc_codegen MPC_derivatives.h MPC_derivatives.cpp N [N ...]\n") ;
+    return -1 ;
+  }
+
+  FILE *header = fopen(argv[1], "w") ;
+  FILE *source = fopen(argv[2], "w") ;
+  if (header == NULL || source == NULL) {
+    fprintf(stderr, "Can't write %s / %s\n", argv[1], argv[2]) ;
+    return -1 ;
+  }
+
+  fprintf(header,
+          "// Generated by mpc_codegen from FG_eval in MPC_model.h, don't edit.\n"
+          "#ifndef MPC_DERIVATIVES_H\n"
+          "#define MPC_DERIVATIVES_H\n\n"
+          "#include <cstddef>\n\n"
+          "// [cost, constraints] of MPC_layout<N> and their derivatives, p are the\n"
+          "// Parameter values. Sparse values follow the (row, col) tables, the\n"
+          "// Hessian is the lower triangle of obj_factor * f + lambda' g.\n"
+          "template <size_t N>\n"
+          "struct MPC_derivatives ;\n\n") ;
+  fprintf(source,
+          "// Generated by mpc_codegen from FG_eval in MPC_model.h, don't edit.\n"
+          "#include <cmath>\n"
+          "#include \"MPC_derivatives.h\"\n\n"
+          "using namespace std ;\n\n") ;
+
+  for (int i = 3; i < argc; i++) {
+
+    size_t N = atoi(argv[i]) ;
+    Generator generate = NULL ;
+    for (size_t k = 0; k < sizeof(generators) / sizeof(generators[0]); k++) {
+      if (generators[k].N == N) { generate = generators[k].generate ; }
+    }
+    if (generate == NULL) {
+      fprintf(stderr, "No horizon N = %s in MPC_codegen.cpp\n", argv[i]) ;
+      return -1 ;
+    }
+    generate(header, source) ;
+  }
+
+  fprintf(header, "#endif /* MPC_DERIVATIVES_H */\n") ;
+  fclose(header) ;
+  fclose(source) ;
+  return 0 ;
+}
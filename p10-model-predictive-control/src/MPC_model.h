@@ -0,0 +1,222 @@
+#ifndef MPC_MODEL_H
+#define MPC_MODEL_H
+
+#include <cmath>
+#include <cstddef>
+
+using namespace std;
+
+/*
+The MPC problem, shared by the solver (MPC.cpp) and the derivative code
+generator (MPC_codegen.cpp). FG_eval is written against any scalar type
+with the usual arithmetic and sin, cos, atan, pow found by lookup.
+*/
+
+// This value assumes the model presented in the classroom is used.
+//
+// It was obtained by measuring the radius formed by running the vehicle in the
+// simulator around in a circle with a constant steering angle and velocity on a
+// flat terrain.
+//
+// Lf was tuned until the the radius formed by the simulating the model
+// presented in the classroom matched the previous radius.
+//
+// This is the length from front to CoG that has a similar radius.
+const double Lf = 2.9;
+
+// A. Solver takes 1 vector.
+//  This is to create an index to access variables in that fector
+template <size_t N>
+struct MPC_layout {
+  static constexpr size_t x_start      = 0 ;
+  static constexpr size_t y_start      = x_start     + N ;
+  static constexpr size_t psi_start    = y_start     + N ;
+  static constexpr size_t v_start      = psi_start   + N ;
+  static constexpr size_t cte_start    = v_start     + N ;
+  static constexpr size_t epsi_start   = cte_start   + N ;
+  static constexpr size_t delta_start  = epsi_start  + N ;
+  static constexpr size_t a_start      = delta_start + N - 1 ;
+
+  static constexpr size_t n_vars        = a_start + N - 1 ;
+  static constexpr size_t n_constraints = N * 6 ;
+};
+
+template <size_t N> constexpr size_t MPC_layout<N>::x_start ;
+template <size_t N> constexpr size_t MPC_layout<N>::y_start ;
+template <size_t N> constexpr size_t MPC_layout<N>::psi_start ;
+template <size_t N> constexpr size_t MPC_layout<N>::v_start ;
+template <size_t N> constexpr size_t MPC_layout<N>::cte_start ;
+template <size_t N> constexpr size_t MPC_layout<N>::epsi_start ;
+template <size_t N> constexpr size_t MPC_layout<N>::delta_start ;
+template <size_t N> constexpr size_t MPC_layout<N>::a_start ;
+template <size_t N> constexpr size_t MPC_layout<N>::n_vars ;
+template <size_t N> constexpr size_t MPC_layout<N>::n_constraints ;
+/// end A.
+
+// Dynamic parameters, the polynomial coeffs, the time step then the weights.
+// Changing any of them doesn't need a new tape or new generated code.
+enum Parameter {
+  P_COEFFS = 0,
+  P_DT = 4,
+  P_CTE,
+  P_EPSI,
+  P_V,
+  P_VAL_THROTTLE,
+  P_VAL_STEERING,
+  P_SEQ_THROTTLE,
+  P_SEQ_STEERING,
+  P_REF_CTE,
+  P_REF_EPSI,
+  P_REF_V,
+  N_PARAMETERS
+};
+
+
+template <size_t N, class Vector>
+class FG_eval {
+
+ public:
+
+  typedef typename Vector::value_type Scalar;
+  typedef MPC_layout<N> L ;
+
+  // Dynamic parameters, see Parameter
+  Vector p;
+  FG_eval( const Vector &p) : p(p) {}
+
+  void operator()( Vector& fg, const Vector& vars) {
+
+    constexpr size_t x_start     = L::x_start ;
+    constexpr size_t y_start     = L::y_start ;
+    constexpr size_t psi_start   = L::psi_start ;
+    constexpr size_t v_start     = L::v_start ;
+    constexpr size_t cte_start   = L::cte_start ;
+    constexpr size_t epsi_start  = L::epsi_start ;
+    constexpr size_t delta_start = L::delta_start ;
+    constexpr size_t a_start     = L::a_start ;
+
+    const Scalar coeffs[4] = { p[P_COEFFS], p[P_COEFFS + 1], p[P_COEFFS + 2], p[P_COEFFS + 3] } ;
+    const Scalar dt = p[P_DT] ;
+
+    // `fg` is a vector containing the cost and constraints.
+    // `vars` is a vector containing the variable values (state & actuators).
+    // The cost is stored is the first element of `fg`.
+    // Any additions to the cost should be added to `fg[0]`.
+    // Reference State Cost
+
+    /****************************************
+     * Cost vectors
+     ****************************************/
+
+    /*
+    Why?
+    Later in our code solve() will need tounderstand what we care about 
+    */
+
+    fg[0] = 0 ;
+
+    // Cost for reference state
+    for (size_t t = 0;   t < N;  t++) {
+      fg[0] += p[P_CTE]   * pow( vars[cte_start + t]   - p[P_REF_CTE],  2) ;
+      fg[0] += p[P_EPSI]  * pow( vars[epsi_start + t]  - p[P_REF_EPSI],  2) ;
+      fg[0] += p[P_V]     * pow( vars[v_start + t]     - p[P_REF_V],  2) ;
+    }
+
+    // Reduce actuators values
+    for (size_t t = 0;   t < (N - 1);    t++) {
+      fg[0] += p[P_VAL_STEERING] * pow( vars[delta_start + t],  2) ;
+      fg[0] += p[P_VAL_THROTTLE] * pow( vars[a_start     + t],  2) ;
+    }
+
+    // Reduce gap between actuations (sequence)
+    for (size_t t = 0;   t < (N - 2);   t++) {
+
+      // (t + 1) - (t)
+      fg[0] += p[P_SEQ_STEERING] * pow( vars[delta_start + t + 1] - vars[delta_start + t],  2) ;
+      fg[0] += p[P_SEQ_THROTTLE] * pow( vars[a_start     + t + 1] - vars[a_start + t],  2) ;
+    }
+
+    /****************************************
+     * Initial constraints
+     ****************************************/
+
+    /*
+    Why is this next?
+    Solve() doesn't know the car can't teleport. We need to define what's reasonable
+
+    */
+
+    // We add 1 to each of the starting indices due to cost being located at
+    // index 0 of `fg`.
+    // This bumps up the position of all the other values.
+    fg[1 + x_start]     = vars[x_start];
+    fg[1 + y_start]     = vars[y_start];
+    fg[1 + psi_start]   = vars[psi_start];
+    fg[1 + v_start]     = vars[v_start];
+    fg[1 + cte_start]   = vars[cte_start];
+    fg[1 + epsi_start]  = vars[epsi_start];
+
+    /****************************************
+     * Kinematic model
+     ****************************************/
+
+    for (size_t i = 0; i < N - 1; i++) {
+
+      // State time t + 1
+      Scalar x_t1     = vars[x_start    + i + 1] ;
+      Scalar y_t1     = vars[y_start    + i + 1] ;
+      Scalar psi_t1   = vars[psi_start  + i + 1] ;
+      Scalar v_t1     = vars[v_start    + i + 1] ;
+      Scalar cte_t1   = vars[cte_start  + i + 1] ;
+      Scalar e_psi_t1 = vars[epsi_start + i + 1] ;
+
+      // State at time t
+      Scalar x_t0     = vars[x_start    + i] ;
+      Scalar y_t0     = vars[y_start    + i] ;
+      Scalar v_t0     = vars[v_start    + i] ;
+      Scalar psi_t0   = vars[psi_start  + i] ;
+      Scalar cte_t0   = vars[cte_start  + i] ;
+      Scalar e_psi_t0 = vars[epsi_start + i] ;
+
+      Scalar delta_t0 = vars[delta_start + i] ;
+      Scalar a_t0     = vars[a_start      + i] ;
+
+      // for 3rd degree polynomial
+      Scalar f_t0 = coeffs[0] + 
+                        coeffs[1] * x_t0 + 
+                        coeffs[2] * x_t0 * x_t0 +
+                        coeffs[3] * (x_t0 * x_t0 * x_t0) ;
+      
+      // rate of cahnge of f0
+      Scalar f_t0_rate_of_change = coeffs[1] +
+                                       (2 * coeffs[2] * x_t0) +
+                                       (3 * coeffs[3] * (x_t0 * x_t0) );       
+       
+      Scalar psides_t0 = atan( f_t0_rate_of_change) ;
+
+
+      // Here's `x` to get you started.
+      // The idea here is to constraint this value to be 0.
+      //
+      // NOTE: The use of `Scalar`! The same code is taped by CppAD
+      // and traced symbolically by MPC_codegen to get the derivatives
+      // for the solver.
+
+      fg[2 + x_start + i]    = x_t1   - (x_t0 + v_t0 * cos(psi_t0) * dt ) ;
+      fg[2 + y_start + i]    = y_t1   - (y_t0 + v_t0 * sin(psi_t0) * dt ) ;
+
+      fg[2 + psi_start + i]  = psi_t1 - (psi_t0 + v_t0 * delta_t0 / Lf * dt ) ;
+
+      fg[2 + v_start + i]    = v_t1   - (v_t0 + a_t0 * dt) ;
+
+      fg[2 + cte_start + i]  = cte_t1 - ( (f_t0 - y_t0) + 
+                              (v_t0 * sin(e_psi_t0) * dt) ) ;
+      
+      fg[2 + epsi_start + i] = e_psi_t1 - ( ( psi_t0 - psides_t0) + 
+                               v_t0 * delta_t0 / Lf * dt ) ;
+
+    }
+  }
+};
+
+#endif /* MPC_MODEL_H */
@@ -0,0 +1,262 @@
+#include "MPC_multi.h"
+#include <algorithm>
+#include <cmath>
+#include "MPC_stats.h"
+#include <coin/IpoptConfig.h>
+
+// MUMPS, Ipopt's default linear solver, only takes calls from several threads from 3.14 on
+#if defined(IPOPT_VERSION_MAJOR) && defined(IPOPT_VERSION_MINOR) && \
+    (IPOPT_VERSION_MAJOR > 3 || (IPOPT_VERSION_MAJOR == 3 && IPOPT_VERSION_MINOR >= 14))
+#define MPC_PARALLEL_IPOPT
+#endif
+
+using namespace std ;
+
+
+MPC_multi::MPC_multi(const vector<MPC_variant> &variants)
+    : wins(variants.size(), 0), failures(variants.size(), 0), late(variants.size(), 0),
+      variants_(variants) {
+
+  for (size_t i = 0; i < variants_.size(); i++) {
+    Worker *w = new Worker() ;
+    w->mpc = new MPC(variants_[i].N, variants_[i].dt) ;
+    w->mpc->weights = variants_[i].weights ;
+    w->mpc->backend = variants_[i].backend ;
+    w->mpc->verbose = false ;
+    workers_.push_back(w) ;
+  }
+  window_ = HUGE_VAL ;
+  for (size_t i = 0; i < workers_.size(); i++) {
+    window_ = min(window_, (workers_[i]->mpc->N - 1) * workers_[i]->mpc->dt) ;
+  }
+
+  for (size_t i = 0; i < workers_.size(); i++) {
+    workers_[i]->runner = thread(&MPC_multi::work, this, i) ;
+  }
+}
+
+MPC_multi::~MPC_multi() {
+
+  {
+    lock_guard<mutex> guard(lock_) ;
+    stop_ = true ;
+  }
+  wake_.notify_all() ;
+
+  for (size_t i = 0; i < workers_.size(); i++) {
+    workers_[i]->runner.join() ;
+    delete workers_[i]->mpc ;
+    delete workers_[i] ;
+  }
+}
+
+
+vector<MPC_variant> MPC_multi::default_variants(const MPC_variant &primary) {
+
+  MPC_variant slower = primary ;
+  slower.name = "slower" ;
+  slower.weights.ref_v *= .8 ;
+
+  MPC_variant smoother = primary ;
+  smoother.name = "smoother" ;
+  smoother.weights.seq_steering *= 4 ;
+
+  MPC_variant long_horizon = primary ;
+  long_horizon.name    = "long horizon" ;
+  long_horizon.N       = 40 ;
+  long_horizon.backend = MPC::RTI ;
+
+  return { primary, slower, smoother, long_horizon } ;
+}
+
+
+vector<double> MPC_multi::Solve(const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs) {
+
+  Clock::time_point start = Clock::now() ;
+  Clock::time_point due   = start + chrono::microseconds((long long)(deadline * 1e6)) ;
+  Clock::time_point limit = start + chrono::microseconds((long long)(max(deadline, timeout) * 1e6)) ;
+
+  unique_lock<mutex> guard(lock_) ;
+
+  // Hand the frame to every idle variant
+  job_++ ;
+  vector<Worker*> posted ;
+  for (size_t i = 0; i < workers_.size(); i++) {
+    Worker *w = workers_[i] ;
+    if (w->job != w->done) {
+      continue ;
+    }
+    w->job    = job_ ;
+    w->state  = state ;
+    w->coeffs = coeffs ;
+    posted.push_back(w) ;
+  }
+  wake_.notify_all() ;
+
+  // All of them, after the deadline the first feasible one, or none by the
+  // timeout
+  while (true) {
+    size_t done = 0 ;
+    bool feasible = false ;
+    for (size_t i = 0; i < posted.size(); i++) {
+      if (posted[i]->done == job_) {
+        done++ ;
+        feasible |= posted[i]->feasible ;
+      }
+    }
+    if (done == posted.size()) {
+      break ;
+    }
+    if (Clock::now() < due) {
+      finished_.wait_until(guard, due) ;
+    }
+    else if (feasible) {
+      break ;
+    }
+    else if (finished_.wait_until(guard, limit) == cv_status::timeout) {
+      break ;
+    }
+  }
+
+  // Lowest score, a switch to another variant has to win by switch_margin
+  int last = chosen ;
+  double best = HUGE_VAL ;
+  chosen = -1 ;
+  for (size_t i = 0; i < workers_.size(); i++) {
+    Worker *w = workers_[i] ;
+    if (w->done != job_) {
+      late[i]++ ;
+      continue ;
+    }
+    if (!w->feasible) {
+      failures[i]++ ;
+      continue ;
+    }
+    double s = w->score * ((int)i == last ? 1. : 1. + switch_margin) ;
+    if (chosen < 0 || s < best) {
+      chosen = i ;
+      best   = s ;
+      score  = w->score ;
+    }
+  }
+
+  vector<double> results ;
+  if (chosen < 0) {
+    fallback() ;
+    results = last_results_ ;
+  }
+  else {
+    Worker *w = workers_[chosen] ;
+    wins[chosen]++ ;
+    converged      = true ;
+    iterations     = w->mpc->iterations ;
+    throttle       = w->mpc->throttle ;
+    steering_angle = w->mpc->steering_angle ;
+    results        = w->results ;
+
+    last_         = w->mpc->trajectory ;
+    last_results_ = results ;
+    last_step_    = 0 ;
+  }
+
+  if (stats != NULL) {
+    MPC_solve_record r ;
+    r.wall_ms      = chrono::duration<double, milli>(Clock::now() - start).count() ;
+    r.max_cpu_time = deadline ;
+    r.iterations   = iterations ;
+    r.status       = chosen < 0 ? -1 : workers_[chosen]->mpc->status ;
+    r.converged    = converged ;
+    r.constraint_violation = chosen < 0 ? HUGE_VAL : workers_[chosen]->mpc->constraint_violation ;
+    r.objective    = score ;
+    r.warm_start   = chosen >= 0 && workers_[chosen]->mpc->warm_started ;
+    stats->record(r) ;
+  }
+
+  return results ;
+}
+
+// Nothing feasible this frame, go on with the last plan
+void MPC_multi::fallback() {
+
+  converged  = false ;
+  score      = HUGE_VAL ;
+  iterations = 0 ;
+  if (last_step_ + 1 < last_.delta.size()) {
+    last_step_++ ;
+    steering_angle = last_.delta[last_step_] ;
+    throttle       = last_.a[last_step_] ;
+  }
+}
+
+
+/****************************************
+ * Workers
+ ****************************************/
+
+void MPC_multi::work(size_t i) {
+
+  Worker *w = workers_[i] ;
+
+  unique_lock<mutex> guard(lock_) ;
+  while (true) {
+
+    wake_.wait(guard, [this, w] { return stop_ || w->job != w->done ; }) ;
+    if (stop_) { return ; }
+
+    size_t job = w->job ;
+    double steering = steering_angle ;   // the last command, for the score
+    double throttle = this->throttle ;
+    guard.unlock() ;
+
+    unique_lock<mutex> ipopt(ipopt_lock_, defer_lock) ;
+#if !defined(MPC_PARALLEL_IPOPT) || !defined(MPC_GENERATED_DERIVATIVES)
+    if (w->mpc->backend == MPC::IPOPT) {
+      ipopt.lock() ;
+    }
+#endif
+    vector<double> results = w->mpc->Solve(w->state, w->coeffs) ;
+    if (ipopt.owns_lock()) {
+      ipopt.unlock() ;
+    }
+    bool feasible = w->mpc->converged && w->mpc->constraint_violation <= feasibility_tol ;
+    double score  = feasible ? evaluate(*w->mpc, steering, throttle) : HUGE_VAL ;
+
+    guard.lock() ;
+    w->results.swap(results) ;
+    w->feasible = feasible ;
+    w->score    = score ;
+    w->done     = job ;
+    finished_.notify_all() ;
+  }
+}
+
+// FG_eval's cost of the plan with the primary variant's weights, over the
+// shortest variant's horizon and per stage so different dt compare
+double MPC_multi::evaluate(const MPC &mpc, double steering, double throttle) const {
+
+  const MPC_weights &w = variants_[0].weights ;
+  const MPC_trajectory &p = mpc.trajectory ;
+
+  size_t n = min(p.cte.size(), (size_t)(window_ / mpc.dt + 1e-9) + 1) ;
+
+  double cost = 0 ;
+  for (size_t t = 0; t < n; t++) {
+    cost += w.cte  * pow(p.cte[t]  - w.ref_cte,  2) ;
+    cost += w.epsi * pow(p.epsi[t] - w.ref_epsi, 2) ;
+    cost += w.v    * pow(p.v[t]    - w.ref_v,    2) ;
+  }
+  for (size_t t = 0; t + 1 < n; t++) {
+    cost += w.val_steering * pow(p.delta[t], 2) ;
+    cost += w.val_throttle * pow(p.a[t], 2) ;
+  }
+  for (size_t t = 0; t + 2 < n; t++) {
+    cost += w.seq_steering * pow(p.delta[t + 1] - p.delta[t], 2) ;
+    cost += w.seq_throttle * pow(p.a[t + 1] - p.a[t], 2) ;
+  }
+
+  // and from the command sent last, so switching plans isn't free
+  cost += w.seq_steering * pow(p.delta[0] - steering, 2) ;
+  cost += w.seq_throttle * pow(p.a[0] - throttle, 2) ;
+
+  return cost / n ;
+}
@@ -0,0 +1,136 @@
+#ifndef MPC_MULTI_H
+#define MPC_MULTI_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Eigen-3.3/Eigen/Core"
+#include "MPC.h"
+
+using namespace std;
+
+class MPC_stats;
+
+/*
+Solves several variants of the problem at once and sends the best plan.
+
+  Solve() -> every idle variant's worker -> wait for all, or the deadline
+          -> lowest score among the feasible plans
+
+Each variant has its own MPC and thread, so they differ freely in N / dt,
+backend and weights (ref_v included). Costs of different weights and
+horizons don't compare, so every plan is scored again with variants[0]'s
+weights over the shortest horizon, per stage.
+
+After the deadline the first feasible plan is taken. A variant still
+solving is skipped until it's done. If none is feasible by the timeout the
+last plan, shifted one step, is kept rather than sending what a failed
+solve left or waiting on.
+
+Ipopt variants in parallel need a thread safe linear solver, MUMPS is
+only safe from Ipopt 3.14 on (it serializes the calls), so with an older
+Ipopt the Ipopt solves take turns. Without MPC_GENERATED_DERIVATIVES they
+also walk CppAD tapes, and CppAD isn't set up for threads here, so they
+take turns whatever the version. RTI variants always run in parallel.
+*/
+
+struct MPC_variant {
+  string name ;
+  size_t N = 9 ;
+  double dt = .035 ;
+  MPC::Backend backend = MPC::IPOPT ;
+  MPC_weights weights ;
+};
+
+class MPC_multi {
+ public:
+
+  typedef chrono::steady_clock Clock ;
+
+  MPC_multi(const vector<MPC_variant> &variants) ;
+  virtual ~MPC_multi() ;
+
+  // Seconds from the start of Solve() to stop waiting for all variants
+  double deadline = .05 ;
+
+  // Seconds from the start of Solve() to stop waiting for a feasible plan
+  // and fall back to the last one, at least deadline
+  double timeout = .1 ;
+
+  // Largest constraint violation of a feasible plan
+  double feasibility_tol = 1e-6 ;
+
+  // Relative score another variant has to beat the last chosen one by
+  double switch_margin = .2 ;
+
+  // Set by Solve(), like MPC's. converged is false if no variant gave a
+  // feasible plan, the actuations are then the last plan's next step.
+  double throttle = 0 ;
+  double steering_angle = 0 ;
+  bool converged = false ;
+  int chosen = -1 ;           // index into variants
+  double score = 0 ;
+  int iterations = 0 ;        // the chosen variant's
+
+  // Per variant: plans chosen, failed or infeasible solves, and frames it
+  // had no plan for when one was picked (still busy or past the deadline)
+  vector<size_t> wins ;
+  vector<size_t> failures ;
+  vector<size_t> late ;
+
+  // If set, every Solve() is recorded there with the chosen variant's numbers
+  MPC_stats *stats = NULL ;
+
+  // Same results as MPC::Solve(), from the chosen plan
+  vector<double> Solve(const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs) ;
+
+  const vector<MPC_variant> &variants() const { return variants_ ; }
+
+  // primary, then slower (ref_v * .8), smoother (seq_steering * 4) and a
+  // 40 step RTI of it
+  static vector<MPC_variant> default_variants(const MPC_variant &primary) ;
+
+ private:
+
+  // mpc and results belong to the worker's thread while job != done
+  struct Worker {
+    MPC *mpc ;
+    thread runner ;
+
+    // under lock_
+    size_t job = 0 ;          // last job given
+    size_t done = 0 ;         // last job finished
+    Eigen::VectorXd state ;
+    Eigen::VectorXd coeffs ;
+    bool feasible = false ;
+    double score = 0 ;
+    vector<double> results ;
+  };
+
+  vector<MPC_variant> variants_ ;
+  vector<Worker*> workers_ ;
+  double window_ ;   // seconds, the shortest horizon, plans are scored over it
+
+  mutex lock_ ;
+  condition_variable wake_ ;      // workers wait for a job
+  condition_variable finished_ ;  // Solve() waits for the workers
+  size_t job_ = 0 ;
+  bool stop_ = false ;
+
+  // Held by an Ipopt variant's solve while those can't run in parallel
+  mutex ipopt_lock_ ;
+
+  // The last chosen plan, for the fallback
+  MPC_trajectory last_ ;
+  vector<double> last_results_ ;
+  size_t last_step_ = 0 ;
+
+  void work(size_t i) ;
+  double evaluate(const MPC &mpc, double steering, double throttle) const ;
+  void fallback() ;
+};
+
+#endif /* MPC_MULTI_H */
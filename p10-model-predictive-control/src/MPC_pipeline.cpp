@@ -0,0 +1,141 @@
+#include "MPC_pipeline.h"
+#include <iostream>
+
+using namespace std ;
+
+
+MPC_pipeline::MPC_pipeline(uS::Loop *loop, double latency)
+    : latency_(chrono::microseconds((long long)(latency * 1e6))), loop_(loop) {
+
+  solved_ = new uS::Async(loop_) ;
+  solved_->setData(this) ;
+  solved_->start([](uS::Async *async) {
+    ((MPC_pipeline*)async->getData())->schedule() ;
+  }) ;
+
+  worker_ = thread(&MPC_pipeline::work, this) ;
+}
+
+MPC_pipeline::~MPC_pipeline() {
+
+  {
+    lock_guard<mutex> guard(lock_) ;
+    stop_ = true ;
+  }
+  wake_.notify_one() ;
+  worker_.join() ;
+
+  for (size_t i = 0; i < done_.size(); i++) {
+    delete done_[i] ;
+  }
+  solved_->close() ;  // frees it
+}
+
+void MPC_pipeline::connected(Socket *ws) {
+  sockets_.insert(ws) ;
+}
+
+void MPC_pipeline::disconnected(Socket *ws) {
+
+  // replies already on their way are checked against sockets_ before sending
+  sockets_.erase(ws) ;
+
+  lock_guard<mutex> guard(lock_) ;
+  if (has_pending_ && pending_.ws == ws) {
+    has_pending_ = false ;
+    pending_.solve = Solve() ;
+  }
+}
+
+void MPC_pipeline::submit(Socket *ws, Clock::time_point received, Solve solve) {
+
+  {
+    lock_guard<mutex> guard(lock_) ;
+    if (has_pending_) {
+      dropped++ ;
+    }
+    pending_.ws    = ws ;
+    pending_.due   = received + latency_ ;
+    pending_.solve = solve ;
+    has_pending_   = true ;
+  }
+  wake_.notify_one() ;
+}
+
+
+/****************************************
+ * Worker thread
+ ****************************************/
+
+void MPC_pipeline::work() {
+
+  unique_lock<mutex> guard(lock_) ;
+  while (true) {
+
+    wake_.wait(guard, [this] { return has_pending_ || stop_ ; }) ;
+    if (stop_) { return ; }
+
+    Job job = pending_ ;
+    has_pending_ = false ;
+    pending_.solve = Solve() ;
+
+    guard.unlock() ;
+    Reply *reply = new Reply() ;
+    reply->pipeline = this ;
+    reply->ws       = job.ws ;
+    reply->due      = job.due ;
+    reply->msg      = job.solve() ;
+    guard.lock() ;
+
+    done_.push_back(reply) ;
+    solved_->send() ;
+  }
+}
+
+
+/****************************************
+ * Loop thread
+ ****************************************/
+
+// Start a timer for each finished solve, for what's left of its latency
+void MPC_pipeline::schedule() {
+
+  vector<Reply*> done ;
+  {
+    lock_guard<mutex> guard(lock_) ;
+    done.swap(done_) ;
+  }
+
+  Clock::time_point now = Clock::now() ;
+  for (size_t i = 0; i < done.size(); i++) {
+
+    Reply *reply = done[i] ;
+    if (now > reply->due) {
+      cout << "Solve overran the latency by "
+           << chrono::duration_cast<chrono::milliseconds>(now - reply->due).count() << " ms" << endl ;
+    }
+
+    // rounded up, never early
+    long long wait = chrono::duration_cast<chrono::milliseconds>(
+                       reply->due - now + chrono::microseconds(999)).count() ;
+
+    reply->timer = new uS::Timer(loop_) ;
+    reply->timer->setData(reply) ;
+    reply->timer->start([](uS::Timer *timer) {
+      Reply *reply = (Reply*)timer->getData() ;
+      reply->pipeline->send(reply) ;
+    }, wait > 0 ? (int)wait : 0, 0) ;
+  }
+}
+
+void MPC_pipeline::send(Reply *reply) {
+
+  if (sockets_.count(reply->ws)) {
+    reply->ws->send(reply->msg.data(), reply->msg.length(), uWS::OpCode::TEXT) ;
+  }
+
+  // stopped from its own callback, close() frees it
+  reply->timer->stop() ;
+  reply->timer->close() ;
+  delete reply ;
+}
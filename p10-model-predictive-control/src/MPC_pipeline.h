@@ -0,0 +1,91 @@
+#ifndef MPC_PIPELINE_H
+#define MPC_PIPELINE_H
+
+#include <uWS/uWS.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+Runs the solves off the uWS loop and sends each reply when its latency is
+up, without blocking the loop.
+
+  telemetry -> submit() -> worker thread solves -> uS::Async back on the loop
+            -> uS::Timer for what's left of the latency -> ws->send()
+
+The latency is counted from when the telemetry came in, which is the state
+main.cpp predicts forward. A new frame can be submitted while the last
+reply still waits in its timer, so solves overlap the latency window. If
+frames come faster than the solver only the newest waiting one is solved.
+
+uS::Async and uS::Timer are uWS's own handles, so this runs on whichever
+backend uWS was built with, epoll by default on Linux or libuv.
+*/
+
+class MPC_pipeline {
+ public:
+
+  typedef uWS::WebSocket<uWS::SERVER> Socket ;
+  typedef chrono::steady_clock Clock ;
+
+  // Runs on the worker thread, returns the message to send
+  typedef function<string()> Solve ;
+
+  MPC_pipeline(uS::Loop *loop, double latency) ;
+  virtual ~MPC_pipeline() ;
+
+  // Call from the loop thread
+  void connected(Socket *ws) ;
+  void disconnected(Socket *ws) ;
+
+  void submit(Socket *ws, Clock::time_point received, Solve solve) ;
+
+  // Frames replaced by a newer one before their solve started
+  size_t dropped = 0 ;
+
+ private:
+
+  struct Job {
+    Socket *ws ;
+    Clock::time_point due ;
+    Solve solve ;
+  };
+
+  struct Reply {
+    uS::Timer *timer ;
+    MPC_pipeline *pipeline ;
+    Socket *ws ;
+    Clock::time_point due ;
+    string msg ;
+  };
+
+  chrono::microseconds latency_ ;
+  uS::Loop *loop_ ;
+  uS::Async *solved_ ;
+
+  // Only touched on the loop thread
+  set<Socket*> sockets_ ;
+
+  // Shared with the worker
+  mutex lock_ ;
+  condition_variable wake_ ;
+  Job pending_ ;
+  bool has_pending_ = false ;
+  bool stop_ = false ;
+  vector<Reply*> done_ ;
+
+  thread worker_ ;
+
+  void work() ;
+  void schedule() ;
+  void send(Reply *reply) ;
+};
+
+#endif /* MPC_PIPELINE_H */
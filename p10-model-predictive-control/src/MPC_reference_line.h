@@ -0,0 +1,268 @@
+#ifndef MPC_REFERENCE_LINE_H
+#define MPC_REFERENCE_LINE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "Eigen-3.3/Eigen/Core"
+#include "Eigen-3.3/Eigen/Cholesky"
+
+using namespace std;
+
+/*
+Waypoints -> car space -> the cubic the MPC tracks, every frame.
+
+  y = c0 + c1 x + c2 x^2 + c3 x^3
+
+All storage is fixed size (up to max_points waypoints), nothing is
+allocated per frame. The least squares fit goes through the 4 x n pseudo
+inverse of the Vandermonde matrix, with x scaled to [-1, 1] first so the
+4 x 4 normal equations stay well conditioned. The pseudo inverse only
+depends on the x positions (and weights), so it's kept and reused while
+they repeat.
+
+fit_spline() is the alternative: a natural cubic spline through the
+points, coeffs is then the spline piece around the car (x = 0) as a cubic.
+
+Header only, the quizzes share it (quizes/fit_polynomials.cpp and
+quizes/CarND-MPC-Quizzes-master/polyfit).
+*/
+
+class Reference_line {
+ public:
+
+  static const int max_points = 16 ;
+
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, max_points, 1> Points ;
+  typedef Eigen::Matrix<double, 4, Eigen::Dynamic, 0, 4, max_points> Pseudo_inverse ;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  // Car space points of the last fit
+  Points x ;
+  Points y ;
+
+  // c0 .. c3
+  Eigen::Vector4d coeffs = Eigen::Vector4d::Zero() ;
+
+  // Map space waypoints and the car's pose. weights, if given, one per point.
+  void fit(const vector<double> &ptsx, const vector<double> &ptsy,
+           double px, double py, double psi, const double *weights = NULL) ;
+
+  // Points already in car space
+  void fit(const double *xs, const double *ys, int n, const double *weights = NULL) ;
+
+  // Natural cubic spline through the points of the last fit(), needs x
+  // strictly increasing. False (and the least squares fit kept) otherwise.
+  bool fit_spline() ;
+
+  // Horner, on the spline pieces after fit_spline()
+  double value(double at) const ;
+  double slope(double at) const ;
+  void eval(double at, double &value, double &slope) const ;
+
+ private:
+
+  // Least squares pseudo inverse and what it was built for
+  Pseudo_inverse pinv_ ;
+  Points pinv_x_ ;
+  Points pinv_w_ ;
+  bool pinv_weighted_ = false ;
+
+  // Spline second derivatives at x, valid while spline_
+  Points m_ ;
+  bool spline_ = false ;
+
+  void solve_pseudo_inverse(const double *weights) ;
+  bool same_pseudo_inverse(const double *weights) const ;
+  int piece(double at) const ;
+};
+
+
+inline void Reference_line::fit(const vector<double> &ptsx, const vector<double> &ptsy,
+                                double px, double py, double psi, const double *weights) {
+
+  const int n = ptsx.size() ;
+  assert(n >= 4 && n <= max_points && ptsy.size() == ptsx.size()) ;
+
+  // Convert map space to car space
+  const double c = cos(psi) ;
+  const double s = sin(psi) ;
+  x.resize(n) ;
+  y.resize(n) ;
+  for (int i = 0; i < n; i++) {
+    double dx = ptsx[i] - px ;
+    double dy = ptsy[i] - py ;
+    x[i] = dx * c + dy * s ;
+    y[i] = dy * c - dx * s ;
+  }
+
+  fit(x.data(), y.data(), n, weights) ;
+}
+
+inline void Reference_line::fit(const double *xs, const double *ys, int n, const double *weights) {
+
+  assert(n >= 4 && n <= max_points) ;
+
+  // may alias x and y, from the fit() above
+  if (xs != x.data()) {
+    x = Eigen::Map<const Eigen::VectorXd>(xs, n) ;
+    y = Eigen::Map<const Eigen::VectorXd>(ys, n) ;
+  }
+
+  if (!same_pseudo_inverse(weights)) {
+    solve_pseudo_inverse(weights) ;
+  }
+
+  coeffs  = pinv_ * y ;
+  spline_ = false ;
+}
+
+inline bool Reference_line::same_pseudo_inverse(const double *weights) const {
+
+  const int n = x.size() ;
+  if (pinv_x_.size() != n || pinv_weighted_ != (weights != NULL)) {
+    return false ;
+  }
+  if (memcmp(pinv_x_.data(), x.data(), n * sizeof(double)) != 0) {
+    return false ;
+  }
+  return weights == NULL || memcmp(pinv_w_.data(), weights, n * sizeof(double)) == 0 ;
+}
+
+/*
+Why scale? x runs to ~100 m ahead, x^6 in the normal equations would be
+1e12 next to 1. In t = x / scale the columns are all O(1), the scale is
+folded back into the rows of the pseudo inverse.
+*/
+inline void Reference_line::solve_pseudo_inverse(const double *weights) {
+
+  const int n = x.size() ;
+
+  double scale = 0 ;
+  for (int i = 0; i < n; i++) {
+    scale = max(scale, fabs(x[i])) ;
+  }
+  if (scale == 0) {
+    scale = 1 ;
+  }
+
+  // Weighted Vandermonde rows, transposed
+  Pseudo_inverse VtW(4, n) ;
+  Eigen::Matrix4d VtWV = Eigen::Matrix4d::Zero() ;
+  for (int i = 0; i < n; i++) {
+    double t = x[i] / scale ;
+    double w = weights != NULL ? weights[i] : 1. ;
+    Eigen::Vector4d v(1, t, t * t, t * t * t) ;
+    VtW.col(i) = w * v ;
+    VtWV.noalias() += w * v * v.transpose() ;
+  }
+
+  pinv_ = VtWV.ldlt().solve(VtW) ;
+
+  double power = 1 ;
+  for (int k = 0; k < 4; k++) {
+    pinv_.row(k) /= power ;
+    power *= scale ;
+  }
+
+  pinv_x_ = x ;
+  pinv_weighted_ = weights != NULL ;
+  if (weights != NULL) {
+    pinv_w_ = Eigen::Map<const Eigen::VectorXd>(weights, n) ;
+  }
+}
+
+
+/****************************************
+ * Spline
+ ****************************************/
+
+inline bool Reference_line::fit_spline() {
+
+  const int n = x.size() ;
+  for (int i = 0; i + 1 < n; i++) {
+    if (!(x[i + 1] > x[i])) {
+      return false ;
+    }
+  }
+
+  // Tridiagonal system for the second derivatives, m_0 = m_n-1 = 0
+  // (natural ends), Thomas algorithm
+  double c_prime[max_points] ;
+  double d_prime[max_points] ;
+  m_.setZero(n) ;
+  c_prime[0] = 0 ;
+  d_prime[0] = 0 ;
+  for (int i = 1; i + 1 < n; i++) {
+    double h0 = x[i] - x[i - 1] ;
+    double h1 = x[i + 1] - x[i] ;
+    double a  = h0 / 6 ;
+    double b  = (h0 + h1) / 3 ;
+    double c  = h1 / 6 ;
+    double d  = (y[i + 1] - y[i]) / h1 - (y[i] - y[i - 1]) / h0 ;
+    double denom = b - a * c_prime[i - 1] ;
+    c_prime[i] = c / denom ;
+    d_prime[i] = (d - a * d_prime[i - 1]) / denom ;
+  }
+  for (int i = n - 2; i >= 1; i--) {
+    m_[i] = d_prime[i] - c_prime[i] * m_[i + 1] ;
+  }
+  spline_ = true ;
+
+  // The piece around the car as a cubic in x, Taylor at 0
+  double v, dv ;
+  eval(0, v, dv) ;
+  int i = piece(0) ;
+  double h = x[i + 1] - x[i] ;
+  double a = (x[i + 1] - 0) / h ;
+  double b = (0 - x[i]) / h ;
+  coeffs << v, dv, (a * m_[i] + b * m_[i + 1]) / 2, (m_[i + 1] - m_[i]) / (6 * h) ;
+  return true ;
+}
+
+// The piece at, the end pieces extrapolate
+inline int Reference_line::piece(double at) const {
+  int i = 0 ;
+  while (i + 2 < x.size() && at > x[i + 1]) {
+    i++ ;
+  }
+  return i ;
+}
+
+
+/****************************************
+ * Evaluation
+ ****************************************/
+
+inline void Reference_line::eval(double at, double &value, double &slope) const {
+
+  if (spline_) {
+    int i = piece(at) ;
+    double h = x[i + 1] - x[i] ;
+    double a = (x[i + 1] - at) / h ;
+    double b = (at - x[i]) / h ;
+    value = a * y[i] + b * y[i + 1] + ((a * a * a - a) * m_[i] + (b * b * b - b) * m_[i + 1]) * h * h / 6 ;
+    slope = (y[i + 1] - y[i]) / h + ((1 - 3 * a * a) * m_[i] + (3 * b * b - 1) * m_[i + 1]) * h / 6 ;
+    return ;
+  }
+
+  value = ((coeffs[3] * at + coeffs[2]) * at + coeffs[1]) * at + coeffs[0] ;
+  slope = (3 * coeffs[3] * at + 2 * coeffs[2]) * at + coeffs[1] ;
+}
+
+inline double Reference_line::value(double at) const {
+  double v, dv ;
+  eval(at, v, dv) ;
+  return v ;
+}
+
+inline double Reference_line::slope(double at) const {
+  double v, dv ;
+  eval(at, v, dv) ;
+  return dv ;
+}
+
+#endif /* MPC_REFERENCE_LINE_H */
@@ -0,0 +1,312 @@
+#include "MPC_rti.h"
+#include <cmath>
+#include <limits>
+#include "Eigen-3.3/Eigen/Dense"
+
+using namespace std ;
+
+
+template <size_t N>
+MPC_rti<N>::MPC_rti(double dt, double Lf) : dt(dt), Lf(Lf) {
+
+  for (size_t i = 0; i < N - 1; i++) {
+    u[i].setZero() ;
+  }
+}
+
+template <size_t N>
+MPC_rti<N>::~MPC_rti() {}
+
+
+/****************************************
+ * Kinematic model, as in FG_eval
+ ****************************************/
+
+template <size_t N>
+void MPC_rti<N>::model(const State &s, const Control &u, State &next) const {
+
+  const double x = s[0], y = s[1], psi = s[2], v = s[3], epsi = s[5] ;
+  const double delta = u[0], a = u[1] ;
+
+  const double f      = c_[0] + c_[1] * x + c_[2] * x * x + c_[3] * (x * x * x) ;
+  const double psides = atan( c_[1] + (2 * c_[2] * x) + (3 * c_[3] * (x * x)) ) ;
+
+  next[0] = x + v * cos(psi) * dt ;
+  next[1] = y + v * sin(psi) * dt ;
+  next[2] = psi + v * delta / Lf * dt ;
+  next[3] = v + a * dt ;
+  next[4] = (f - y) + (v * sin(epsi) * dt) ;
+  next[5] = (psi - psides) + v * delta / Lf * dt ;
+
+  // previous actuation, for the sequence costs
+  next[6] = delta ;
+  next[7] = a ;
+}
+
+template <size_t N>
+void MPC_rti<N>::linearize(const State &s, const Control &u, Matrix_ss &A, Matrix_su &B) const {
+
+  const double x = s[0], psi = s[2], v = s[3], epsi = s[5] ;
+  const double delta = u[0] ;
+
+  const double f_x  = c_[1] + 2 * c_[2] * x + 3 * c_[3] * x * x ;
+  const double f_xx = 2 * c_[2] + 6 * c_[3] * x ;
+
+  A.setZero() ;
+  B.setZero() ;
+
+  A(0, 0) = 1 ;
+  A(0, 2) = - v * sin(psi) * dt ;
+  A(0, 3) = cos(psi) * dt ;
+
+  A(1, 1) = 1 ;
+  A(1, 2) = v * cos(psi) * dt ;
+  A(1, 3) = sin(psi) * dt ;
+
+  A(2, 2) = 1 ;
+  A(2, 3) = delta / Lf * dt ;
+  B(2, 0) = v / Lf * dt ;
+
+  A(3, 3) = 1 ;
+  B(3, 1) = dt ;
+
+  A(4, 0) = f_x ;
+  A(4, 1) = -1 ;
+  A(4, 3) = sin(epsi) * dt ;
+  A(4, 5) = v * cos(epsi) * dt ;
+
+  A(5, 0) = - f_xx / (1 + f_x * f_x) ;
+  A(5, 2) = 1 ;
+  A(5, 3) = delta / Lf * dt ;
+  B(5, 0) = v / Lf * dt ;
+
+  B(6, 0) = 1 ;
+  B(7, 1) = 1 ;
+}
+
+
+/****************************************
+ * Solve
+ ****************************************/
+
+template <size_t N>
+void MPC_rti<N>::Solve(const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs) {
+
+  for (int i = 0; i < 4; i++) {
+    c_[i] = coeffs[i] ;
+  }
+
+  // shift the last actuations one step, repeat the last one
+  if (warm_) {
+    for (size_t i = 0; i + 1 < N - 1; i++) {
+      u[i] = u[i + 1] ;
+    }
+  }
+  else {
+    for (size_t i = 0; i < N - 1; i++) {
+      u[i].setZero() ;
+    }
+  }
+
+  rollout(state) ;
+  for (int i = 0; i < iterations; i++) {
+    sweep() ;
+  }
+
+  cost  = total_cost() ;
+  warm_ = true ;
+}
+
+template <size_t N>
+void MPC_rti<N>::rollout(const Eigen::VectorXd &state) {
+
+  for (int i = 0; i < nz; i++) {
+    s[0][i] = state[i] ;
+  }
+  s[0].template tail<nu>().setZero() ;  // no sequence cost on the first actuation
+
+  for (size_t t = 0; t < N - 1; t++) {
+    model(s[t], u[t], s[t + 1]) ;
+  }
+}
+
+/*
+One Gauss-Newton step. The costs are already quadratic, so only the model
+is linearized. Backward Riccati recursion on the deviations from the
+current trajectory, then a forward pass through the nonlinear model with
+the feedback gains.
+*/
+template <size_t N>
+void MPC_rti<N>::sweep() {
+
+  const Control lo(-delta_max, -a_max) ;
+  const Control hi( delta_max,  a_max) ;
+
+  // Terminal stage, state costs only
+  Matrix_ss P = Matrix_ss::Zero() ;
+  State p = State::Zero() ;
+
+  const State &s_N = s[N - 1] ;
+  P(3, 3) = 2 * w.v ;      p[3] = 2 * w.v    * (s_N[3] - w.ref_v) ;
+  P(4, 4) = 2 * w.cte ;    p[4] = 2 * w.cte  * (s_N[4] - w.ref_cte) ;
+  P(5, 5) = 2 * w.epsi ;   p[5] = 2 * w.epsi * (s_N[5] - w.ref_epsi) ;
+
+  Matrix_ss A ;
+  Matrix_su B ;
+  State defect ;
+
+  for (size_t t = N - 1; t-- > 0; ) {
+
+    const State &s_t = s[t] ;
+    const Control &u_t = u[t] ;
+
+    linearize(s_t, u_t, A, B) ;
+    model(s_t, u_t, defect) ;
+    defect -= s[t + 1] ;
+
+    // Stage cost around (s_t, u_t)
+    Matrix_ss Q_s = Matrix_ss::Zero() ;
+    State     q_s = State::Zero() ;
+    Matrix_uu R   = Matrix_uu::Zero() ;
+    Control   r   = Control::Zero() ;
+    Matrix_us S   = Matrix_us::Zero() ;
+
+    Q_s(3, 3) = 2 * w.v ;      q_s[3] = 2 * w.v    * (s_t[3] - w.ref_v) ;
+    Q_s(4, 4) = 2 * w.cte ;    q_s[4] = 2 * w.cte  * (s_t[4] - w.ref_cte) ;
+    Q_s(5, 5) = 2 * w.epsi ;   q_s[5] = 2 * w.epsi * (s_t[5] - w.ref_epsi) ;
+
+    R(0, 0) = 2 * w.val_steering ;   r[0] = 2 * w.val_steering * u_t[0] ;
+    R(1, 1) = 2 * w.val_throttle ;   r[1] = 2 * w.val_throttle * u_t[1] ;
+
+    if (t > 0) {
+      // (u_t - u_t-1)^2, u_t-1 is the tail of the augmented state
+      const double seq[nu] = { w.seq_steering, w.seq_throttle } ;
+      for (int i = 0; i < nu; i++) {
+        double gap = u_t[i] - s_t[nz + i] ;
+        R(i, i)          += 2 * seq[i] ;
+        Q_s(nz + i, nz + i) += 2 * seq[i] ;
+        S(i, nz + i)     -= 2 * seq[i] ;
+        r[i]             += 2 * seq[i] * gap ;
+        q_s[nz + i]      -= 2 * seq[i] * gap ;
+      }
+    }
+
+    // Q function
+    const State p_next = p + P * defect ;
+    const Matrix_ss Q_ss = Q_s + A.transpose() * P * A ;
+    const Matrix_uu Q_uu = R + B.transpose() * P * B ;
+    const Matrix_us Q_us = S + B.transpose() * P * A ;
+    const State     Q_sv = q_s + A.transpose() * p_next ;
+    const Control   Q_uv = r + B.transpose() * p_next ;
+
+    // Feedforward within the actuator box, feedback only on free actuators
+    Control k ;
+    bool free[nu] ;
+    box_qp(Q_uu, Q_uv, lo - u_t, hi - u_t, k, free) ;
+
+    Matrix_us K = Matrix_us::Zero() ;
+    if (free[0] && free[1]) {
+      K = - Q_uu.inverse() * Q_us ;
+    }
+    else {
+      for (int i = 0; i < nu; i++) {
+        if (free[i]) { K.row(i) = - Q_us.row(i) / Q_uu(i, i) ; }
+      }
+    }
+
+    K_[t] = K ;
+    k_[t] = k ;
+
+    P = Q_ss + K.transpose() * Q_uu * K + K.transpose() * Q_us + Q_us.transpose() * K ;
+    P = .5 * (P + P.transpose()) ;
+    p = Q_sv + K.transpose() * Q_uu * k + K.transpose() * Q_uv + Q_us.transpose() * k ;
+  }
+
+  // Forward pass through the nonlinear model
+  s_new_[0] = s[0] ;
+  for (size_t t = 0; t < N - 1; t++) {
+
+    Control u_new = u[t] + k_[t] + K_[t] * (s_new_[t] - s[t]) ;
+    u_new = u_new.cwiseMax(lo).cwiseMin(hi) ;
+
+    model(s_new_[t], u_new, s_new_[t + 1]) ;
+    u[t] = u_new ;
+  }
+  s.swap(s_new_) ;
+}
+
+// min 1/2 x'Hx + g'x, lo <= x <= hi. Two variables, so try every active set.
+template <size_t N>
+void MPC_rti<N>::box_qp(const Matrix_uu &H, const Control &g, const Control &lo, const Control &hi,
+                        Control &x, bool free[nu]) {
+
+  double best = numeric_limits<double>::infinity() ;
+  const double tolerance = 1e-12 ;
+
+  // 0 free, 1 at lo, 2 at hi
+  for (int a = 0; a < 3; a++) {
+    for (int b = 0; b < 3; b++) {
+
+      Control c ;
+      const int set[nu] = { a, b } ;
+      for (int i = 0; i < nu; i++) {
+        c[i] = set[i] == 1 ? lo[i] : hi[i] ;
+      }
+
+      if (a == 0 && b == 0) {
+        c = - H.ldlt().solve(g) ;
+      }
+      else if (a == 0) {
+        c[0] = - (g[0] + H(0, 1) * c[1]) / H(0, 0) ;
+      }
+      else if (b == 0) {
+        c[1] = - (g[1] + H(1, 0) * c[0]) / H(1, 1) ;
+      }
+
+      bool feasible = true ;
+      for (int i = 0; i < nu; i++) {
+        if (c[i] < lo[i] - tolerance || c[i] > hi[i] + tolerance) { feasible = false ; }
+      }
+      if (!feasible) { continue ; }
+
+      double value = .5 * c.dot(H * c) + g.dot(c) ;
+      if (value < best) {
+        best = value ;
+        x = c.cwiseMax(lo).cwiseMin(hi) ;
+        free[0] = a == 0 ;
+        free[1] = b == 0 ;
+      }
+    }
+  }
+}
+
+// FG_eval's fg[0]
+template <size_t N>
+double MPC_rti<N>::total_cost() const {
+
+  // each stage summed on its own, then added into total
+  double total = 0 ;
+  for (size_t t = 0; t < N; t++) {
+
+    const double e_cte  = s[t][4] - w.ref_cte ;
+    const double e_epsi = s[t][5] - w.ref_epsi ;
+    const double e_v    = s[t][3] - w.ref_v ;
+    double stage = w.cte * e_cte * e_cte + w.epsi * e_epsi * e_epsi + w.v * e_v * e_v ;
+
+    if (t < N - 1) {
+      stage += w.val_steering * u[t][0] * u[t][0] + w.val_throttle * u[t][1] * u[t][1] ;
+    }
+    if (t + 2 < N) {
+      const double d_delta = u[t + 1][0] - u[t][0] ;
+      const double d_a     = u[t + 1][1] - u[t][1] ;
+      stage += w.seq_steering * d_delta * d_delta + w.seq_throttle * d_a * d_a ;
+    }
+    total += stage ;
+  }
+  return total ;
+}
+
+
+// The horizons in MPC.cpp's horizon table
+template class MPC_rti<9> ;
+template class MPC_rti<40> ;
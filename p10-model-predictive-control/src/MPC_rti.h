@@ -0,0 +1,88 @@
+#ifndef MPC_RTI_H
+#define MPC_RTI_H
+
+#include <array>
+#include "Eigen-3.3/Eigen/Core"
+#include "MPC.h"
+
+using namespace std;
+
+/*
+Real time iteration backend for the FG_eval kinematic model.
+
+Each Solve() linearizes the model around the previous solution shifted one
+step, forms the stage-wise quadratic problem and solves it with a Riccati
+recursion, O(N). The actuator boxes on delta and a are handled per stage
+with an exact 2 variable active set solve (control limited Riccati). The
+new trajectory is rolled out through the nonlinear model, so it always
+satisfies the dynamics.
+
+The state is augmented with the previous actuation so the sequence costs
+(delta_t+1 - delta_t) fit the stage structure.
+
+The horizon is a template parameter so all the per stage storage is fixed
+size. Horizons are instantiated at the bottom of MPC_rti.cpp.
+*/
+
+template <size_t N>
+class MPC_rti {
+ public:
+
+  static const int nz = 6 ;   // x, y, psi, v, cte, epsi
+  static const int nu = 2 ;   // delta, a
+  static const int ns = nz + nu ;
+
+  typedef Eigen::Matrix<double, ns, 1>  State ;
+  typedef Eigen::Matrix<double, nu, 1>  Control ;
+  typedef Eigen::Matrix<double, ns, ns> Matrix_ss ;
+  typedef Eigen::Matrix<double, ns, nu> Matrix_su ;
+  typedef Eigen::Matrix<double, nu, ns> Matrix_us ;
+  typedef Eigen::Matrix<double, nu, nu> Matrix_uu ;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  MPC_rti(double dt, double Lf) ;
+  virtual ~MPC_rti() ;
+
+  double dt ;
+  double Lf ;
+  MPC_weights w ;  // same as FG_eval
+
+  double delta_max = 0.436332 ;
+  double a_max     = 1. ;
+
+  // Riccati sweeps per Solve(), 1 is plain RTI
+  int iterations = 2 ;
+
+  // Solve from state (x, y, psi, v, cte, epsi) for the cubic coeffs,
+  // warm started from the last call
+  void Solve(const Eigen::VectorXd &state, const Eigen::VectorXd &coeffs) ;
+
+  // Forget the last solution, the next Solve() starts from zero actuation
+  void reset() { warm_ = false ; }
+
+  // Solution, states 0 .. N - 1 (first nz entries) and actuations 0 .. N - 2
+  array<State, N> s ;
+  array<Control, N - 1> u ;
+  double cost ;
+
+ private:
+
+  void model(const State &s, const Control &u, State &next) const ;
+  void linearize(const State &s, const Control &u, Matrix_ss &A, Matrix_su &B) const ;
+  void rollout(const Eigen::VectorXd &state) ;
+  void sweep() ;
+  double total_cost() const ;
+
+  static void box_qp(const Matrix_uu &H, const Control &g, const Control &lo, const Control &hi,
+                     Control &x, bool free[nu]) ;
+
+  double c_[4] ;  // polynomial coeffs
+  bool warm_ = false ;
+
+  array<Matrix_us, N - 1> K_ ;
+  array<Control, N - 1> k_ ;
+  array<State, N> s_new_ ;
+};
+
+#endif /* MPC_RTI_H */
@@ -0,0 +1,151 @@
+#include "MPC_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace std ;
+
+
+MPC_stats::MPC_stats(double period)
+    : wall_ms_({ .5, 1, 2, 5, 10, 20, 50, 100, 200, 500 }),
+      iterations_({ 1, 2, 5, 10, 20, 50, 100, 200 }),
+      constraint_violation_({ 1e-12, 1e-10, 1e-8, 1e-6, 1e-4, 1e-2, 1 }),
+      period_(chrono::microseconds((long long)(period * 1e6))) {
+
+  text_   = format() ;
+  worker_ = thread(&MPC_stats::work, this) ;
+}
+
+MPC_stats::~MPC_stats() {
+
+  {
+    lock_guard<mutex> guard(lock_) ;
+    stop_ = true ;
+  }
+  wake_.notify_one() ;
+  worker_.join() ;
+}
+
+void MPC_stats::record(const MPC_solve_record &r) {
+  if (!ring_.push(r)) {
+    dropped_++ ;
+  }
+}
+
+string MPC_stats::text() {
+  lock_guard<mutex> guard(lock_) ;
+  return text_ ;
+}
+
+
+/****************************************
+ * Stats thread
+ ****************************************/
+
+void MPC_stats::work() {
+
+  unique_lock<mutex> guard(lock_) ;
+  while (!stop_) {
+
+    wake_.wait_for(guard, period_, [this] { return stop_ ; }) ;
+    guard.unlock() ;
+
+    MPC_solve_record r ;
+    bool changed = false ;
+    while (ring_.pop(r)) {
+      aggregate(r) ;
+      changed = true ;
+    }
+    string text = changed ? format() : "" ;
+
+    guard.lock() ;
+    if (changed) {
+      text_.swap(text) ;
+    }
+  }
+}
+
+void MPC_stats::aggregate(const MPC_solve_record &r) {
+
+  wall_ms_.add(r.wall_ms) ;
+  iterations_.add(r.iterations) ;
+  constraint_violation_.add(r.constraint_violation) ;
+
+  status_[r.status]++ ;
+  not_converged_ += !r.converged ;
+  warm_starts_   += r.warm_start ;
+
+  budget_ms_ = r.max_cpu_time * 1000 ;
+  if (r.wall_ms > budget_ms_) {
+    over_budget_++ ;
+  }
+  wall_ms_max_ = max(wall_ms_max_, r.wall_ms) ;
+  objective_   = r.objective ;
+}
+
+void MPC_stats::Histogram::add(double value) {
+
+  // NaN and +Inf land in the +Inf bucket, kept out of the sum
+  size_t i = 0 ;
+  while (i < bounds.size() && !(value <= bounds[i])) {
+    i++ ;
+  }
+  counts[i]++ ;
+  if (isfinite(value)) {
+    sum += value ;
+  }
+  n++ ;
+}
+
+void MPC_stats::Histogram::write(ostream &out, const string &name, const string &help) const {
+
+  out << "# HELP " << name << " " << help << "\n" ;
+  out << "# TYPE " << name << " histogram\n" ;
+
+  uint64_t cumulative = 0 ;
+  for (size_t i = 0; i < bounds.size(); i++) {
+    cumulative += counts[i] ;
+    out << name << "_bucket{le=\"" << bounds[i] << "\"} " << cumulative << "\n" ;
+  }
+  out << name << "_bucket{le=\"+Inf\"} " << n << "\n" ;
+  out << name << "_sum " << sum << "\n" ;
+  out << name << "_count " << n << "\n" ;
+}
+
+string MPC_stats::format() const {
+
+  ostringstream out ;
+
+  wall_ms_.write(out, "mpc_solve_wall_ms", "Wall time of MPC::Solve()") ;
+  iterations_.write(out, "mpc_solve_iterations", "Ipopt iterations, Riccati sweeps for RTI") ;
+  constraint_violation_.write(out, "mpc_solve_constraint_violation",
+                              "Largest model constraint violation of the returned solution") ;
+
+  out << "# HELP mpc_solve_status_total Solves by Ipopt::ApplicationReturnStatus, 0 is Solve_Succeeded\n" ;
+  out << "# TYPE mpc_solve_status_total counter\n" ;
+  for (auto it = status_.begin(); it != status_.end(); ++it) {
+    out << "mpc_solve_status_total{status=\"" << it->first << "\"} " << it->second << "\n" ;
+  }
+
+  out << "# TYPE mpc_solve_not_converged_total counter\n" ;
+  out << "mpc_solve_not_converged_total " << not_converged_ << "\n" ;
+  out << "# TYPE mpc_solve_warm_start_total counter\n" ;
+  out << "mpc_solve_warm_start_total " << warm_starts_ << "\n" ;
+
+  out << "# HELP mpc_solve_over_budget_total Solves that took longer than max_cpu_time\n" ;
+  out << "# TYPE mpc_solve_over_budget_total counter\n" ;
+  out << "mpc_solve_over_budget_total " << over_budget_ << "\n" ;
+  out << "# TYPE mpc_solve_budget_ms gauge\n" ;
+  out << "mpc_solve_budget_ms " << budget_ms_ << "\n" ;
+  out << "# TYPE mpc_solve_wall_ms_max gauge\n" ;
+  out << "mpc_solve_wall_ms_max " << wall_ms_max_ << "\n" ;
+
+  out << "# TYPE mpc_solve_objective gauge\n" ;
+  out << "mpc_solve_objective " << objective_ << "\n" ;
+
+  out << "# HELP mpc_stats_dropped_total Records lost to a full ring buffer\n" ;
+  out << "# TYPE mpc_stats_dropped_total counter\n" ;
+  out << "mpc_stats_dropped_total " << dropped_.load() << "\n" ;
+
+  return out.str() ;
+}
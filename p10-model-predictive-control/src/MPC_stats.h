@@ -0,0 +1,133 @@
+#ifndef MPC_STATS_H
+#define MPC_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+Per solve records for sizing horizons against the latency budget.
+
+  MPC::Solve() -> record() -> ring buffer -> stats thread -> histograms
+                                                          -> text()  -> GET /stats
+
+The solving thread only writes into a single producer / single consumer
+ring, no locks or allocation. A thread of our own drains it every period
+and rebuilds the text (Prometheus exposition format) that the HTTP handler
+hands out.
+*/
+
+// One MPC::Solve()
+struct MPC_solve_record {
+  double wall_ms ;
+  double max_cpu_time ;          // the solve's budget, seconds
+  int iterations ;
+  int status ;                   // Ipopt::ApplicationReturnStatus, 0 for RTI
+  bool converged ;
+  double constraint_violation ;  // max over the model constraints
+  double objective ;
+  bool warm_start ;              // started from the last solution
+};
+
+
+// Lock free, one thread push()es and one pop()s
+template <class T, size_t Capacity>
+class MPC_ring {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2") ;
+
+ public:
+
+  // False if full, the record is dropped
+  bool push(const T &value) {
+    size_t head = head_.load(memory_order_relaxed) ;
+    if (head - tail_.load(memory_order_acquire) == Capacity) {
+      return false ;
+    }
+    buffer_[head & (Capacity - 1)] = value ;
+    head_.store(head + 1, memory_order_release) ;
+    return true ;
+  }
+
+  bool pop(T &value) {
+    size_t tail = tail_.load(memory_order_relaxed) ;
+    if (tail == head_.load(memory_order_acquire)) {
+      return false ;
+    }
+    value = buffer_[tail & (Capacity - 1)] ;
+    tail_.store(tail + 1, memory_order_release) ;
+    return true ;
+  }
+
+ private:
+
+  array<T, Capacity> buffer_ ;
+  atomic<size_t> head_{0} ;
+  atomic<size_t> tail_{0} ;
+};
+
+
+class MPC_stats {
+ public:
+
+  // Aggregates every period seconds
+  MPC_stats(double period = .5) ;
+  virtual ~MPC_stats() ;
+
+  // From the thread calling MPC::Solve(), only one at a time
+  void record(const MPC_solve_record &r) ;
+
+  // Latest aggregate, any thread
+  string text() ;
+
+ private:
+
+  struct Histogram {
+    vector<double> bounds ;       // upper bounds, +Inf implied
+    vector<uint64_t> counts ;     // per bucket, not cumulative
+    double sum = 0 ;
+    uint64_t n = 0 ;
+
+    Histogram(vector<double> bounds) : bounds(bounds), counts(bounds.size() + 1, 0) {}
+    void add(double value) ;
+    void write(ostream &out, const string &name, const string &help) const ;
+  };
+
+  MPC_ring<MPC_solve_record, 1024> ring_ ;
+  atomic<uint64_t> dropped_{0} ;
+
+  // Only touched on the stats thread
+  Histogram wall_ms_ ;
+  Histogram iterations_ ;
+  Histogram constraint_violation_ ;
+  map<int, uint64_t> status_ ;
+  uint64_t not_converged_ = 0 ;
+  uint64_t warm_starts_ = 0 ;
+  uint64_t over_budget_ = 0 ;
+  double wall_ms_max_ = 0 ;
+  double budget_ms_ = 0 ;
+  double objective_ = 0 ;
+
+  chrono::microseconds period_ ;
+  mutex lock_ ;
+  condition_variable wake_ ;
+  bool stop_ = false ;
+  string text_ ;    // under lock_
+
+  thread worker_ ;
+
+  void work() ;
+  void aggregate(const MPC_solve_record &r) ;
+  string format() const ;
+};
+
+#endif /* MPC_STATS_H */
@@ -0,0 +1,125 @@
+#include "MPC_telemetry.h"
+#include <math.h>
+#include "MPC_model.h"
+
+using json = nlohmann::json;
+
+
+string hasData(string s) {
+  auto found_null = s.find("null");
+  auto b1 = s.find_first_of("[");
+  auto b2 = s.rfind("}]");
+  if (found_null != string::npos) {
+    return "";
+  } else if (b1 != string::npos && b2 != string::npos) {
+    return s.substr(b1, b2 - b1 + 2);
+  }
+  return "";
+}
+
+/****************************************
+ * 2. Collect data from simulator
+ ****************************************/
+
+Telemetry read_telemetry(const json &j) {
+
+  Telemetry t ;
+  t.ptsx = j.at("ptsx").get<vector<double>>() ;
+  t.ptsy = j.at("ptsy").get<vector<double>>() ;
+  t.x     = j.at("x") ;
+  t.y     = j.at("y") ;
+  t.psi   = j.at("psi") ;
+  t.speed = j.at("speed") ;
+
+  t.steering_angle = j.at("steering_angle") ;
+  t.throttle       = j.at("throttle") ;
+  return t ;
+}
+
+bool parse_telemetry(const string &line, Telemetry &t) {
+
+  size_t start = line.find_first_not_of(" \t\r") ;
+  if (start == string::npos) {
+    return false ;
+  }
+
+  try {
+    if (line[start] == '{') {
+      t = read_telemetry(json::parse(line.substr(start))) ;
+    }
+    else {
+      string s = hasData(line) ;
+      if (s == "") {
+        return false ;
+      }
+      auto j = json::parse(s) ;
+      if (j[0].get<string>() != "telemetry") {
+        return false ;
+      }
+      t = read_telemetry(j[1]) ;
+    }
+  }
+  catch (const exception &) {
+    // not a telemetry line, the log has the replies and solver output too
+    return false ;
+  }
+
+  return fits_reference_line(t) ;
+}
+
+bool fits_reference_line(const Telemetry &t) {
+
+  // enough waypoints for the cubic, and no more than the line holds
+  return t.ptsx.size() >= 4 && t.ptsx.size() <= Reference_line::max_points &&
+         t.ptsx.size() == t.ptsy.size() ;
+}
+
+
+MPC_input prepare_input(const Telemetry &t, double latency) {
+
+  MPC_input in ;
+
+  /****************************************
+   * 3. - 4. Convert map space to car space and fit line to get coefficients
+   ****************************************/
+
+  in.line.fit(t.ptsx, t.ptsy, t.x, t.y, t.psi) ;
+  in.coeffs = in.line.coeffs ;
+
+  /****************************************
+   * 5. Error calculation (Cross track and Psi) and state definition.
+   ****************************************/
+
+  // Where the car will be when the reply is applied, latency from
+  // now. Same kinematic model as the MPC, in car space, with the
+  // actuations the simulator has now.
+
+  // convert to m/s
+  // v = v * 0.44704;
+
+  const double delta = - t.steering_angle ;
+  const int steps = 10 ;
+  const double step = latency / steps ;
+
+  double px  = 0 ;
+  double py  = 0 ;
+  double psi = 0 ;
+  double v   = t.speed ;
+  for (int i = 0; i < steps; i++) {
+    px  += v * cos(psi) * step ;
+    py  += v * sin(psi) * step ;
+    psi += v * delta / Lf * step ;
+    v   += t.throttle * step ;
+  }
+
+  double line_y, line_slope ;
+  in.line.eval(px, line_y, line_slope) ;
+  double cte  = line_y - py ;
+
+  // using derivative at px
+  double epsi = psi - atan( line_slope );
+
+  in.state = Eigen::VectorXd(6) ;
+  in.state << px, py, psi, v, cte, epsi ;
+  return in ;
+}
@@ -0,0 +1,59 @@
+#ifndef MPC_TELEMETRY_H
+#define MPC_TELEMETRY_H
+
+#include <string>
+#include <vector>
+#include "Eigen-3.3/Eigen/Core"
+#include "MPC_reference_line.h"
+#include "json.hpp"
+
+using namespace std;
+
+/*
+The simulator side of the controller: what a telemetry frame holds and how
+it's turned into the MPC's state and reference polynomial. Shared by main.cpp
+and mpc_bench so the benchmark solves exactly what the simulator would send.
+*/
+
+// One telemetry frame, map space
+struct Telemetry {
+  vector<double> ptsx ;
+  vector<double> ptsy ;
+  double x ;
+  double y ;
+  double psi ;
+  double speed ;
+  double steering_angle ;
+  double throttle ;
+};
+
+// What MPC::Solve() gets, plus the waypoints for the visuals
+struct MPC_input {
+  Reference_line line ;      // car space waypoints and the fitted cubic
+  Eigen::VectorXd coeffs ;   // line.coeffs
+  Eigen::VectorXd state ;    // px, py, psi, v, cte, epsi
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+// Checks if the SocketIO event has JSON data.
+// If there is data the JSON object in string format will be returned,
+// else the empty string "" will be returned.
+string hasData(string s);
+
+// j is the data object of a "telemetry" event
+Telemetry read_telemetry(const nlohmann::json &j) ;
+
+// A line of a log, either the 42["telemetry",{...}] messages ./mpc prints or
+// a bare {...} data object. False for anything else.
+bool parse_telemetry(const string &line, Telemetry &t) ;
+
+// Whether the waypoints fit in a Reference_line, 4 to max_points of them
+// and as many y as x. Check before prepare_input().
+bool fits_reference_line(const Telemetry &t) ;
+
+// Car space waypoints, fitted line and the state latency seconds from now.
+// t must pass fits_reference_line().
+MPC_input prepare_input(const Telemetry &t, double latency) ;
+
+#endif /* MPC_TELEMETRY_H */
@@ -5,8 +5,11 @@
 #include <thread>
 #include <vector>
 #include "Eigen-3.3/Eigen/Core"
-#include "Eigen-3.3/Eigen/QR"
 #include "MPC.h"
+#include "MPC_multi.h"
+#include "MPC_pipeline.h"
+#include "MPC_stats.h"
+#include "MPC_telemetry.h"
 #include "json.hpp"
 #include <math.h>
 #include <stdlib.h>
@@ -20,54 +23,6 @@ constexpr double pi() { return M_PI; }
 double deg2rad(double x) { return x * pi() / 180; }
 double rad2deg(double x) { return x * 180 / pi(); }
 
-// Checks if the SocketIO event has JSON data.
-// If there is data the JSON object in string format will be returned,
-// else the empty string "" will be returned.
-string hasData(string s) {
-  auto found_null = s.find("null");
-  auto b1 = s.find_first_of("[");
-  auto b2 = s.rfind("}]");
-  if (found_null != string::npos) {
-    return "";
-  } else if (b1 != string::npos && b2 != string::npos) {
-    return s.substr(b1, b2 - b1 + 2);
-  }
-  return "";
-}
-
-// Evaluate a polynomial.
-double polyeval(Eigen::VectorXd coeffs, double x) {
-  double result = 0.0;
-  for (int i = 0; i < coeffs.size(); i++) {
-    result += coeffs[i] * pow(x, i);
-  }
-  return result;
-}
-
-// Fit a polynomial.
-// Adapted from
-// https://github.com/JuliaMath/Polynomials.jl/blob/master/src/Polynomials.jl#L676-L716
-Eigen::VectorXd polyfit(Eigen::VectorXd xvals, Eigen::VectorXd yvals,
-                        int order) {
-  assert(xvals.size() == yvals.size());
-  assert(order >= 1 && order <= xvals.size() - 1);
-  Eigen::MatrixXd A(xvals.size(), order + 1);
-
-  for (int i = 0; i < xvals.size(); i++) {
-    A(i, 0) = 1.0;
-  }
-
-  for (int j = 0; j < xvals.size(); j++) {
-    for (int i = 0; i < order; i++) {
-      A(j, i + 1) = A(j, i) * xvals(j);
-    }
-  }
-
-  auto Q = A.householderQr();
-  auto result = Q.solve(yvals);
-  return result;
-}
-
 int main( int argc, const char *argv[] ) {
   
   uWS::Hub h;
@@ -80,8 +35,8 @@ int main( int argc, const char *argv[] ) {
   vector<double> hyper_parameters ;
 
 
-  if (argc != 8 ) {
-    cout << " Usage ./mpc ref_cte ref_epsi v val_throttle coeff_cost_ref_val_steering seq_throttle seq_steering \n ie  ./mpc 20 20 1 8 1100 16 600" << endl ;
+  if (argc < 8 || argc > 10) {
+    cout << " Usage ./mpc ref_cte ref_epsi v val_throttle coeff_cost_ref_val_steering seq_throttle seq_steering [ipopt|rti] [multi] \n ie  ./mpc 20 20 1 8 1100 16 600" << endl ;
     return -1 ;
   }
   else {
@@ -94,9 +49,46 @@ int main( int argc, const char *argv[] ) {
 
   mpc.Init(hyper_parameters) ;
 
+  bool multi_hypothesis = false ;
+  for (int i = 8; i < argc; i++) {
+    if (string(argv[i]) == "rti") {
+      mpc.backend = MPC::RTI ;
+      cout << "Using the RTI backend" << endl ;
+    }
+    else if (string(argv[i]) == "multi") {
+      multi_hypothesis = true ;
+    }
+  }
+
+  // Actuator latency, to mimic real world driving. Replies are held back
+  // this long after the telemetry on a timer, the loop keeps running.
+  const double latency = .10 ;
+
+  // Solve time, iterations, status ... served on GET /stats
+  MPC_stats stats ;
+  mpc.stats = &stats ;
+
+  // multi: solve variants of the problem in parallel and send the best plan,
+  // the first is the command line's and scores the others (see MPC_multi.h)
+  MPC_multi *multi = NULL ;
+  if (multi_hypothesis) {
+    MPC_variant primary ;
+    primary.name    = "primary" ;
+    primary.backend = mpc.backend ;
+    primary.weights = mpc.weights ;
+
+    multi = new MPC_multi(MPC_multi::default_variants(primary)) ;
+    multi->deadline = latency / 2 ;
+    multi->timeout  = latency ;
+    multi->stats    = &stats ;
+    mpc.stats       = NULL ;
+    cout << "Solving " << multi->variants().size() << " variants per frame" << endl ;
+  }
 
-  h.onMessage([&mpc](uWS::WebSocket<uWS::SERVER> *ws, char *data, size_t length,
-                     uWS::OpCode opCode) {
+  MPC_pipeline pipeline(h.getLoop(), latency) ;
+
+  h.onMessage([&mpc, multi, &pipeline, latency](uWS::WebSocket<uWS::SERVER> *ws, char *data, size_t length,
+                                                uWS::OpCode opCode) {
     // "42" at the start of the message means there's a websocket message event.
     // The 4 signifies a websocket message
     // The 2 signifies a websocket event
@@ -113,161 +105,115 @@ int main( int argc, const char *argv[] ) {
         if (event == "telemetry") {
           // j[1] is the data JSON object
 
+          MPC_pipeline::Clock::time_point received = MPC_pipeline::Clock::now() ;
 
-          /****************************************
-           * 2. Collect data from simulator
-           ****************************************/
-
-          vector<double> ptsx = j[1]["ptsx"];
-          vector<double> ptsy = j[1]["ptsy"];
-          double px = j[1]["x"];
-          double py = j[1]["y"];
-          double psi = j[1]["psi"];
-          double v = j[1]["speed"];
-
-          double steer_value = j[1]["steering_angle"] ;
-
-          /****************************************
-           * 3. Convert map space to car space 
-           ****************************************/
-
-          // Use Eigen vector as polyfit() requires it
-          Eigen::VectorXd   x_car_space = Eigen::VectorXd( ptsx.size() ) ;
-          Eigen::VectorXd   y_car_space = Eigen::VectorXd( ptsx.size() ) ;
-
-          for (int i = 0;   i < ptsx.size() ;   i++) {
-            x_car_space(i) = (ptsx[i] - px) * cos(psi) + (ptsy[i] - py) * sin(psi)  ;
-            y_car_space(i) = (ptsy[i] - py) * cos(psi) - (ptsx[i] - px) * sin(psi)  ;
-            //cout << "ptsx[i] " << ptsx[i] << "\tpx " << px << "\tcos(psi) " 
-            //<< cos(psi) << "\tsin(psi) " << sin(psi) << endl ;
+          // 2. - 5. Collect the data, move it to car space, fit the line and
+          // predict the state latency seconds ahead
+          Telemetry telemetry = read_telemetry(j[1]) ;
+          if (!fits_reference_line(telemetry)) {
+            cout << "Skipping a frame with " << telemetry.ptsx.size() << " x and "
+                 << telemetry.ptsy.size() << " y waypoints, the line takes 4 to "
+                 << Reference_line::max_points << endl ;
+            return ;
           }
+          MPC_input in = prepare_input(telemetry, latency) ;
 
           /****************************************
-           * 4. Fit line to get coefficients
-           ****************************************/
-
-          // cout << "xvals" << x_car_space << endl ;
-          // cout << "yvals" << y_car_space << endl ;
-
-          auto coeffs = polyfit(x_car_space, y_car_space, 3) ;
-          // cout << "coeffs\t" << coeffs << endl ;
-
-           /****************************************
-           * 5. Error calculation (Cross track and Psi) and state definition.
+           * 10. Add latency to mimic real world driving conditions
            ****************************************/
-          
-          Eigen::VectorXd state(6) ;
-        
-          // where * latency is used to allow for latency in state calculation
-          const double latency = .10 ;
-          // cout << "px original " << px << endl ;
 
-          // convert to m/s 
-          // v = v * 0.44704;
+          // 6. - 9. run on the pipeline's worker thread, which hands the
+          // reply back to the loop to be sent once the latency is up.
+          // The next frame can be solved in the meantime.
+          pipeline.submit(ws, received, [&mpc, multi, in]() {
 
-          px = v * latency ;
-          // cout << "px transformed" << px << endl ;
+            /****************************************
+             * 6. Solve (Computational Infastructure for Operations Research library)
+             ****************************************/
 
-          const double Lf = 2.9;
-          // cout << "psi original" << psi << endl ;
-          psi = - v * steer_value / Lf * latency ;
-          // cout << "psi transformed" << psi << endl ;
+            cout << "Solving" << endl ;
 
-          double cte  = polyeval(coeffs, px) ;
-          // double epsi = atan( coeffs[1] ) ;
+            vector<double> vars ;
+            double steer_value ;
+            double throttle_value ;
 
-          // using derivative at px 
-          double epsi = - atan( coeffs[1] +
-                              (2 * coeffs[2] * px) +
-                              (3 * coeffs[3] * (px * px) ) );
+            if (multi != NULL) {
+              vars = multi->Solve(in.state, in.coeffs) ;
 
-          state << px, 0, psi, v, cte, epsi ;
-          // cout << "state " << psi << endl ;
+              if (!multi->converged) {
+                cout << "No feasible plan, following the last one" << endl ;
+              }
 
-          /****************************************
-           * 6. Solve (Computational Infastructure for Operations Research library)
-           ****************************************/
+              steer_value    = - multi->steering_angle ;
+              throttle_value = multi->throttle ;
+            }
+            else {
+              vars = mpc.Solve(in.state, in.coeffs) ;
 
-          cout << "Solving" << endl ;
+              if (!mpc.converged) {
+                cout << "Solve did not converge, status " << mpc.status << endl ;
+              }
 
-          auto vars = mpc.Solve(state, coeffs) ;
+              steer_value    = - mpc.steering_angle ;
+              throttle_value = mpc.throttle ;
+            }
 
-          // Convert from radians to normalized range.
-          steer_value           = steer_value / deg2rad(25) ;
-          steer_value           = - mpc.steering_angle ;
-          double throttle_value = mpc.throttle ;
+            /****************************************
+             * 7. Pass output to simulator
+             ****************************************/
 
-          /****************************************
-           * 7. Pass output to simulator
-           ****************************************/
+            json msgJson;
+            msgJson["steering_angle"] =   steer_value;
+            msgJson["throttle"]       =   throttle_value;
 
-          json msgJson;
-          msgJson["steering_angle"] =   steer_value;
-          msgJson["throttle"]       =   throttle_value;
+            /****************************************
+             * 8. Predicted line visual for simulator
+             ****************************************/
 
-          /****************************************
-           * 8. Predicted line visual for simulator
-           ****************************************/
-
-          // the points in the simulator are connected by a Green line
-          // points are in reference to the vehicle's coordinate system
+            // the points in the simulator are connected by a Green line
+            // points are in reference to the vehicle's coordinate system
           
-          vector<double> mpc_x_vals;
-          vector<double> mpc_y_vals;
+            vector<double> mpc_x_vals;
+            vector<double> mpc_y_vals;
 
-          int x_car_space_len = x_car_space.size() ;
-          for (int i = 6; i < vars.size(); i ++) {
-            if (i % 2 == 0 ){ 
+            for (int i = 6; i < vars.size(); i ++) {
+              if (i % 2 == 0 ){ 
               
-              mpc_x_vals.push_back( vars[i] ) ;
+                mpc_x_vals.push_back( vars[i] ) ;
 
-            } else {
+              } else {
               
-              mpc_y_vals.push_back( vars[i] ) ;
+                mpc_y_vals.push_back( vars[i] ) ;
+              }
             }
-          }
 
-          msgJson["mpc_x"] = mpc_x_vals;
-          msgJson["mpc_y"] = mpc_y_vals;
+            msgJson["mpc_x"] = mpc_x_vals;
+            msgJson["mpc_y"] = mpc_y_vals;
 
 
-          /****************************************
-           * 9. Way point visual for simulator
-           ****************************************/
-
-          // the points in the simulator are connected by a Yellow line
+            /****************************************
+             * 9. Way point visual for simulator
+             ****************************************/
 
-          vector<double> next_x_vals;
-          vector<double> next_y_vals;
+            // the points in the simulator are connected by a Yellow line
 
-          for (int i = 1;  i < x_car_space.size();  i++) {
-            next_x_vals.push_back(x_car_space[i] ) ;
-            next_y_vals.push_back(y_car_space[i] ) ;
-          }
+            vector<double> next_x_vals;
+            vector<double> next_y_vals;
 
-          msgJson["next_x"] = next_x_vals;
-          msgJson["next_y"] = next_y_vals;
-
-
-          auto msg = "42[\"steer\"," + msgJson.dump() + "]";
-          std::cout << msg << std::endl;
+            for (int i = 1;  i < in.line.x.size();  i++) {
+              next_x_vals.push_back(in.line.x[i] ) ;
+              next_y_vals.push_back(in.line.y[i] ) ;
+            }
 
-          /****************************************
-           * 10. Add latency to mimic real world driving conditions
-           ****************************************/
+            msgJson["next_x"] = next_x_vals;
+            msgJson["next_y"] = next_y_vals;
 
-          // Latency
-          // The purpose is to mimic real driving conditions where
-          // the car does actuate the commands instantly.
-          //
-          // Feel free to play around with this value but should be to drive
-          // around the track with 100ms latency.
-          //
 
-          // TODO look at chrono::high_resolution_clock() 
-          this_thread::sleep_for(chrono::milliseconds(100));
-          (*ws).send(msg.data(), msg.length(), uWS::OpCode::TEXT);
+            auto msg = "42[\"steer\"," + msgJson.dump() + "]";
+            std::cout << msg << std::endl;
 
+            return msg ;
+          }) ;
         }
       } else {
         // Manual driving
@@ -280,10 +226,14 @@ int main( int argc, const char *argv[] ) {
   // We don't need this since we're not using HTTP but if it's removed the
   // program
   // doesn't compile :-(
-  h.onHttpRequest([](uWS::HttpResponse *res, uWS::HttpRequest req, char *data,
-                     size_t, size_t) {
+  h.onHttpRequest([&stats](uWS::HttpResponse *res, uWS::HttpRequest req, char *data,
+                           size_t, size_t) {
     const std::string s = "<h1>Hello world!</h1>";
-    if (req.getUrl().valueLength == 1) {
+    const std::string url(req.getUrl().value, req.getUrl().valueLength);
+    if (url == "/stats") {
+      const std::string text = stats.text();
+      res->end(text.data(), text.length());
+    } else if (req.getUrl().valueLength == 1) {
       res->end(s.data(), s.length());
     } else {
       // i guess this should be done more gracefully?
@@ -291,12 +241,14 @@ int main( int argc, const char *argv[] ) {
     }
   });
 
-  h.onConnection([&h](uWS::WebSocket<uWS::SERVER> *ws, uWS::HttpRequest req) {
+  h.onConnection([&h, &pipeline](uWS::WebSocket<uWS::SERVER> *ws, uWS::HttpRequest req) {
+    pipeline.connected(ws);
     std::cout << "Connected!!!" << std::endl;
   });
 
-  h.onDisconnection([&h](uWS::WebSocket<uWS::SERVER> *ws, int code,
-                         char *message, size_t length) {
+  h.onDisconnection([&h, &pipeline](uWS::WebSocket<uWS::SERVER> *ws, int code,
+                                    char *message, size_t length) {
+    pipeline.disconnected(ws);
     (*ws).close();
     std::cout << "Disconnected" << std::endl;
   });
@@ -0,0 +1,372 @@
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "MPC.h"
+#include "MPC_model.h"
+#include "MPC_multi.h"
+#include "MPC_telemetry.h"
+
+using namespace std ;
+
+/*
+Runs MPC::Solve() without the simulator or a websocket, to time the solver
+and compare weights offline.
+
+  replay      solves every telemetry frame of a log, the lines ./mpc prints
+              or one {...} data object per line
+  closed loop drives a kinematic bicycle around a waypoint file, the
+              lake_track_waypoints.csv (x,y with a header) or
+              highway_map.csv (x y s dx dy) layout
+
+The closed loop car is the MPC's own model, so the tracking error is the
+controller's and not model mismatch. Its telemetry is what the simulator
+sends: the car's pose and 6 waypoints from the one behind it. A reply is
+applied latency seconds after the frame it answers, the same as ./mpc.
+*/
+
+struct Stats {
+  vector<double> solve_ms ;
+  vector<int> iterations ;
+  size_t not_converged = 0 ;
+  size_t deadline_misses = 0 ;
+  vector<double> cte ;
+};
+
+static double percentile(vector<double> v, double p) {
+  if (v.empty()) { return 0 ; }
+  sort(v.begin(), v.end()) ;
+  size_t i = (size_t)(p / 100. * (v.size() - 1) + .5) ;
+  return v[i] ;
+}
+
+// The controller under test, the MPC or with --multi its variants
+struct Controller {
+  MPC &mpc ;
+  MPC_multi *multi ;
+
+  double budget() const    { return multi ? multi->deadline : mpc.max_cpu_time ; }
+  double steering() const  { return multi ? multi->steering_angle : mpc.steering_angle ; }
+  double throttle() const  { return multi ? multi->throttle : mpc.throttle ; }
+  bool converged() const   { return multi ? multi->converged : mpc.converged ; }
+  int iterations() const   { return multi ? multi->iterations : mpc.iterations ; }
+};
+
+// Solve and time one frame
+static void solve(Controller &c, const MPC_input &in, Stats &stats) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now() ;
+  if (c.multi) {
+    c.multi->Solve(in.state, in.coeffs) ;
+  }
+  else {
+    c.mpc.Solve(in.state, in.coeffs) ;
+  }
+  double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() ;
+
+  stats.solve_ms.push_back(ms) ;
+  stats.iterations.push_back(c.iterations()) ;
+  if (!c.converged()) {
+    stats.not_converged++ ;
+  }
+  if (ms > c.budget() * 1000) {
+    stats.deadline_misses++ ;
+  }
+}
+
+static void report(const Controller &c, const Stats &stats) {
+
+  size_t n = stats.solve_ms.size() ;
+  if (n == 0) {
+    cout << "No frames solved" << endl ;
+    return ;
+  }
+
+  double ms_mean = 0 ;
+  double it_mean = 0 ;
+  int it_max = 0 ;
+  for (size_t i = 0; i < n; i++) {
+    ms_mean += stats.solve_ms[i] / n ;
+    it_mean += stats.iterations[i] / (double)n ;
+    it_max = max(it_max, stats.iterations[i]) ;
+  }
+
+  double cte_mean = 0, cte_rms = 0, cte_max = 0 ;
+  for (size_t i = 0; i < stats.cte.size(); i++) {
+    double e = fabs(stats.cte[i]) ;
+    cte_mean += e / stats.cte.size() ;
+    cte_rms  += e * e / stats.cte.size() ;
+    cte_max   = max(cte_max, e) ;
+  }
+  cte_rms = sqrt(cte_rms) ;
+
+  cout << "frames        " << n << endl ;
+  cout << "solve ms      mean " << ms_mean
+       << "  p50 " << percentile(stats.solve_ms, 50)
+       << "  p90 " << percentile(stats.solve_ms, 90)
+       << "  p99 " << percentile(stats.solve_ms, 99)
+       << "  max " << percentile(stats.solve_ms, 100) << endl ;
+  cout << "iterations    mean " << it_mean << "  max " << it_max << endl ;
+  cout << "not converged " << stats.not_converged << endl ;
+  cout << "over " << c.budget() * 1000 << " ms  " << stats.deadline_misses << endl ;
+  cout << "|cte|         mean " << cte_mean << "  rms " << cte_rms << "  max " << cte_max << endl ;
+
+  if (c.multi) {
+    const vector<MPC_variant> &variants = c.multi->variants() ;
+    for (size_t i = 0; i < variants.size(); i++) {
+      cout << "variant " << variants[i].name << "  chosen " << c.multi->wins[i]
+           << "  failed " << c.multi->failures[i] << "  late " << c.multi->late[i] << endl ;
+    }
+  }
+}
+
+
+/****************************************
+ * Replay
+ ****************************************/
+
+static bool replay(Controller &c, const string &path, double latency, Stats &stats) {
+
+  ifstream log(path) ;
+  if (!log) {
+    cout << "Can't open " << path << endl ;
+    return false ;
+  }
+
+  string line ;
+  Telemetry t ;
+  while (getline(log, line)) {
+    if (!parse_telemetry(line, t)) {
+      continue ;
+    }
+    MPC_input in = prepare_input(t, latency) ;
+    solve(c, in, stats) ;
+
+    // the recorded car's error when the frame was sent
+    stats.cte.push_back(in.line.value(0)) ;
+  }
+  return true ;
+}
+
+
+/****************************************
+ * Closed loop
+ ****************************************/
+
+struct Track {
+  vector<double> x ;
+  vector<double> y ;
+};
+
+static bool load_track(const string &path, Track &track) {
+
+  ifstream file(path) ;
+  if (!file) {
+    cout << "Can't open " << path << endl ;
+    return false ;
+  }
+
+  string line ;
+  while (getline(file, line)) {
+    replace(line.begin(), line.end(), ',', ' ') ;
+    istringstream fields(line) ;
+    double x, y ;
+    if (fields >> x >> y) {   // skips the x,y header
+      track.x.push_back(x) ;
+      track.y.push_back(y) ;
+    }
+  }
+  if (track.x.size() < 6) {
+    cout << path << " needs at least 6 waypoints" << endl ;
+    return false ;
+  }
+  return true ;
+}
+
+static size_t nearest(const Track &track, double x, double y) {
+  size_t best = 0 ;
+  double best_d = 1e300 ;
+  for (size_t i = 0; i < track.x.size(); i++) {
+    double d = pow(track.x[i] - x, 2) + pow(track.y[i] - y, 2) ;
+    if (d < best_d) {
+      best_d = d ;
+      best = i ;
+    }
+  }
+  return best ;
+}
+
+// Distance to the closed polyline through the waypoints
+static double distance(const Track &track, double x, double y) {
+  size_t n = track.x.size() ;
+  double best = 1e300 ;
+  for (size_t i = 0; i < n; i++) {
+    double ax = track.x[i], ay = track.y[i] ;
+    double bx = track.x[(i + 1) % n], by = track.y[(i + 1) % n] ;
+    double dx = bx - ax, dy = by - ay ;
+    double len2 = dx * dx + dy * dy ;
+    double s = len2 > 0 ? ((x - ax) * dx + (y - ay) * dy) / len2 : 0 ;
+    s = max(0., min(1., s)) ;
+    best = min(best, hypot(x - ax - s * dx, y - ay - s * dy)) ;
+  }
+  return best ;
+}
+
+static void closed_loop(Controller &c, const Track &track, double seconds, double v0,
+                        double period, double latency, Stats &stats) {
+
+  // Commands waiting for their latency, as (time applied, steering, throttle)
+  struct Command { double at, steering, throttle ; } ;
+  deque<Command> queue ;
+
+  // Start on the first waypoint, heading to the next
+  Telemetry car ;
+  car.x     = track.x[0] ;
+  car.y     = track.y[0] ;
+  car.psi   = atan2(track.y[1] - track.y[0], track.x[1] - track.x[0]) ;
+  car.speed = v0 ;
+  car.steering_angle = 0 ;
+  car.throttle       = 0 ;
+
+  const int substeps = 10 ;
+  const double step = period / substeps ;
+  size_t n = track.x.size() ;
+
+  for (double t = 0; t < seconds; t += period) {
+
+    // Telemetry, 6 waypoints from the one behind the car
+    size_t first = (nearest(track, car.x, car.y) + n - 1) % n ;
+    car.ptsx.clear() ;
+    car.ptsy.clear() ;
+    for (size_t i = 0; i < 6; i++) {
+      car.ptsx.push_back(track.x[(first + i) % n]) ;
+      car.ptsy.push_back(track.y[(first + i) % n]) ;
+    }
+
+    solve(c, prepare_input(car, latency), stats) ;
+    queue.push_back({t + latency, - c.steering(), c.throttle()}) ;
+
+    // Drive until the next frame
+    for (int i = 0; i < substeps; i++) {
+      double now = t + i * step ;
+      while (!queue.empty() && queue.front().at <= now + 1e-9) {
+        car.steering_angle = queue.front().steering ;
+        car.throttle       = queue.front().throttle ;
+        queue.pop_front() ;
+      }
+
+      const double delta = - car.steering_angle ;
+      car.x     += car.speed * cos(car.psi) * step ;
+      car.y     += car.speed * sin(car.psi) * step ;
+      car.psi   += car.speed * delta / Lf * step ;
+      car.speed += car.throttle * step ;
+    }
+
+    stats.cte.push_back(distance(track, car.x, car.y)) ;
+  }
+}
+
+
+int main( int argc, const char *argv[] ) {
+
+  if (argc < 8) {
+    cout << " Usage ./mpc_bench ref_cte ref_epsi v val_throttle coeff_cost_ref_val_steering seq_throttle seq_steering"
+         << " [--rti] [--N 9] [--multi] [--latency .1]"
+         << " (--replay log | --track waypoints.csv [--seconds 60] [--v0 20] [--period .05])"
+         << "\n ie  ./mpc_bench 20 20 1 8 1100 16 600 --track ../lake_track_waypoints.csv" << endl ;
+    return -1 ;
+  }
+
+  vector<double> hyper_parameters ;
+  for (int i = 1; i < 8; i++) {
+    hyper_parameters.push_back( strtod( argv[i], NULL ) ) ;
+  }
+
+  bool rti = false ;
+  bool multi = false ;
+  size_t N = 9 ;
+  double latency = .10 ;
+  string replay_path, track_path ;
+  double seconds = 60 ;
+  double v0 = 20 ;
+  double period = .05 ;
+
+  for (int i = 8; i < argc; i++) {
+    string arg = argv[i] ;
+    bool has_value = i + 1 < argc ;
+    if (arg == "--rti")                      { rti = true ; }
+    else if (arg == "--multi")                { multi = true ; }
+    else if (arg == "--N" && has_value)       { N = strtoul(argv[++i], NULL, 10) ; }
+    else if (arg == "--latency" && has_value) { latency = strtod(argv[++i], NULL) ; }
+    else if (arg == "--replay" && has_value)  { replay_path = argv[++i] ; }
+    else if (arg == "--track" && has_value)   { track_path = argv[++i] ; }
+    else if (arg == "--seconds" && has_value) { seconds = strtod(argv[++i], NULL) ; }
+    else if (arg == "--v0" && has_value)      { v0 = strtod(argv[++i], NULL) ; }
+    else if (arg == "--period" && has_value)  { period = strtod(argv[++i], NULL) ; }
+    else {
+      cout << "Unknown argument " << arg << endl ;
+      return -1 ;
+    }
+  }
+
+  if (replay_path.empty() == track_path.empty()) {
+    cout << "Give one of --replay or --track" << endl ;
+    return -1 ;
+  }
+
+  vector<size_t> horizons = MPC::horizons() ;
+  if (find(horizons.begin(), horizons.end(), N) == horizons.end()) {
+    cout << "No MPC compiled for N = " << N << ", give one of" ;
+    for (size_t i = 0; i < horizons.size(); i++) {
+      cout << " " << horizons[i] ;
+    }
+    cout << endl ;
+    return -1 ;
+  }
+
+  MPC mpc(N) ;
+  mpc.Init(hyper_parameters) ;
+  mpc.backend = rti ? MPC::RTI : MPC::IPOPT ;
+  mpc.verbose = false ;
+
+  cout << (rti ? "RTI" : "IPOPT") << " N " << mpc.N << " latency " << latency << endl ;
+
+  // Same variants as ./mpc ... multi, solving within half the latency
+  Controller c = { mpc, NULL } ;
+  if (multi) {
+    MPC_variant primary ;
+    primary.name    = "primary" ;
+    primary.N       = mpc.N ;
+    primary.backend = mpc.backend ;
+    primary.weights = mpc.weights ;
+
+    c.multi = new MPC_multi(MPC_multi::default_variants(primary)) ;
+    c.multi->deadline = latency / 2 ;
+    c.multi->timeout  = latency ;
+    cout << "Solving " << c.multi->variants().size() << " variants per frame" << endl ;
+  }
+
+  Stats stats ;
+  if (!replay_path.empty()) {
+    if (!replay(c, replay_path, latency, stats)) {
+      return -1 ;
+    }
+  }
+  else {
+    Track track ;
+    if (!load_track(track_path, track)) {
+      return -1 ;
+    }
+    closed_loop(c, track, seconds, v0, period, latency, stats) ;
+  }
+
+  report(c, stats) ;
+  delete c.multi ;
+  return 0 ;
+}
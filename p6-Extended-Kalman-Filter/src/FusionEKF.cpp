@@ -6,6 +6,8 @@
 using namespace std;
 using Eigen::MatrixXd;
 using Eigen::VectorXd;
+using Eigen::Vector2d;
+using Eigen::Vector3d;
 using std::vector;
 
 /*
@@ -16,11 +18,11 @@ FusionEKF::FusionEKF() {
   is_initialized_ = false;
   previous_timestamp_ = 0;
 
-  // initializing matrices
-  R_laser_ = MatrixXd(2, 2);
-  R_radar_ = MatrixXd(3, 3);
+  // acceleration noise components for Q matrix.
+  noise_ax_ = 9;
+  noise_ay_ = 9;
 
-  H_laser_ = MatrixXd(2, 4);
+  // initializing matrices
   H_laser_ << 1, 0, 0, 0,
               0, 1, 0, 0;
 
@@ -33,24 +35,15 @@ FusionEKF::FusionEKF() {
               0,    0.0009, 0,
               0,    0,      0.09;
 
-  ekf_.P_ = MatrixXd(4, 4);
   ekf_.P_ <<  .5,    0,    0,      0,
               0,    .5,    0,      0,
               0,    0,    1000,   0,
               0,    0,    0,    1000;
 
   // state transistion matrix will change with time
-  ekf_.F_ = MatrixXd(4, 4);
-  ekf_.F_ << 1, 0, 0, 0,
-             0, 1, 0, 0,
-             0, 0, 1, 0,
-             0, 0, 0, 1;
-
-  ekf_.Q_ = MatrixXd(4, 4);
-  ekf_.Q_ << 0, 0, 0, 0,
-             0, 0, 0, 0,
-             0, 0, 0, 0,
-             0, 0, 0, 0;
+  ekf_.F_.setIdentity();
+
+  ekf_.Q_.setZero();
 
 }
 
@@ -68,7 +61,6 @@ void FusionEKF::ProcessMeasurement(const MeasurementPackage &measurement_pack) {
 
     // first measurement
     // cout << "EKF: " << endl;
-    ekf_.x_ = VectorXd(4);
     ekf_.x_ << 1, 1, 1, 1;
 
     if (measurement_pack.sensor_type_ == MeasurementPackage::RADAR) {
@@ -129,12 +121,10 @@ void FusionEKF::ProcessMeasurement(const MeasurementPackage &measurement_pack) {
     ekf_.F_(0, 2) = dt;
     ekf_.F_(1, 3) = dt;
 
-    // acceleration noise components for Q matrix.
-    const int noise_ax = 9;
-    const int noise_ay = 9;
+    const double noise_ax = noise_ax_;
+    const double noise_ay = noise_ay_;
 
-      // set covariance matrix Q
-    ekf_.Q_ = MatrixXd(4, 4);
+    // set covariance matrix Q, in place
     ekf_.Q_ <<  dt_4/4*noise_ax, 0,               dt_3/2*noise_ax, 0,
                 0,               dt_4/4*noise_ay, 0,               dt_3/2*noise_ay,
                 dt_3/2*noise_ax, 0,               dt_2*noise_ax,   0,
@@ -151,19 +141,19 @@ void FusionEKF::ProcessMeasurement(const MeasurementPackage &measurement_pack) {
   if (measurement_pack.sensor_type_ == MeasurementPackage::RADAR) {
 
     // Radar updates
-    ekf_.R_ = R_radar_;
+    const Vector3d z = measurement_pack.raw_measurements_.head<3>();
 
     // Lineraize measurement function
-    ekf_.H_ = tools.CalculateJacobian(ekf_.x_);
+    Hj_ = tools.CalculateJacobian(ekf_.x_);
 
     // State update with new measurements
-    ekf_.UpdateEKF(measurement_pack.raw_measurements_);
+    ekf_.UpdateEKF(z, tools.CartesianToPolar(ekf_.x_), Hj_, R_radar_);
 
   } else {  // Laser updates
-    ekf_.R_ = R_laser_;
-    ekf_.H_ = H_laser_;
+    const Vector2d z = measurement_pack.raw_measurements_.head<2>();
+
     // State update with new measurements
-    ekf_.Update(measurement_pack.raw_measurements_);
+    ekf_.Update(z, H_laser_, R_laser_);
   }
 
   // print the output
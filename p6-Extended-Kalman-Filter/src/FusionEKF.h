@@ -28,8 +28,20 @@ public:
 
   /**
   * Kalman Filter update and prediction math lives in here.
+  * State is px, py, vx, vy.
   */
-  KalmanFilter ekf_;
+  KalmanFilter<4> ekf_;
+
+  // acceleration noise variances of the process noise Q, 9 by default,
+  // may be set before or between measurements
+  double noise_ax_;
+  double noise_ay_;
+
+  // tool object used to compute Jacobian and RMSE, its warnings_ may be
+  // turned off
+  Tools tools;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
 private:
   // check whether the tracking toolbox was initiallized or not (first measurement)
@@ -38,12 +50,11 @@ private:
   // previous timestamp
   long long previous_timestamp_;
 
-  // tool object used to compute Jacobian and RMSE
-  Tools tools;
-  Eigen::MatrixXd R_laser_;
-  Eigen::MatrixXd R_radar_;
-  Eigen::MatrixXd H_laser_;
-  Eigen::MatrixXd Hj_;
+  // laser measures px, py and radar rho, phi, rho_dot
+  Eigen::Matrix2d R_laser_;
+  Eigen::Matrix3d R_radar_;
+  Eigen::Matrix<double, 2, 4> H_laser_;
+  Eigen::Matrix<double, 3, 4> Hj_;
 };
 
 #endif /* FusionEKF_H_ */
@@ -0,0 +1,176 @@
+#ifndef ESTIMATION_METRICS_H_
+#define ESTIMATION_METRICS_H_
+#include <stddef.h>
+#include <ostream>
+#include "Eigen/Dense"
+
+/*
+ * Accuracy and consistency of a run, accumulated one estimate at a time
+ * in constant memory:
+ *  - RMSE of px, py, vx, vy against the ground truth, over the whole run
+ *  - RMSE over consecutive windows of window_ estimates, the last complete
+ *    window's and the worst per element
+ *  - NIS per measurement dimension: the mean, which should be close to the
+ *    dimension, and the share above the chi-square 95 % point, which should
+ *    be close to 5 %
+ *
+ * Runs on other threads or other data merge with Merge(). Totals and NIS
+ * merge exactly, the worst windows by their maximum, and the last window
+ * stays this run's. A window still open in the merged run only counts
+ * towards the totals.
+ *
+ * The sums are in the order of Add(), so RMSE() is exactly what
+ * Tools::CalculateRMSE() gives for the same estimates.
+ *
+ * Tools::CalculateRMSE() is built on it. p7-Unscented-Kalman-Filter and
+ * sensor-fusion-play include it from this directory.
+ */
+class EstimationMetrics {
+public:
+
+  // measurement dimensions NIS is kept for, 1 to kMaxNISSize
+  static const int kMaxNISSize = 5;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * @param window Estimates per window RMSE, 0 for none
+   */
+  explicit EstimationMetrics(size_t window = 100) : window_(window) {
+    Reset();
+  }
+
+  void Reset() {
+    count_ = 0;
+    squared_.setZero();
+    window_count_ = 0;
+    window_squared_.setZero();
+    windows_ = 0;
+    last_window_.setZero();
+    worst_window_.setZero();
+    for (int i = 0; i < kMaxNISSize; i++) {
+      nis_count_[i] = 0;
+      nis_sum_[i] = 0;
+      nis_above_[i] = 0;
+    }
+  }
+
+  /**
+   * Adds an estimate and its ground truth, px, py, vx, vy
+   */
+  void Add(const Eigen::Vector4d &estimate, const Eigen::Vector4d &ground_truth) {
+    const Eigen::Vector4d residual = estimate - ground_truth;
+    const Eigen::Vector4d squared = residual.array() * residual.array();
+    squared_ += squared;
+    count_++;
+
+    if (window_ == 0) {
+      return;
+    }
+    window_squared_ += squared;
+    if (++window_count_ == window_) {
+      last_window_ = (window_squared_ / window_).array().sqrt();
+      worst_window_ = worst_window_.cwiseMax(last_window_);
+      windows_++;
+      window_count_ = 0;
+      window_squared_.setZero();
+    }
+  }
+
+  /**
+   * Adds the NIS of an update with a size dimensional measurement
+   */
+  void AddNIS(double nis, int size) {
+    if (size < 1 || size > kMaxNISSize) {
+      return;
+    }
+    // chi-square 95 % points for 1 to 5 degrees of freedom
+    static const double kChiSquare95[kMaxNISSize] = {3.841, 5.991, 7.815, 9.488, 11.070};
+    nis_count_[size - 1]++;
+    nis_sum_[size - 1] += nis;
+    if (nis > kChiSquare95[size - 1]) {
+      nis_above_[size - 1]++;
+    }
+  }
+
+  /**
+   * Folds in another run's metrics, see above
+   */
+  void Merge(const EstimationMetrics &other) {
+    count_ += other.count_;
+    squared_ += other.squared_;
+    if (other.windows_) {
+      if (!windows_) {
+        last_window_ = other.last_window_;
+      }
+      worst_window_ = worst_window_.cwiseMax(other.worst_window_);
+      windows_ += other.windows_;
+    }
+    for (int i = 0; i < kMaxNISSize; i++) {
+      nis_count_[i] += other.nis_count_[i];
+      nis_sum_[i] += other.nis_sum_[i];
+      nis_above_[i] += other.nis_above_[i];
+    }
+  }
+
+  size_t count() const { return count_; }
+
+  /**
+   * RMSE over everything added, zeros if nothing was
+   */
+  Eigen::Vector4d RMSE() const {
+    if (count_ == 0) {
+      return Eigen::Vector4d::Zero();
+    }
+    return (squared_ / count_).array().sqrt();
+  }
+
+  // estimates per window, complete windows, the last one's RMSE and the
+  // worst of each element
+  size_t window() const { return window_; }
+  size_t windows() const { return windows_; }
+  const Eigen::Vector4d &LastWindowRMSE() const { return last_window_; }
+  const Eigen::Vector4d &WorstWindowRMSE() const { return worst_window_; }
+
+  // NIS of size dimensional measurements
+  size_t NISCount(int size) const { return nis_count_[size - 1]; }
+  double MeanNIS(int size) const {
+    return nis_count_[size - 1] ? nis_sum_[size - 1] / nis_count_[size - 1] : 0;
+  }
+  double NISAbove95(int size) const {
+    return nis_count_[size - 1] ? (double)nis_above_[size - 1] / nis_count_[size - 1] : 0;
+  }
+
+  /**
+   * Writes the summary ExtendedKF and UnscentedKF print: the RMSE, the
+   * worst window's and the NIS of laser (2 dimensional) and radar (3)
+   */
+  void PrintSummary(std::ostream &out) const {
+    out << "Accuracy - RMSE:" << std::endl << RMSE() << std::endl;
+    if (windows_) {
+      out << "Worst RMSE over " << window_ << " measurements:" << std::endl
+          << worst_window_ << std::endl;
+    }
+    out << "NIS laser: mean " << MeanNIS(2) << ", above 95 % " << NISAbove95(2)
+        << "; radar: mean " << MeanNIS(3) << ", above 95 % " << NISAbove95(3) << std::endl;
+  }
+
+private:
+
+  size_t window_;
+
+  size_t count_;
+  Eigen::Vector4d squared_;      // sums of squared residuals
+
+  size_t window_count_;
+  Eigen::Vector4d window_squared_;
+  size_t windows_;
+  Eigen::Vector4d last_window_;
+  Eigen::Vector4d worst_window_;
+
+  size_t nis_count_[kMaxNISSize];
+  double nis_sum_[kMaxNISSize];
+  size_t nis_above_[kMaxNISSize];
+};
+
+#endif /* ESTIMATION_METRICS_H_ */
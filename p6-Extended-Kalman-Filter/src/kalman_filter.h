@@ -1,69 +1,167 @@
 #ifndef KALMAN_FILTER_H_
 #define KALMAN_FILTER_H_
 #include "Eigen/Dense"
+#include "kalman_update.h"
 
+/*
+ * Kalman filter over a state of Nx elements.
+ *
+ * All sizes are known at compile time: the state is Nx, and every sensor's
+ * measurement dimension Nz comes in with its z, H and R. Nothing is allocated
+ * on the heap, the temporaries of Predict() and Update() are fixed size and
+ * live on the stack.
+ *
+ * F_ and Q_ belong to the filter and are set in place before Predict().
+ * H and R belong to the sensor and are passed to the update.
+ *
+ * The update itself is KalmanUpdate() in kalman_update.h, Joseph form and
+ * no S.inverse(). An update whose S isn't positive definite is skipped.
+ */
+template <int Nx>
 class KalmanFilter {
 public:
 
+  typedef Eigen::Matrix<double, Nx, 1> StateVector;
+  typedef Eigen::Matrix<double, Nx, Nx> StateMatrix;
+
   // state vector
-  Eigen::VectorXd x_;
+  StateVector x_;
 
   // state covariance matrix
-  Eigen::MatrixXd P_;
+  StateMatrix P_;
 
   // state transistion matrix
-  Eigen::MatrixXd F_;
+  StateMatrix F_;
 
   // process covariance matrix
-  Eigen::MatrixXd Q_;
+  StateMatrix Q_;
 
-  // measurement matrix
-  Eigen::MatrixXd H_;
+  // whether the last update was applied, and its normalized innovation
+  // squared if so
+  bool updated_ = false;
+  double nis_ = 0;
 
-  // measurement covariance matrix
-  Eigen::MatrixXd R_;
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   /**
    * Constructor
    */
-  KalmanFilter();
+  KalmanFilter() {}
 
   /**
    * Destructor
    */
-  virtual ~KalmanFilter();
+  virtual ~KalmanFilter() {}
 
   /**
    * Init Initializes Kalman filter
    * @param x_in Initial state
    * @param P_in Initial state covariance
    * @param F_in Transition matrix
-   * @param H_in Measurement matrix
-   * @param R_in Measurement covariance matrix
    * @param Q_in Process covariance matrix
    */
-  void Init(Eigen::VectorXd &x_in, Eigen::MatrixXd &P_in, Eigen::MatrixXd &F_in,
-      Eigen::MatrixXd &H_in, Eigen::MatrixXd &R_in, Eigen::MatrixXd &Q_in);
+  void Init(const StateVector &x_in, const StateMatrix &P_in,
+            const StateMatrix &F_in, const StateMatrix &Q_in);
 
   /**
    * Prediction Predicts the state and the state covariance
    * using the process model
-   * @param delta_T Time between k and k+1 in s
    */
   void Predict();
 
   /**
    * Updates the state by using standard Kalman Filter equations
    * @param z The measurement at k+1
+   * @param H Measurement matrix
+   * @param R Measurement covariance matrix
    */
-  void Update(const Eigen::VectorXd &z);
+  template <int Nz>
+  void Update(const Eigen::Matrix<double, Nz, 1> &z,
+              const Eigen::Matrix<double, Nz, Nx> &H,
+              const Eigen::Matrix<double, Nz, Nz> &R);
 
   /**
    * Updates the state by using Extended Kalman Filter equations
    * @param z The measurement at k+1
+   * @param z_pred The measurement function at the predicted state, h(x)
+   * @param H Jacobian of h at the predicted state
+   * @param R Measurement covariance matrix
    */
-  void UpdateEKF(const Eigen::VectorXd &z);
+  template <int Nz>
+  void UpdateEKF(const Eigen::Matrix<double, Nz, 1> &z,
+                 const Eigen::Matrix<double, Nz, 1> &z_pred,
+                 const Eigen::Matrix<double, Nz, Nx> &H,
+                 const Eigen::Matrix<double, Nz, Nz> &R);
+
+private:
+
+  // Shared by Update() and UpdateEKF(), y is the innovation z - z_pred
+  template <int Nz>
+  void UpdateInnovation(const Eigen::Matrix<double, Nz, 1> &y,
+                        const Eigen::Matrix<double, Nz, Nx> &H,
+                        const Eigen::Matrix<double, Nz, Nz> &R);
 
 };
 
+template <int Nx>
+void KalmanFilter<Nx>::Init(const StateVector &x_in, const StateMatrix &P_in,
+                            const StateMatrix &F_in, const StateMatrix &Q_in) {
+  x_ = x_in;  // object state
+  P_ = P_in;  // object covariance matrix
+  F_ = F_in;  // state transistion matrix
+  Q_ = Q_in;  // process covariance matrix
+}
+
+template <int Nx>
+void KalmanFilter<Nx>::Predict() {
+  /*
+   * Predict the state
+   */
+
+  // fixed size products are evaluated into stack temporaries, so these are
+  // safe to assign onto their own operands
+  x_ = F_ * x_;
+  P_ = F_ * P_ * F_.transpose() + Q_;
+}
+
+template <int Nx>
+template <int Nz>
+void KalmanFilter<Nx>::Update(const Eigen::Matrix<double, Nz, 1> &z,
+                              const Eigen::Matrix<double, Nz, Nx> &H,
+                              const Eigen::Matrix<double, Nz, Nz> &R) {
+  /*
+   * Update the state
+   */
+
+  const Eigen::Matrix<double, Nz, 1> y = z - H * x_;
+  UpdateInnovation<Nz>(y, H, R);
+}
+
+template <int Nx>
+template <int Nz>
+void KalmanFilter<Nx>::UpdateEKF(const Eigen::Matrix<double, Nz, 1> &z,
+                                 const Eigen::Matrix<double, Nz, 1> &z_pred,
+                                 const Eigen::Matrix<double, Nz, Nx> &H,
+                                 const Eigen::Matrix<double, Nz, Nz> &R) {
+  /*
+   * update the state by using Extended Kalman Filter equations
+   */
+
+  const Eigen::Matrix<double, Nz, 1> y = z - z_pred;
+  UpdateInnovation<Nz>(y, H, R);
+}
+
+template <int Nx>
+template <int Nz>
+void KalmanFilter<Nx>::UpdateInnovation(const Eigen::Matrix<double, Nz, 1> &y,
+                                        const Eigen::Matrix<double, Nz, Nx> &H,
+                                        const Eigen::Matrix<double, Nz, Nz> &R) {
+
+  KalmanGain<Nx, Nz> gain;
+  updated_ = KalmanUpdate<Nx, Nz>(x_, P_, y, H, R, gain);
+  if (updated_) {
+    nis_ = gain.nis;
+  }
+}
+
 #endif /* KALMAN_FILTER_H_ */
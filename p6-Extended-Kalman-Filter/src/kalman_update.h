@@ -0,0 +1,255 @@
+#ifndef KALMAN_UPDATE_H_
+#define KALMAN_UPDATE_H_
+#include "Eigen/Dense"
+
+/*
+ * Measurement update kernels shared by the filters:
+ *  - KalmanFilter<Nx> in this project (laser and radar EKF)
+ *  - UKF in p7-Unscented-Kalman-Filter (laser and radar)
+ *  - sensor-fusion-play/laserMeasurement
+ * The other two add this directory to their include path.
+ *
+ * The innovation covariance S is symmetric positive definite and only
+ * 2x2 or 3x3, so S^-1 is never formed. SymmetricSolver keeps the unique
+ * cofactors of S (closed form, 3 or 6 of them) and applies them as row
+ * combinations, other sizes fall back to a fixed size LDLT. The same
+ * solver gives
+ *  - the gain, K = P H^T S^-1, solved as S K^T = H P
+ *  - the NIS, y^T S^-1 y
+ *
+ * Everything is fixed size, no heap use.
+ */
+
+// Solves with a small symmetric positive definite S, LDLT for any size
+template <int Nz>
+class SymmetricSolver {
+public:
+
+  typedef Eigen::Matrix<double, Nz, Nz> Matrix;
+  typedef Eigen::Matrix<double, Nz, 1> Vector;
+
+  /**
+   * Factors S
+   * @return false if S isn't positive definite, nothing can be solved then
+   */
+  bool Compute(const Matrix &S) {
+    ldlt_.compute(S);
+    return ldlt_.info() == Eigen::Success && (ldlt_.vectorD().array() > 0).all();
+  }
+
+  /**
+   * Solves S X = B in place
+   */
+  template <int Cols>
+  void SolveInPlace(Eigen::Matrix<double, Nz, Cols> &B) const {
+    ldlt_.solveInPlace(B);
+  }
+
+  /**
+   * Squared Mahalanobis distance y^T S^-1 y, the NIS for an innovation
+   */
+  double Mahalanobis(const Vector &y) const {
+    return y.dot(ldlt_.solve(y));
+  }
+
+private:
+  Eigen::LDLT<Matrix> ldlt_;
+};
+
+// Closed form, S = [a b; b c]
+template <>
+class SymmetricSolver<2> {
+public:
+
+  typedef Eigen::Matrix2d Matrix;
+  typedef Eigen::Vector2d Vector;
+
+  bool Compute(const Matrix &S) {
+    a_ = S(0, 0);
+    b_ = S(1, 0);
+    c_ = S(1, 1);
+    double det = a_ * c_ - b_ * b_;
+    // leading minors, also catches NaN
+    if (!(a_ > 0 && det > 0)) {
+      return false;
+    }
+    inv_det_ = 1. / det;
+    return true;
+  }
+
+  template <int Cols>
+  void SolveInPlace(Eigen::Matrix<double, 2, Cols> &B) const {
+    const Eigen::Matrix<double, 1, Cols> r0 = B.row(0);
+    const Eigen::Matrix<double, 1, Cols> r1 = B.row(1);
+    B.row(0) = (c_ * r0 - b_ * r1) * inv_det_;
+    B.row(1) = (a_ * r1 - b_ * r0) * inv_det_;
+  }
+
+  double Mahalanobis(const Vector &y) const {
+    return (c_ * y(0) * y(0) - 2 * b_ * y(0) * y(1) + a_ * y(1) * y(1)) * inv_det_;
+  }
+
+private:
+  double a_, b_, c_, inv_det_;
+};
+
+// Closed form, S = [a b c; b d e; c e f], adj(S) = [A B C; B D E; C E F]
+template <>
+class SymmetricSolver<3> {
+public:
+
+  typedef Eigen::Matrix3d Matrix;
+  typedef Eigen::Vector3d Vector;
+
+  bool Compute(const Matrix &S) {
+    const double a = S(0, 0), b = S(1, 0), c = S(2, 0);
+    const double d = S(1, 1), e = S(2, 1), f = S(2, 2);
+    A_ = d * f - e * e;
+    B_ = c * e - b * f;
+    C_ = b * e - c * d;
+    D_ = a * f - c * c;
+    E_ = b * c - a * e;
+    F_ = a * d - b * b;
+    double det = a * A_ + b * B_ + c * C_;
+    // leading minors, also catches NaN
+    if (!(a > 0 && F_ > 0 && det > 0)) {
+      return false;
+    }
+    inv_det_ = 1. / det;
+    return true;
+  }
+
+  template <int Cols>
+  void SolveInPlace(Eigen::Matrix<double, 3, Cols> &B) const {
+    const Eigen::Matrix<double, 1, Cols> r0 = B.row(0);
+    const Eigen::Matrix<double, 1, Cols> r1 = B.row(1);
+    const Eigen::Matrix<double, 1, Cols> r2 = B.row(2);
+    B.row(0) = (A_ * r0 + B_ * r1 + C_ * r2) * inv_det_;
+    B.row(1) = (B_ * r0 + D_ * r1 + E_ * r2) * inv_det_;
+    B.row(2) = (C_ * r0 + E_ * r1 + F_ * r2) * inv_det_;
+  }
+
+  double Mahalanobis(const Vector &y) const {
+    return (A_ * y(0) * y(0) + D_ * y(1) * y(1) + F_ * y(2) * y(2) +
+            2 * (B_ * y(0) * y(1) + C_ * y(0) * y(2) + E_ * y(1) * y(2))) * inv_det_;
+  }
+
+private:
+  double A_, B_, C_, D_, E_, F_, inv_det_;
+};
+
+// What an update computed besides the new x and P
+template <int Nx, int Nz>
+struct KalmanGain {
+  Eigen::Matrix<double, Nx, Nz> K;
+  double nis;
+};
+
+/**
+ * Linear (or linearized) update, the covariance in Joseph form multiplied
+ * out
+ *   P = P - K H P - (K H P)^T + K S K^T
+ * which is (I - K H) P (I - K H)^T + K R K^T for any K, so an error in K
+ * changes P only to second order. Being a difference it doesn't keep P
+ * positive semidefinite under rounding, the factored form would.
+ * @param x State, updated
+ * @param P State covariance, updated
+ * @param y Innovation, z - H x or z - h(x)
+ * @param H Measurement matrix or Jacobian
+ * @param R Measurement covariance
+ * @param gain K and the NIS of y
+ * @return false, and x and P untouched, if S isn't positive definite
+ */
+template <int Nx, int Nz>
+bool KalmanUpdate(Eigen::Matrix<double, Nx, 1> &x,
+                  Eigen::Matrix<double, Nx, Nx> &P,
+                  const Eigen::Matrix<double, Nz, 1> &y,
+                  const Eigen::Matrix<double, Nz, Nx> &H,
+                  const Eigen::Matrix<double, Nz, Nz> &R,
+                  KalmanGain<Nx, Nz> &gain) {
+
+  // H P, and S = H P H^T + R
+  Eigen::Matrix<double, Nz, Nx> H_P;
+  H_P.noalias() = H * P;
+  Eigen::Matrix<double, Nz, Nz> S = R;
+  S.noalias() += H_P * H.transpose();
+
+  SymmetricSolver<Nz> solver;
+  if (!solver.Compute(S)) {
+    return false;
+  }
+
+  // S K^T = H P, P is symmetric
+  Eigen::Matrix<double, Nz, Nx> K_transpose = H_P;
+  solver.SolveInPlace(K_transpose);
+  gain.K = K_transpose.transpose();
+  gain.nis = solver.Mahalanobis(y);
+
+  // new estimate
+  x.noalias() += gain.K * y;
+
+  // Joseph form multiplied out, see above. Only Nx x Nz products, no
+  // Nx x Nx x Nx ones. Rounding would leave P a little asymmetric and this
+  // form doesn't damp that, so only the lower triangle is computed and
+  // mirrored.
+  Eigen::Matrix<double, Nx, Nx> K_H_P;
+  K_H_P.noalias() = gain.K * H_P;
+  Eigen::Matrix<double, Nx, Nz> K_S;
+  K_S.noalias() = gain.K * S;
+  Eigen::Matrix<double, Nx, Nx> K_S_K;
+  K_S_K.noalias() = K_S * gain.K.transpose();
+  for (int j = 0; j < Nx; j++) {
+    for (int i = j; i < Nx; i++) {
+      P(i, j) += K_S_K(i, j) - K_H_P(i, j) - K_H_P(j, i);
+      P(j, i) = P(i, j);
+    }
+  }
+  return true;
+}
+
+/**
+ * Unscented update from the sigma point statistics
+ *   K = Tc S^-1, P = P - K S K^T
+ * There's no H for a Joseph form, K S K^T is formed as K Tc^T and P is
+ * kept symmetric by writing its lower triangle only and mirroring it.
+ * @param x State, updated
+ * @param P State covariance, updated
+ * @param y Innovation, z - z_pred with any angles normalized
+ * @param Tc Cross covariance of state and measurement
+ * @param S Innovation covariance, R included
+ * @param gain K and the NIS of y
+ * @return false, and x and P untouched, if S isn't positive definite
+ */
+template <int Nx, int Nz>
+bool UnscentedUpdate(Eigen::Matrix<double, Nx, 1> &x,
+                     Eigen::Matrix<double, Nx, Nx> &P,
+                     const Eigen::Matrix<double, Nz, 1> &y,
+                     const Eigen::Matrix<double, Nx, Nz> &Tc,
+                     const Eigen::Matrix<double, Nz, Nz> &S,
+                     KalmanGain<Nx, Nz> &gain) {
+
+  SymmetricSolver<Nz> solver;
+  if (!solver.Compute(S)) {
+    return false;
+  }
+
+  // S K^T = Tc^T
+  Eigen::Matrix<double, Nz, Nx> K_transpose = Tc.transpose();
+  solver.SolveInPlace(K_transpose);
+  gain.K = K_transpose.transpose();
+  gain.nis = solver.Mahalanobis(y);
+
+  // new estimate, K S K^T = Tc S^-1 Tc^T = K Tc^T, lower triangle mirrored
+  x.noalias() += gain.K * y;
+  Eigen::Matrix<double, Nx, Nx> K_S_K;
+  K_S_K.noalias() = gain.K * Tc.transpose();
+  for (int j = 0; j < Nx; j++) {
+    for (int i = j; i < Nx; i++) {
+      P(i, j) -= K_S_K(i, j);
+      P(j, i) = P(i, j);
+    }
+  }
+  return true;
+}
+
+#endif /* KALMAN_UPDATE_H_ */
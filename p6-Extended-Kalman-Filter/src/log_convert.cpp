@@ -0,0 +1,39 @@
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include "measurement_log.h"
+
+using namespace std;
+
+/*
+ * Converts a text measurement log to the binary one of measurement_log.h,
+ * which ExtendedKF and UnscentedKF replay as they do the text.
+ *
+ *   ./log_convert path/to/input.txt path/to/output.kflog
+ */
+int main(int argc, char* argv[]) {
+
+  if (argc != 3) {
+    cerr << "Usage instructions: " << argv[0] << " path/to/input.txt output.kflog" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  size_t skipped = 0;
+  if (!measurement_log::Convert(argv[1], argv[2], skipped)) {
+    cerr << "Cannot convert " << argv[1] << " to " << argv[2] << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (skipped) {
+    cerr << "Skipped " << skipped << " unreadable lines" << endl;
+  }
+
+  MeasurementLog log;
+  if (!log.Open(argv[2])) {
+    cerr << "Cannot read back " << argv[2] << endl;
+    exit(EXIT_FAILURE);
+  }
+  cout << log.size() << " records, "
+       << log.count(MeasurementRecord::LASER) << " laser, "
+       << log.count(MeasurementRecord::RADAR) << " radar" << endl;
+  return 0;
+}
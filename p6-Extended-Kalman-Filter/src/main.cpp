@@ -1,12 +1,12 @@
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <vector>
 #include <stdlib.h>
 #include "Eigen/Dense"
 #include "FusionEKF.h"
-#include "ground_truth_package.h"
+#include "estimation_metrics.h"
 #include "measurement_package.h"
+#include "measurement_reader.h"
+#include "result_writer.h"
 
 using namespace std;
 using Eigen::MatrixXd;
@@ -36,8 +36,8 @@ void check_arguments(int argc, char* argv[]) {
   }
 }
 
-void check_files(ifstream& in_file, string& in_name,
-                 ofstream& out_file, string& out_name) {
+void check_files(MeasurementReader& in_file, string& in_name,
+                 ResultWriter& out_file, string& out_name) {
   if (!in_file.is_open()) {
     cerr << "Cannot open input file: " << in_name << endl;
     exit(EXIT_FAILURE);
@@ -54,131 +54,98 @@ int main(int argc, char* argv[]) {
   check_arguments(argc, argv);
 
   string in_file_name_ = argv[1];
-  ifstream in_file_(in_file_name_.c_str(), ifstream::in);
+  MeasurementReader in_file_;
+  in_file_.Open(in_file_name_);
 
+  // rows are written by a thread of their own, as binary records if the
+  // output is a .bin
   string out_file_name_ = argv[2];
-  ofstream out_file_(out_file_name_.c_str(), ofstream::out);
+  bool binary = out_file_name_.size() > 4 &&
+                out_file_name_.compare(out_file_name_.size() - 4, 4, ".bin") == 0;
+  ResultWriter out_file_;
+  out_file_.Open(out_file_name_, binary ? ResultWriter::BINARY : ResultWriter::TEXT);
 
   check_files(in_file_, in_file_name_, out_file_, out_file_name_);
 
-  vector<MeasurementPackage> measurement_pack_list;
-  vector<GroundTruthPackage> gt_pack_list;
-
-  string line;
-
-  // prep the measurement packages (each line represents a measurement at a
-  // timestamp)
-  while (getline(in_file_, line)) {
-
-    string sensor_type;
-    MeasurementPackage meas_package;
-    GroundTruthPackage gt_package;
-    istringstream iss(line);
-    long long timestamp;
-
-    // reads first element from the current line
-    iss >> sensor_type;
-    if (sensor_type.compare("L") == 0) {
-      // LASER MEASUREMENT
-
-      // read measurements at this timestamp
-      meas_package.sensor_type_ = MeasurementPackage::LASER;
-      meas_package.raw_measurements_ = VectorXd(2);
-      float x;
-      float y;
-      iss >> x;
-      iss >> y;
-      meas_package.raw_measurements_ << x, y;
-      iss >> timestamp;
-      meas_package.timestamp_ = timestamp;
-      measurement_pack_list.push_back(meas_package);
-    } else if (sensor_type.compare("R") == 0) {
-      // RADAR MEASUREMENT
-
-      // read measurements at this timestamp
-      meas_package.sensor_type_ = MeasurementPackage::RADAR;
-      meas_package.raw_measurements_ = VectorXd(3);
-      float ro;
-      float phi;
-      float ro_dot;
-      iss >> ro;
-      iss >> phi;
-      iss >> ro_dot;
-      meas_package.raw_measurements_ << ro, phi, ro_dot;
-      iss >> timestamp;
-      meas_package.timestamp_ = timestamp;
-      measurement_pack_list.push_back(meas_package);
-    }
-
-    // read ground truth data to compare later
-    float x_gt;
-    float y_gt;
-    float vx_gt;
-    float vy_gt;
-    iss >> x_gt;
-    iss >> y_gt;
-    iss >> vx_gt;
-    iss >> vy_gt;
-    gt_package.gt_values_ = VectorXd(4);
-    gt_package.gt_values_ << x_gt, y_gt, vx_gt, vy_gt;
-    gt_pack_list.push_back(gt_package);
-  }
+  // The log is streamed a line at a time into one package per sensor,
+  // allocated once here
+  MeasurementRecord record;
+  MeasurementPackage laser_package;
+  laser_package.sensor_type_ = MeasurementPackage::LASER;
+  laser_package.raw_measurements_ = VectorXd(2);
+  MeasurementPackage radar_package;
+  radar_package.sensor_type_ = MeasurementPackage::RADAR;
+  radar_package.raw_measurements_ = VectorXd(3);
+  Eigen::Vector4d gt_values;
 
   // Create a Fusion EKF instance
   FusionEKF fusionEKF;
 
-  // used to compute the RMSE later
-  vector<VectorXd> estimations;
-  vector<VectorXd> ground_truth;
+  // RMSE and NIS, accumulated as the estimates come
+  EstimationMetrics metrics;
 
   //Call the EKF-based fusion
-  size_t N = measurement_pack_list.size();
-  for (size_t k = 0; k < N; ++k) {
+  while (in_file_.Next(record)) {
+    MeasurementPackage &meas_package =
+        record.sensor_type == MeasurementRecord::LASER ? laser_package : radar_package;
+    meas_package.timestamp_ = record.timestamp;
+    meas_package.raw_measurements_ = Eigen::Map<const VectorXd>(record.raw, record.size);
+    gt_values = Eigen::Map<const Eigen::Vector4d>(record.ground_truth);
+
     // start filtering from the second frame (the speed is unknown in the first
     // frame)
-    fusionEKF.ProcessMeasurement(measurement_pack_list[k]);
+    fusionEKF.ProcessMeasurement(meas_package);
+
+    ResultRecord row;
 
     // output the estimation
-    out_file_ << fusionEKF.ekf_.x_(0) << "\t";
-    out_file_ << fusionEKF.ekf_.x_(1) << "\t";
-    out_file_ << fusionEKF.ekf_.x_(2) << "\t";
-    out_file_ << fusionEKF.ekf_.x_(3) << "\t";
+    row.Add(fusionEKF.ekf_.x_(0));
+    row.Add(fusionEKF.ekf_.x_(1));
+    row.Add(fusionEKF.ekf_.x_(2));
+    row.Add(fusionEKF.ekf_.x_(3));
 
     // output the measurements
-    if (measurement_pack_list[k].sensor_type_ == MeasurementPackage::LASER) {
+    if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
       // output the estimation
-      out_file_ << measurement_pack_list[k].raw_measurements_(0) << "\t";
-      out_file_ << measurement_pack_list[k].raw_measurements_(1) << "\t";
-    } else if (measurement_pack_list[k].sensor_type_ == MeasurementPackage::RADAR) {
+      row.Add(meas_package.raw_measurements_(0));
+      row.Add(meas_package.raw_measurements_(1));
+    } else if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
       // output the estimation in the cartesian coordinates
-      float ro = measurement_pack_list[k].raw_measurements_(0);
-      float phi = measurement_pack_list[k].raw_measurements_(1);
-      out_file_ << ro * cos(phi) << "\t"; // p1_meas
-      out_file_ << ro * sin(phi) << "\t"; // ps_meas
+      float ro = meas_package.raw_measurements_(0);
+      float phi = meas_package.raw_measurements_(1);
+      row.Add(ro * cos(phi)); // p1_meas
+      row.Add(ro * sin(phi)); // ps_meas
     }
 
     // output the ground truth packages
-    out_file_ << gt_pack_list[k].gt_values_(0) << "\t";
-    out_file_ << gt_pack_list[k].gt_values_(1) << "\t";
-    out_file_ << gt_pack_list[k].gt_values_(2) << "\t";
-    out_file_ << gt_pack_list[k].gt_values_(3) << "\n";
+    row.Add(gt_values(0));
+    row.Add(gt_values(1));
+    row.Add(gt_values(2));
+    row.Add(gt_values(3));
 
-    estimations.push_back(fusionEKF.ekf_.x_);
-    ground_truth.push_back(gt_pack_list[k].gt_values_);
+    out_file_.Push(row);
+
+    // no NIS for the first measurement, which only initializes, or an
+    // update that couldn't be applied
+    if (fusionEKF.ekf_.updated_) {
+      metrics.AddNIS(fusionEKF.ekf_.nis_, record.size);
+    }
+    metrics.Add(fusionEKF.ekf_.x_, gt_values);
   }
 
-  // compute the accuracy (RMSE)
-  Tools tools;
-  cout << "Accuracy - RMSE:" << endl << tools.CalculateRMSE(estimations, ground_truth) << endl;
+  if (in_file_.skipped()) {
+    cerr << "Skipped " << in_file_.skipped() << " unreadable lines of " << in_file_.lines() << endl;
+  }
+
+  // the accuracy (RMSE) and the consistency (NIS)
+  metrics.PrintSummary(cout);
 
   // close files
-  if (out_file_.is_open()) {
-    out_file_.close();
+  if (!out_file_.Close()) {
+    cerr << "Cannot write output file: " << out_file_name_ << endl;
   }
 
-  if (in_file_.is_open()) {
-    in_file_.close();
-  }
+  in_file_.Close();
 
   return 0;
 }
@@ -0,0 +1,360 @@
+#include "measurement_log.h"
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace measurement_log;
+
+static uint64_t Align(uint64_t offset) {
+  return (offset + 7) & ~(uint64_t)7;
+}
+
+/*****************************************************************************
+ *  Conversion
+ ****************************************************************************/
+
+// Appends to one column of the file, buffered
+class ColumnWriter {
+public:
+  ColumnWriter(int fd, uint64_t offset) : fd_(fd), offset_(offset), ok_(true) {
+    buffer_.reserve(kBuffer);
+  }
+
+  void Append(const void *value, size_t size) {
+    if (buffer_.size() + size > kBuffer) {
+      Flush();
+    }
+    buffer_.insert(buffer_.end(), (const char *)value, (const char *)value + size);
+  }
+
+  bool Flush() {
+    const char *p = buffer_.data();
+    size_t left = buffer_.size();
+    while (ok_ && left) {
+      ssize_t n = pwrite(fd_, p, left, offset_);
+      if (n <= 0) {
+        ok_ = false;
+        break;
+      }
+      p += n;
+      left -= n;
+      offset_ += n;
+    }
+    buffer_.clear();
+    return ok_;
+  }
+
+private:
+  static const size_t kBuffer = 64 << 10;
+  int fd_;
+  uint64_t offset_;
+  bool ok_;
+  vector<char> buffer_;
+};
+
+bool measurement_log::Convert(const string &text_path, const string &log_path, size_t &skipped) {
+
+  MeasurementReader reader;
+  MeasurementRecord record;
+
+  // first pass, the counts
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.sections[MeasurementRecord::LASER].size = 2;
+  header.sections[MeasurementRecord::RADAR].size = 3;
+  header.sections[MeasurementRecord::LASER].has_ground_truth = 1;
+  header.sections[MeasurementRecord::RADAR].has_ground_truth = 1;
+
+  if (!reader.Open(text_path)) {
+    return false;
+  }
+  while (reader.Next(record)) {
+    Section &section = header.sections[record.sensor_type];
+    section.count++;
+    if (!record.has_ground_truth) {
+      section.has_ground_truth = 0;
+    }
+    header.records++;
+  }
+  skipped = reader.skipped();
+
+  // layout
+  uint64_t offset = Align(sizeof(Header));
+  header.sequence_offset = offset;
+  offset = Align(offset + header.records);
+  for (int s = 0; s < 2; s++) {
+    Section &section = header.sections[s];
+    section.timestamp_offset = offset;
+    offset = Align(offset + section.count * sizeof(int64_t));
+    for (uint32_t i = 0; i < section.size; i++) {
+      section.raw_offset[i] = offset;
+      offset = Align(offset + section.count * sizeof(float));
+    }
+    for (int i = 0; section.has_ground_truth && i < 4; i++) {
+      section.ground_truth_offset[i] = offset;
+      offset = Align(offset + section.count * sizeof(float));
+    }
+  }
+  header.index_offset = offset;
+  header.index_entries = (header.records + kStride - 1) / kStride;
+  offset += header.index_entries * sizeof(IndexEntry);
+
+  int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = ftruncate(fd, offset) == 0;
+
+  // second pass, the columns
+  ColumnWriter sequence(fd, header.sequence_offset);
+  vector<ColumnWriter> columns[2];
+  for (int s = 0; s < 2; s++) {
+    const Section &section = header.sections[s];
+    columns[s].push_back(ColumnWriter(fd, section.timestamp_offset));
+    for (uint32_t i = 0; i < section.size; i++) {
+      columns[s].push_back(ColumnWriter(fd, section.raw_offset[i]));
+    }
+    for (int i = 0; section.has_ground_truth && i < 4; i++) {
+      columns[s].push_back(ColumnWriter(fd, section.ground_truth_offset[i]));
+    }
+  }
+  ColumnWriter index(fd, header.index_offset);
+
+  IndexEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.timestamp = INT64_MIN;
+  reader.Open(text_path);
+  for (uint64_t r = 0; ok && reader.Next(record); r++) {
+    const int s = record.sensor_type;
+    entry.timestamp = max(entry.timestamp, (int64_t)record.timestamp);
+    if (r % kStride == 0) {
+      entry.record = r;
+      index.Append(&entry, sizeof(entry));
+    }
+    entry.cursor[s]++;
+
+    uint8_t sensor = s;
+    sequence.Append(&sensor, 1);
+    vector<ColumnWriter> &column = columns[s];
+    int64_t timestamp = record.timestamp;
+    column[0].Append(&timestamp, sizeof(timestamp));
+    for (int i = 0; i < record.size; i++) {
+      float value = record.raw[i];
+      column[1 + i].Append(&value, sizeof(value));
+    }
+    for (int i = 0; header.sections[s].has_ground_truth && i < 4; i++) {
+      float value = record.ground_truth[i];
+      column[1 + record.size + i].Append(&value, sizeof(value));
+    }
+  }
+
+  ok = ok && sequence.Flush() && index.Flush();
+  for (int s = 0; s < 2; s++) {
+    for (size_t i = 0; i < columns[s].size(); i++) {
+      ok = ok && columns[s][i].Flush();
+    }
+  }
+  ok = ok && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+  ok = close(fd) == 0 && ok;
+  return ok;
+}
+
+
+/*****************************************************************************
+ *  Replay
+ ****************************************************************************/
+
+MeasurementLog::MeasurementLog()
+    : data_(NULL), size_(0), header_(NULL), sequence_(NULL), index_(NULL),
+      record_(0) {
+  cursor_[0] = cursor_[1] = 0;
+}
+
+MeasurementLog::~MeasurementLog() {
+  Close();
+}
+
+bool MeasurementLog::IsLog(const string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  char magic[sizeof(kMagic)];
+  bool is_log = read(fd, magic, sizeof(magic)) == sizeof(magic) &&
+                memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  close(fd);
+  return is_log;
+}
+
+bool MeasurementLog::Open(const string &path) {
+
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  data_ = (const char *)map;
+  size_ = st.st_size;
+  header_ = (const Header *)data_;
+  if (!Valid()) {
+    Close();
+    return false;
+  }
+  madvise(map, size_, MADV_SEQUENTIAL);
+  sequence_ = (const uint8_t *)(data_ + header_->sequence_offset);
+  index_ = (const IndexEntry *)(data_ + header_->index_offset);
+  record_ = 0;
+  cursor_[0] = cursor_[1] = 0;
+  return true;
+}
+
+void MeasurementLog::Close() {
+  if (data_) {
+    munmap((void *)data_, size_);
+  }
+  data_ = NULL;
+  size_ = 0;
+  header_ = NULL;
+  sequence_ = NULL;
+  index_ = NULL;
+}
+
+// Every offset in the header inside the file and aligned, the counts
+// adding up
+bool MeasurementLog::Valid() const {
+
+  const Header &h = *header_;
+  if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+  const uint64_t size = size_;
+  // n elements of element bytes from offset fit in the file
+  auto fits = [size](uint64_t offset, uint64_t n, uint64_t element) {
+    return offset % 8 == 0 && offset <= size && n <= (size - offset) / element;
+  };
+
+  if (!fits(h.sequence_offset, h.records, 1) ||
+      !fits(h.index_offset, h.index_entries, sizeof(IndexEntry)) ||
+      h.index_entries != (h.records + kStride - 1) / kStride ||
+      h.sections[0].count + h.sections[1].count != h.records) {
+    return false;
+  }
+  for (int s = 0; s < 2; s++) {
+    const Section &section = h.sections[s];
+    if (section.size != (s == MeasurementRecord::LASER ? 2u : 3u) ||
+        !fits(section.timestamp_offset, section.count, sizeof(int64_t))) {
+      return false;
+    }
+    for (uint32_t i = 0; i < section.size; i++) {
+      if (!fits(section.raw_offset[i], section.count, sizeof(float))) {
+        return false;
+      }
+    }
+    for (int i = 0; section.has_ground_truth && i < 4; i++) {
+      if (!fits(section.ground_truth_offset[i], section.count, sizeof(float))) {
+        return false;
+      }
+    }
+  }
+
+  // a sequence naming other sensors, or more of one than its section
+  // has, is caught in Next()
+  return true;
+}
+
+const int64_t *MeasurementLog::timestamps(MeasurementRecord::SensorType sensor) const {
+  return (const int64_t *)(data_ + header_->sections[sensor].timestamp_offset);
+}
+
+const float *MeasurementLog::raw(MeasurementRecord::SensorType sensor, int i) const {
+  return (const float *)(data_ + header_->sections[sensor].raw_offset[i]);
+}
+
+const float *MeasurementLog::ground_truth(MeasurementRecord::SensorType sensor, int i) const {
+  const Section &section = header_->sections[sensor];
+  return section.has_ground_truth ? (const float *)(data_ + section.ground_truth_offset[i]) : NULL;
+}
+
+bool MeasurementLog::Next(MeasurementRecord &record) {
+
+  if (record_ >= header_->records) {
+    return false;
+  }
+  const uint8_t s = sequence_[record_];
+  if (s > MeasurementRecord::RADAR || cursor_[s] >= header_->sections[s].count) {
+    record_ = header_->records;  // corrupt, stop here
+    return false;
+  }
+  const MeasurementRecord::SensorType sensor = (MeasurementRecord::SensorType)s;
+  const size_t k = cursor_[s]++;
+  record_++;
+
+  record.sensor_type = sensor;
+  record.timestamp = timestamps(sensor)[k];
+  record.size = header_->sections[s].size;
+  for (int i = 0; i < record.size; i++) {
+    record.raw[i] = raw(sensor, i)[k];
+  }
+  record.has_ground_truth = has_ground_truth(sensor);
+  for (int i = 0; i < 4; i++) {
+    record.ground_truth[i] = record.has_ground_truth ? ground_truth(sensor, i)[k] : 0;
+  }
+  return true;
+}
+
+void MeasurementLog::Seek(long long timestamp) {
+
+  // last index entry whose running largest timestamp is still before
+  // timestamp, the first record at or after it is in its stride or later
+  size_t lo = 0;
+  size_t hi = header_->index_entries;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (index_[mid].timestamp < timestamp) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  record_ = 0;
+  cursor_[0] = cursor_[1] = 0;
+  if (lo > 0) {
+    const IndexEntry &entry = index_[lo - 1];
+    record_ = entry.record;
+    cursor_[0] = entry.cursor[0];
+    cursor_[1] = entry.cursor[1];
+  }
+
+  // then record by record, to the first one no earlier than timestamp
+  // and not behind a later one
+  while (record_ < header_->records) {
+    const uint8_t s = sequence_[record_];
+    if (s > MeasurementRecord::RADAR || cursor_[s] >= header_->sections[s].count) {
+      record_ = header_->records;
+      return;
+    }
+    if (timestamps((MeasurementRecord::SensorType)s)[cursor_[s]] >= timestamp) {
+      return;
+    }
+    cursor_[s]++;
+    record_++;
+  }
+}
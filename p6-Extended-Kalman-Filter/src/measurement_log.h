@@ -0,0 +1,138 @@
+#ifndef MEASUREMENT_LOG_H_
+#define MEASUREMENT_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "measurement_reader.h"
+
+/*
+ * Binary measurement log, columns per sensor.
+ *
+ *   header    magic, counts and the offset of everything below
+ *   sequence  uint8 per record in log order, the sensor (0 laser, 1 radar)
+ *   laser     int64 timestamps, then float columns px, py and
+ *             gt_px, gt_py, gt_vx, gt_vy
+ *   radar     int64 timestamps, then float columns rho, phi, rho_dot and
+ *             the ground truth
+ *   index     every kStride records: the running largest timestamp, the
+ *             record and each sensor's column position there
+ *
+ * Columns start 8 byte aligned and are read in place from the memory map.
+ * Values are floats because the text logs are read as floats, so a
+ * converted log replays the exact numbers of the text one. A sensor's
+ * ground truth columns are only written if every one of its lines had
+ * ground truth.
+ *
+ * The byte order is the writer's, both little endian in practice.
+ */
+namespace measurement_log {
+
+static const char kMagic[8] = {'K', 'F', 'L', 'O', 'G', '0', '1', '\n'};
+static const size_t kStride = 1024;
+
+struct Section {
+  uint64_t count;
+  uint32_t size;                // raw values per record
+  uint32_t has_ground_truth;
+  uint64_t timestamp_offset;
+  uint64_t raw_offset[3];
+  uint64_t ground_truth_offset[4];
+};
+
+struct Header {
+  char magic[8];
+  uint64_t records;
+  uint64_t sequence_offset;
+  uint64_t index_offset;
+  uint64_t index_entries;
+  Section sections[2];          // by MeasurementRecord::SensorType
+};
+
+struct IndexEntry {
+  int64_t timestamp;            // largest timestamp up to record
+  uint64_t record;
+  uint64_t cursor[2];
+};
+
+/**
+ * Converts a text log to a binary one, two passes over the text with
+ * bounded buffers
+ * @param skipped Set to the text lines that couldn't be read
+ * @return false if either file can't be opened or written
+ */
+bool Convert(const std::string &text_path, const std::string &log_path, size_t &skipped);
+
+}  // namespace measurement_log
+
+/*
+ * Replays a binary log from its memory map. Next() gives the records in
+ * log order like MeasurementReader, the columns can also be read in
+ * place.
+ */
+class MeasurementLog {
+public:
+
+  /**
+   * Constructor.
+   */
+  MeasurementLog();
+
+  /**
+   * Destructor, unmaps the file.
+   */
+  virtual ~MeasurementLog();
+
+  /**
+   * Maps the log at path
+   * @return false if it can't be opened or isn't a valid log
+   */
+  bool Open(const std::string &path);
+
+  void Close();
+
+  bool is_open() const { return data_ != NULL; }
+
+  /**
+   * The next record in log order
+   * @return false at the end of the log
+   */
+  bool Next(MeasurementRecord &record);
+
+  /**
+   * Moves to the first record at or after timestamp, in a log in time
+   * order
+   */
+  void Seek(long long timestamp);
+
+  // records in the log and the next one Next() gives
+  size_t size() const { return header_->records; }
+  size_t position() const { return record_; }
+
+  // the columns, in place
+  size_t count(MeasurementRecord::SensorType sensor) const { return header_->sections[sensor].count; }
+  bool has_ground_truth(MeasurementRecord::SensorType sensor) const { return header_->sections[sensor].has_ground_truth; }
+  const int64_t *timestamps(MeasurementRecord::SensorType sensor) const;
+  const float *raw(MeasurementRecord::SensorType sensor, int i) const;
+  const float *ground_truth(MeasurementRecord::SensorType sensor, int i) const;
+
+  /**
+   * Whether the file at path starts like a binary log
+   */
+  static bool IsLog(const std::string &path);
+
+private:
+
+  const char *data_;
+  size_t size_;
+  const measurement_log::Header *header_;
+  const uint8_t *sequence_;
+  const measurement_log::IndexEntry *index_;
+
+  size_t record_;
+  size_t cursor_[2];
+
+  bool Valid() const;
+};
+
+#endif /* MEASUREMENT_LOG_H_ */
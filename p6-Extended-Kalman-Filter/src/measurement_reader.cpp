@@ -0,0 +1,196 @@
+#include "measurement_reader.h"
+#include "measurement_log.h"
+#include <charconv>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// pages behind the read position are released in chunks this large
+static const size_t kReleaseChunk = 16 << 20;
+
+static const char *SkipBlanks(const char *p, const char *eol) {
+  while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) {
+    p++;
+  }
+  return p;
+}
+
+// Parses a float at p like istream >> float, p is moved past it
+static bool ParseFloat(const char *&p, const char *eol, double &value) {
+  p = SkipBlanks(p, eol);
+  if (p < eol && *p == '+') {
+    p++;
+  }
+  float f;
+  from_chars_result result = from_chars(p, eol, f);
+  if (result.ec != errc()) {
+    return false;
+  }
+  p = result.ptr;
+  value = f;
+  return true;
+}
+
+static bool ParseInteger(const char *&p, const char *eol, long long &value) {
+  p = SkipBlanks(p, eol);
+  from_chars_result result = from_chars(p, eol, value);
+  if (result.ec != errc()) {
+    return false;
+  }
+  p = result.ptr;
+  return true;
+}
+
+MeasurementReader::MeasurementReader()
+    : log_(NULL), fd_(-1), begin_(NULL), end_(NULL), pos_(NULL), released_(NULL),
+      size_(0), lines_(0), skipped_(0) {}
+
+MeasurementReader::~MeasurementReader() {
+  Close();
+}
+
+bool MeasurementReader::Open(const string &path) {
+
+  Close();
+  lines_ = 0;
+  skipped_ = 0;
+
+  if (MeasurementLog::IsLog(path)) {
+    log_ = new MeasurementLog();
+    if (!log_->Open(path)) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void *map = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    madvise(map, size_, MADV_SEQUENTIAL);
+    begin_ = (const char *)map;
+  }
+
+  fd_ = fd;
+  end_ = begin_ + size_;
+  pos_ = begin_;
+  released_ = begin_;
+  return true;
+}
+
+void MeasurementReader::Close() {
+  delete log_;
+  log_ = NULL;
+  if (begin_) {
+    munmap((void *)begin_, size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  fd_ = -1;
+  begin_ = end_ = pos_ = released_ = NULL;
+  size_ = 0;
+}
+
+bool MeasurementReader::Next(MeasurementRecord &record) {
+
+  if (log_) {
+    if (!log_->Next(record)) {
+      return false;
+    }
+    lines_++;
+    return true;
+  }
+
+  while (pos_ < end_) {
+    const char *eol = (const char *)memchr(pos_, '\n', end_ - pos_);
+    if (!eol) {
+      eol = end_;
+    }
+    const char *line = pos_;
+    pos_ = eol < end_ ? eol + 1 : end_;
+    lines_++;
+
+    if (pos_ - released_ >= (ptrdiff_t)kReleaseChunk) {
+      Release();
+    }
+
+    const char *p = SkipBlanks(line, eol);
+    if (p == eol) {
+      continue;  // blank, the last line usually
+    }
+    if (ParseLine(p, eol, record)) {
+      return true;
+    }
+    skipped_++;
+  }
+  return false;
+}
+
+bool MeasurementReader::ParseLine(const char *p, const char *eol, MeasurementRecord &record) const {
+
+  // the sensor type is a token of its own
+  if (p + 1 >= eol || (p[1] != ' ' && p[1] != '\t')) {
+    return false;
+  }
+  if (*p == 'L') {
+    record.sensor_type = MeasurementRecord::LASER;
+    record.size = 2;
+  } else if (*p == 'R') {
+    record.sensor_type = MeasurementRecord::RADAR;
+    record.size = 3;
+  } else {
+    return false;
+  }
+  p++;
+
+  for (int i = 0; i < record.size; i++) {
+    if (!ParseFloat(p, eol, record.raw[i])) {
+      return false;
+    }
+  }
+  if (!ParseInteger(p, eol, record.timestamp)) {
+    return false;
+  }
+
+  record.has_ground_truth = true;
+  for (int i = 0; i < 4; i++) {
+    if (!ParseFloat(p, eol, record.ground_truth[i])) {
+      record.has_ground_truth = false;
+      break;
+    }
+  }
+  if (!record.has_ground_truth) {
+    memset(record.ground_truth, 0, sizeof(record.ground_truth));
+  }
+  return true;
+}
+
+// Hands the pages already parsed back to the kernel, whole pages only
+void MeasurementReader::Release() {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  size_t from = (released_ - begin_) / page * page;
+  size_t to = (pos_ - begin_) / page * page;
+  if (to > from) {
+    madvise((void *)(begin_ + from), to - from, MADV_DONTNEED);
+    released_ = begin_ + to;
+  }
+}
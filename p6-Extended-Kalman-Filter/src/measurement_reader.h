@@ -0,0 +1,97 @@
+#ifndef MEASUREMENT_READER_H_
+#define MEASUREMENT_READER_H_
+
+#include <stddef.h>
+#include <string>
+
+/*
+ * One line of a measurement log, fixed size.
+ *
+ *   L  px  py          timestamp  gt_px gt_py gt_vx gt_vy ...
+ *   R  rho phi rho_dot timestamp  gt_px gt_py gt_vx gt_vy ...
+ *
+ * The values are parsed as float and widened, like the drivers always
+ * read them, so the filters see the same numbers. Columns past the
+ * ground truth (the UKF logs' yaw and yaw rate) are ignored.
+ */
+class MeasurementLog;
+
+struct MeasurementRecord {
+  enum SensorType {
+    LASER,
+    RADAR
+  } sensor_type;
+
+  long long timestamp;
+  int size;                 // raw values, 2 laser or 3 radar
+  double raw[3];
+  double ground_truth[4];   // zeros if the line has none
+  bool has_ground_truth;
+};
+
+/*
+ * Streams a measurement log from a memory map, one record at a time.
+ *
+ * Nothing is loaded up front and nothing is allocated per line: Next()
+ * parses the line at the read position with from_chars into the caller's
+ * record. The file's pages are read ahead sequentially and handed back
+ * every few MB behind the read position, so a log of any size is replayed
+ * in bounded memory.
+ *
+ * Lines that are neither L nor R, or don't parse, are skipped and counted.
+ * A binary log (measurement_log.h) is recognized by its magic and
+ * replayed through MeasurementLog instead, the drivers take either.
+ *
+ * The drivers share it with p7-Unscented-Kalman-Filter, which builds this
+ * directory's measurement_reader.cpp and measurement_log.cpp.
+ */
+class MeasurementReader {
+public:
+
+  /**
+   * Constructor.
+   */
+  MeasurementReader();
+
+  /**
+   * Destructor, unmaps the file.
+   */
+  virtual ~MeasurementReader();
+
+  /**
+   * Maps the log at path, text or binary
+   * @return false if it can't be opened or mapped
+   */
+  bool Open(const std::string &path);
+
+  void Close();
+
+  bool is_open() const { return fd_ >= 0 || log_; }
+
+  /**
+   * Parses the next measurement line into record
+   * @return false at the end of the log
+   */
+  bool Next(MeasurementRecord &record);
+
+  // lines read and lines skipped so far
+  size_t lines() const { return lines_; }
+  size_t skipped() const { return skipped_; }
+
+private:
+
+  MeasurementLog *log_;     // set for a binary log
+  int fd_;
+  const char *begin_;
+  const char *end_;
+  const char *pos_;
+  const char *released_;    // pages before this were given back
+  size_t size_;
+  size_t lines_;
+  size_t skipped_;
+
+  bool ParseLine(const char *p, const char *eol, MeasurementRecord &record) const;
+  void Release();
+};
+
+#endif /* MEASUREMENT_READER_H_ */
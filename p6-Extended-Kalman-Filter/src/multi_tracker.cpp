@@ -0,0 +1,574 @@
+#include "multi_tracker.h"
+#include <algorithm>
+#include <math.h>
+#include "kalman_update.h"
+
+using namespace std;
+using Eigen::Matrix4d;
+using Eigen::Vector2d;
+using Eigen::Vector3d;
+using Eigen::Vector4d;
+
+// cost of a pair that didn't gate, never chosen over a dummy column
+static const double kForbidden = 1e12;
+
+/*
+ * Constructor.
+ */
+MultiTracker::MultiTracker() {
+
+  H_laser_ << 1, 0, 0, 0,
+              0, 1, 0, 0;
+
+  //measurement covariance matrix - laser
+  R_laser_ << 0.0225, 0,
+              0,      0.0225;
+
+  //measurement covariance matrix - radar
+  R_radar_ << 0.09, 0,      0,
+              0,    0.0009, 0,
+              0,    0,      0.09;
+}
+
+/**
+* Destructor.
+*/
+MultiTracker::~MultiTracker() {}
+
+void MultiTracker::ProcessScan(long long timestamp, const vector<MeasurementPackage> &scan) {
+
+  /*****************************************************************************
+   *  Prediction
+   ****************************************************************************/
+
+  if (is_initialized_) {
+    double dt = (timestamp - previous_timestamp_) / 1000000.0;
+    if (dt > .001) {
+      Predict(dt);
+    }
+  }
+  is_initialized_ = true;
+  previous_timestamp_ = timestamp;
+
+  /*****************************************************************************
+   *  Association
+   ****************************************************************************/
+
+  Gate(scan);
+  Associate(scan);
+
+  /*****************************************************************************
+   *  Update and track lifecycle
+   ****************************************************************************/
+
+  updated_.assign(slots_, false);
+  for (size_t j = 0; j < scan.size(); j++) {
+    if (assigned_[j] >= 0) {
+      Update(assigned_[j], scan[j]);
+      updated_[assigned_[j]] = true;
+    }
+  }
+
+  // before the births, which have no chance to be updated yet
+  for (size_t s = 0; s < slots_; s++) {
+    if (state_[s] == FREE || updated_[s]) {
+      continue;
+    }
+    misses_[s]++;
+    if (state_[s] == TENTATIVE) {
+      if (misses_[s] > max_tentative_misses_) {
+        Delete(s);
+      }
+    } else if (misses_[s] > max_coast_) {
+      Delete(s);
+    } else {
+      state_[s] = COASTING;
+    }
+  }
+
+  // a measurement that gated with some track but lost it to another
+  // measurement is more likely a second return than a new object
+  for (size_t j = 0; j < scan.size(); j++) {
+    if (assigned_[j] < 0 && !gated_[j]) {
+      Birth(scan[j]);
+    }
+  }
+}
+
+void MultiTracker::Tracks(vector<TrackEstimate> &out, bool confirmed_only) const {
+
+  out.clear();
+  for (size_t s = 0; s < slots_; s++) {
+    if (state_[s] == FREE || (confirmed_only && state_[s] == TENTATIVE)) {
+      continue;
+    }
+    TrackEstimate t;
+    t.id = id_[s];
+    t.state = (TrackState)state_[s];
+    t.px = x_[PX][s];
+    t.py = x_[PY][s];
+    t.vx = x_[VX][s];
+    t.vy = x_[VY][s];
+    out.push_back(t);
+  }
+}
+
+
+/*****************************************************************************
+ *  Prediction
+ ****************************************************************************/
+
+/*
+ * F P F^T + Q for every slot, with F = [I dt*I; 0 I] written out on the
+ * unique elements of P. Free slots hold zeros and are predicted too, that
+ * keeps the loop branch free so it vectorizes.
+ */
+void MultiTracker::Predict(double dt) {
+
+  const double dt_2 = dt * dt;
+  const double dt_3 = dt_2 * dt;
+  const double dt_4 = dt_3 * dt;
+
+  const double q_pos_x = dt_4 / 4 * noise_ax;
+  const double q_pos_y = dt_4 / 4 * noise_ay;
+  const double q_cross_x = dt_3 / 2 * noise_ax;
+  const double q_cross_y = dt_3 / 2 * noise_ay;
+  const double q_vel_x = dt_2 * noise_ax;
+  const double q_vel_y = dt_2 * noise_ay;
+
+  double * __restrict px = x_[PX].data();
+  double * __restrict py = x_[PY].data();
+  const double * __restrict vx = x_[VX].data();
+  const double * __restrict vy = x_[VY].data();
+
+  double * __restrict p00 = p_[P00].data();
+  double * __restrict p01 = p_[P01].data();
+  double * __restrict p02 = p_[P02].data();
+  double * __restrict p03 = p_[P03].data();
+  double * __restrict p11 = p_[P11].data();
+  double * __restrict p12 = p_[P12].data();
+  double * __restrict p13 = p_[P13].data();
+  double * __restrict p22 = p_[P22].data();
+  const double * __restrict p23 = p_[P23].data();
+  double * __restrict p33 = p_[P33].data();
+
+  const size_t n = slots_;
+  for (size_t i = 0; i < n; i++) {
+    px[i] += dt * vx[i];
+    py[i] += dt * vy[i];
+
+    // every right hand side reads elements not yet written
+    p00[i] += dt * (2 * p02[i] + dt * p22[i]) + q_pos_x;
+    p01[i] += dt * (p03[i] + p12[i] + dt * p23[i]);
+    p02[i] += dt * p22[i] + q_cross_x;
+    p03[i] += dt * p23[i];
+    p11[i] += dt * (2 * p13[i] + dt * p33[i]) + q_pos_y;
+    p12[i] += dt * p23[i];
+    p13[i] += dt * p33[i] + q_cross_y;
+    p22[i] += q_vel_x;
+    p33[i] += q_vel_y;
+  }
+}
+
+
+/*****************************************************************************
+ *  Gating
+ ****************************************************************************/
+
+void MultiTracker::Gate(const vector<MeasurementPackage> &scan) {
+
+  // tracks by cell
+  grid_.clear();
+  for (size_t s = 0; s < slots_; s++) {
+    if (state_[s] != FREE) {
+      GridEntry e;
+      e.cell = Cell(x_[PX][s], x_[PY][s]);
+      e.slot = s;
+      grid_.push_back(e);
+    }
+  }
+  sort(grid_.begin(), grid_.end());
+
+  edges_.clear();
+  gated_.assign(scan.size(), false);
+  for (size_t j = 0; j < scan.size(); j++) {
+    const MeasurementPackage &m = scan[j];
+    const double gate = m.sensor_type_ == MeasurementPackage::RADAR ? gate_radar_ : gate_laser_;
+
+    double px, py;
+    Position(m, px, py);
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        GridEntry key;
+        key.cell = Cell(px + dx * cell_size_, py + dy * cell_size_);
+        key.slot = 0;
+        vector<GridEntry>::const_iterator it = lower_bound(grid_.begin(), grid_.end(), key);
+        for (; it != grid_.end() && it->cell == key.cell; ++it) {
+          double d = Distance(it->slot, m);
+          if (d < gate) {
+            Edge e;
+            e.meas = j;
+            e.slot = it->slot;
+            e.cost = d;
+            edges_.push_back(e);
+            gated_[j] = true;
+          }
+        }
+      }
+    }
+  }
+}
+
+long long MultiTracker::Cell(double px, double py) const {
+  long long cx = (long long)floor(px / cell_size_);
+  long long cy = (long long)floor(py / cell_size_);
+  return (cx << 32) ^ (cy & 0xffffffffLL);
+}
+
+void MultiTracker::Position(const MeasurementPackage &m, double &px, double &py) const {
+  if (m.sensor_type_ == MeasurementPackage::RADAR) {
+    double rho = m.raw_measurements_[0];
+    double phi = m.raw_measurements_[1];
+    px = rho * cos(phi);
+    py = rho * sin(phi);
+  } else {
+    px = m.raw_measurements_[0];
+    py = m.raw_measurements_[1];
+  }
+}
+
+// squared Mahalanobis distance of the measurement from the track's prediction
+double MultiTracker::Distance(int slot, const MeasurementPackage &m) {
+
+  Vector4d x;
+  Matrix4d P;
+  Load(slot, x, P);
+
+  if (m.sensor_type_ == MeasurementPackage::RADAR) {
+    const Eigen::Matrix<double, 3, 4> Hj = tools.CalculateJacobian(x);
+    Vector3d y = m.raw_measurements_.head<3>() - tools.CartesianToPolar(x);
+    y(1) = atan2(sin(y(1)), cos(y(1)));
+    Eigen::Matrix3d S = R_radar_;
+    S.noalias() += Hj * P * Hj.transpose();
+    SymmetricSolver<3> solver;
+    return solver.Compute(S) ? solver.Mahalanobis(y) : kForbidden;
+  }
+
+  const Vector2d y = m.raw_measurements_.head<2>() - x.head<2>();
+  const Eigen::Matrix2d S = P.topLeftCorner<2, 2>() + R_laser_;
+  SymmetricSolver<2> solver;
+  return solver.Compute(S) ? solver.Mahalanobis(y) : kForbidden;
+}
+
+
+/*****************************************************************************
+ *  Association
+ ****************************************************************************/
+
+/*
+ * Tracks and measurements linked by a gated pair form a cluster, and
+ * clusters are independent: the global nearest neighbour assignment is
+ * the union of each cluster's. With objects mostly apart the clusters
+ * are a few tracks each, and each gets its own small Hungarian.
+ */
+void MultiTracker::Associate(const vector<MeasurementPackage> &scan) {
+
+  const int n_meas = scan.size();
+  assigned_.assign(n_meas, -1);
+  if (edges_.empty()) {
+    return;
+  }
+
+  // union find, measurement j is node j and slot s is node n_meas + s
+  root_.resize(n_meas + slots_);
+  for (size_t i = 0; i < root_.size(); i++) {
+    root_[i] = i;
+  }
+  for (size_t e = 0; e < edges_.size(); e++) {
+    int a = Find(edges_[e].meas);
+    int b = Find(n_meas + edges_[e].slot);
+    if (a != b) {
+      root_[a] = b;
+    }
+  }
+
+  // edges grouped by cluster, every measurement pointing at its root
+  cluster_edges_.resize(edges_.size());
+  for (size_t e = 0; e < edges_.size(); e++) {
+    root_[edges_[e].meas] = Find(edges_[e].meas);
+    cluster_edges_[e] = e;
+  }
+  const vector<int> &root = root_;
+  const vector<Edge> &edges = edges_;
+  sort(cluster_edges_.begin(), cluster_edges_.end(), [&](int a, int b) {
+    return root[edges[a].meas] < root[edges[b].meas];
+  });
+
+  row_of_.assign(n_meas, -1);
+  col_of_.assign(slots_, -1);
+  size_t begin = 0;
+  while (begin < cluster_edges_.size()) {
+    int cluster = root_[edges_[cluster_edges_[begin]].meas];
+    size_t end = begin + 1;
+    while (end < cluster_edges_.size() && root_[edges_[cluster_edges_[end]].meas] == cluster) {
+      end++;
+    }
+    AssociateCluster(scan, begin, end);
+    begin = end;
+  }
+}
+
+int MultiTracker::Find(int node) {
+  while (root_[node] != node) {
+    root_[node] = root_[root_[node]];
+    node = root_[node];
+  }
+  return node;
+}
+
+void MultiTracker::AssociateCluster(const vector<MeasurementPackage> &scan, size_t begin, size_t end) {
+
+  rows_.clear();
+  cols_.clear();
+  for (size_t k = begin; k < end; k++) {
+    const Edge &e = edges_[cluster_edges_[k]];
+    if (row_of_[e.meas] < 0) {
+      row_of_[e.meas] = rows_.size();
+      rows_.push_back(e.meas);
+    }
+    if (col_of_[e.slot] < 0) {
+      col_of_[e.slot] = cols_.size();
+      cols_.push_back(e.slot);
+    }
+  }
+
+  const int n = rows_.size();
+  const int tracks = cols_.size();
+
+  if (n == 1 && tracks == 1) {
+    // the common case, one object alone
+    assigned_[rows_[0]] = cols_[0];
+
+  } else if (n > max_cluster_) {
+    // greedy, cheapest pairs first
+    sort(cluster_edges_.begin() + begin, cluster_edges_.begin() + end, [this](int a, int b) {
+      return edges_[a].cost < edges_[b].cost;
+    });
+    for (size_t k = begin; k < end; k++) {
+      const Edge &e = edges_[cluster_edges_[k]];
+      if (assigned_[e.meas] < 0 && col_of_[e.slot] >= 0) {
+        assigned_[e.meas] = e.slot;
+        col_of_[e.slot] = -1;  // taken
+      }
+    }
+
+  } else {
+    // n measurement rows, the tracks then one "unassigned" column per
+    // measurement that costs its gate
+    const int m = tracks + n;
+    cost_.assign(n * m, kForbidden);
+    for (size_t k = begin; k < end; k++) {
+      const Edge &e = edges_[cluster_edges_[k]];
+      cost_[row_of_[e.meas] * m + col_of_[e.slot]] = e.cost;
+    }
+    for (int r = 0; r < n; r++) {
+      bool radar = scan[rows_[r]].sensor_type_ == MeasurementPackage::RADAR;
+      cost_[r * m + tracks + r] = radar ? gate_radar_ : gate_laser_;
+    }
+
+    Hungarian(n, m);
+    for (int c = 0; c < tracks; c++) {
+      if (match_[c + 1] > 0) {
+        assigned_[rows_[match_[c + 1] - 1]] = cols_[c];
+      }
+    }
+  }
+
+  for (size_t r = 0; r < rows_.size(); r++) {
+    row_of_[rows_[r]] = -1;
+  }
+  for (size_t c = 0; c < cols_.size(); c++) {
+    col_of_[cols_[c]] = -1;
+  }
+}
+
+/*
+ * Minimum cost assignment of n rows to m >= n columns, cost_ row major.
+ * Shortest augmenting paths with row and column potentials, O(n^2 m).
+ * Rows and columns are 1 based here, match_[c] is the row given column c
+ * or 0.
+ */
+void MultiTracker::Hungarian(int n, int m) {
+
+  u_.assign(n + 1, 0);
+  v_.assign(m + 1, 0);
+  match_.assign(m + 1, 0);
+  way_.assign(m + 1, 0);
+
+  for (int i = 1; i <= n; i++) {
+    match_[0] = i;
+    int j0 = 0;
+    minv_.assign(m + 1, HUGE_VAL);
+    used_.assign(m + 1, false);
+    do {
+      used_[j0] = true;
+      int i0 = match_[j0];
+      int j1 = 0;
+      double delta = HUGE_VAL;
+      for (int j = 1; j <= m; j++) {
+        if (used_[j]) {
+          continue;
+        }
+        double cur = cost_[(i0 - 1) * m + (j - 1)] - u_[i0] - v_[j];
+        if (cur < minv_[j]) {
+          minv_[j] = cur;
+          way_[j] = j0;
+        }
+        if (minv_[j] < delta) {
+          delta = minv_[j];
+          j1 = j;
+        }
+      }
+      for (int j = 0; j <= m; j++) {
+        if (used_[j]) {
+          u_[match_[j]] += delta;
+          v_[j] -= delta;
+        } else {
+          minv_[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (match_[j0] != 0);
+
+    // flip the augmenting path
+    do {
+      int j1 = way_[j0];
+      match_[j0] = match_[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+}
+
+
+/*****************************************************************************
+ *  Update and track lifecycle
+ ****************************************************************************/
+
+void MultiTracker::Update(int slot, const MeasurementPackage &m) {
+
+  Vector4d x;
+  Matrix4d P;
+  Load(slot, x, P);
+
+  if (m.sensor_type_ == MeasurementPackage::RADAR) {
+    const Eigen::Matrix<double, 3, 4> Hj = tools.CalculateJacobian(x);
+    Vector3d y = m.raw_measurements_.head<3>() - tools.CartesianToPolar(x);
+    y(1) = atan2(sin(y(1)), cos(y(1)));
+    KalmanGain<4, 3> gain;
+    KalmanUpdate<4, 3>(x, P, y, Hj, R_radar_, gain);
+  } else {
+    const Vector2d y = m.raw_measurements_.head<2>() - H_laser_ * x;
+    KalmanGain<4, 2> gain;
+    KalmanUpdate<4, 2>(x, P, y, H_laser_, R_laser_, gain);
+  }
+
+  Store(slot, x, P);
+  hits_[slot]++;
+  misses_[slot] = 0;
+  if (state_[slot] == COASTING || (state_[slot] == TENTATIVE && hits_[slot] >= confirm_hits_)) {
+    state_[slot] = CONFIRMED;
+  }
+}
+
+// Initialized like FusionEKF's first measurement, but a radar track's
+// position covariance is the measurement's, mapped from polar
+void MultiTracker::Birth(const MeasurementPackage &m) {
+
+  int slot;
+  if (!free_.empty()) {
+    slot = free_.back();
+    free_.pop_back();
+  } else {
+    slot = slots_++;
+    for (int k = 0; k < X_SIZE; k++) {
+      x_[k].push_back(0);
+    }
+    for (int k = 0; k < P_SIZE; k++) {
+      p_[k].push_back(0);
+    }
+    id_.push_back(0);
+    hits_.push_back(0);
+    misses_.push_back(0);
+    state_.push_back(FREE);
+  }
+
+  Vector4d x;
+  Matrix4d P;
+  P <<  .5,    0,    0,      0,
+        0,    .5,    0,      0,
+        0,    0,    1000,   0,
+        0,    0,    0,    1000;
+
+  if (m.sensor_type_ == MeasurementPackage::RADAR) {
+    double rho = m.raw_measurements_[0];
+    double phi = m.raw_measurements_[1];
+    double rhodot = m.raw_measurements_[2];
+    x << rho * cos(phi), rho * sin(phi), rhodot * cos(phi), rhodot * sin(phi);
+
+    // the position's spread across the beam grows with range, rho * sigma_phi
+    Eigen::Matrix2d G;
+    G << cos(phi), -rho * sin(phi),
+         sin(phi),  rho * cos(phi);
+    Eigen::Matrix2d R_position;
+    R_position << R_radar_(0, 0), R_radar_(0, 1),
+                  R_radar_(1, 0), R_radar_(1, 1);
+    P.topLeftCorner<2, 2>() = G * R_position * G.transpose();
+  } else {
+    x << m.raw_measurements_[0], m.raw_measurements_[1], 0, 0;
+  }
+
+  Store(slot, x, P);
+  id_[slot] = next_id_++;
+  hits_[slot] = 1;
+  misses_[slot] = 0;
+  state_[slot] = TENTATIVE;
+  live_++;
+}
+
+void MultiTracker::Delete(int slot) {
+  // zeros, so Predict() keeps computing finite numbers in the free slot
+  for (int k = 0; k < X_SIZE; k++) {
+    x_[k][slot] = 0;
+  }
+  for (int k = 0; k < P_SIZE; k++) {
+    p_[k][slot] = 0;
+  }
+  state_[slot] = FREE;
+  free_.push_back(slot);
+  live_--;
+}
+
+void MultiTracker::Load(int slot, Vector4d &x, Matrix4d &P) const {
+  x << x_[PX][slot], x_[PY][slot], x_[VX][slot], x_[VY][slot];
+  P << p_[P00][slot], p_[P01][slot], p_[P02][slot], p_[P03][slot],
+       p_[P01][slot], p_[P11][slot], p_[P12][slot], p_[P13][slot],
+       p_[P02][slot], p_[P12][slot], p_[P22][slot], p_[P23][slot],
+       p_[P03][slot], p_[P13][slot], p_[P23][slot], p_[P33][slot];
+}
+
+void MultiTracker::Store(int slot, const Vector4d &x, const Matrix4d &P) {
+  x_[PX][slot] = x(0);
+  x_[PY][slot] = x(1);
+  x_[VX][slot] = x(2);
+  x_[VY][slot] = x(3);
+  p_[P00][slot] = P(0, 0);
+  p_[P01][slot] = P(0, 1);
+  p_[P02][slot] = P(0, 2);
+  p_[P03][slot] = P(0, 3);
+  p_[P11][slot] = P(1, 1);
+  p_[P12][slot] = P(1, 2);
+  p_[P13][slot] = P(1, 3);
+  p_[P22][slot] = P(2, 2);
+  p_[P23][slot] = P(2, 3);
+  p_[P33][slot] = P(3, 3);
+}
@@ -0,0 +1,171 @@
+#ifndef MULTI_TRACKER_H_
+#define MULTI_TRACKER_H_
+
+#include <vector>
+#include "Eigen/Dense"
+#include "measurement_package.h"
+#include "tools.h"
+
+/*
+ * Tracks many objects at once with FusionEKF's models: constant velocity
+ * state px, py, vx, vy, laser measures px, py and radar rho, phi, rho_dot.
+ *
+ *   ProcessScan() -> predict every track to the scan's time
+ *                 -> gate, measurement position -> grid cells -> tracks
+ *                    in those cells within the Mahalanobis gate
+ *                 -> associate, global nearest neighbour (Hungarian) per
+ *                    cluster of tracks and measurements that gate together
+ *                 -> update the assigned tracks, KalmanUpdate()
+ *                 -> lifecycle, births from measurements no track gated,
+ *                    confirm, coast and delete
+ *
+ * Tracks are kept as a struct of arrays, one array per state element and
+ * per unique covariance element, indexed by slot. Predict() steps through
+ * the arrays with one dt for every slot, a loop the compiler vectorizes
+ * across tracks. A deleted track's slot goes on a free list for the next
+ * birth, so the arrays only grow to the most tracks alive at once.
+ */
+class MultiTracker {
+public:
+
+  enum TrackState {
+    FREE,       // slot not in use
+    TENTATIVE,  // born, not yet confirm_hits updates
+    CONFIRMED,
+    COASTING    // confirmed, missed the last scan(s)
+  };
+
+  struct TrackEstimate {
+    int id;
+    TrackState state;
+    double px, py, vx, vy;
+  };
+
+  /**
+   * Constructor.
+   */
+  MultiTracker();
+
+  /**
+   * Destructor.
+   */
+  virtual ~MultiTracker();
+
+  /**
+   * Runs one scan, every measurement in it taken at timestamp (us)
+   */
+  void ProcessScan(long long timestamp, const std::vector<MeasurementPackage> &scan);
+
+  /**
+   * The live tracks, tentative ones too unless confirmed_only
+   */
+  void Tracks(std::vector<TrackEstimate> &out, bool confirmed_only = true) const;
+
+  /**
+   * Live tracks, any state
+   */
+  size_t size() const { return live_; }
+
+  // acceleration noise, as in FusionEKF
+  double noise_ax = 9;
+  double noise_ay = 9;
+
+  // measurement covariances, as in FusionEKF
+  Eigen::Matrix2d R_laser_;
+  Eigen::Matrix3d R_radar_;
+
+  // Mahalanobis gates, chi-square 99.9 % for 2 and 3 degrees of freedom
+  double gate_laser_ = 13.82;
+  double gate_radar_ = 16.27;
+
+  // grid cell in m. A measurement is only gated against tracks in its own
+  // and the 8 neighbouring cells, so this bounds the gate's reach.
+  double cell_size_ = 5;
+
+  // updates to confirm a track, scans a tentative track may miss, scans
+  // a confirmed one may coast
+  int confirm_hits_ = 3;
+  int max_tentative_misses_ = 1;
+  int max_coast_ = 5;
+
+  // clusters with more measurements than this are associated greedily,
+  // the Hungarian is cubic in the cluster size
+  int max_cluster_ = 64;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+
+  // state elements and the unique elements of the symmetric covariance
+  enum { PX, PY, VX, VY, X_SIZE };
+  enum { P00, P01, P02, P03, P11, P12, P13, P22, P23, P33, P_SIZE };
+
+  // struct of arrays, slots_ long
+  std::vector<double> x_[X_SIZE];
+  std::vector<double> p_[P_SIZE];
+  std::vector<int> id_;
+  std::vector<int> hits_;
+  std::vector<int> misses_;
+  std::vector<unsigned char> state_;
+  std::vector<int> free_;
+  size_t slots_ = 0;
+  size_t live_ = 0;
+  int next_id_ = 0;
+
+  bool is_initialized_ = false;
+  long long previous_timestamp_ = 0;
+
+  Tools tools;
+  Eigen::Matrix<double, 2, 4> H_laser_;
+
+  // Per scan scratch, members so their capacity is reused
+
+  // tracks sorted by grid cell
+  struct GridEntry {
+    long long cell;
+    int slot;
+    bool operator<(const GridEntry &other) const { return cell < other.cell; }
+  };
+  std::vector<GridEntry> grid_;
+
+  // gated measurement / track pairs
+  struct Edge {
+    int meas;
+    int slot;
+    double cost;   // squared Mahalanobis distance
+  };
+  std::vector<Edge> edges_;
+  std::vector<int> cluster_edges_;   // edges_ indices, grouped by cluster
+  std::vector<int> root_;            // union find, measurements then slots
+  std::vector<int> assigned_;        // per measurement, the slot or -1
+  std::vector<bool> gated_;          // per measurement, some track gated it
+  std::vector<bool> updated_;        // per slot
+
+  // Hungarian on one cluster
+  std::vector<int> rows_;            // cluster measurement per row
+  std::vector<int> cols_;            // cluster track slot per column
+  std::vector<int> row_of_;          // per measurement, -1 outside the cluster
+  std::vector<int> col_of_;          // per slot, -1 outside the cluster
+  std::vector<double> cost_;
+  std::vector<double> u_, v_, minv_;
+  std::vector<int> match_, way_;
+  std::vector<bool> used_;
+
+  void Predict(double dt);
+  void Gate(const std::vector<MeasurementPackage> &scan);
+  void Associate(const std::vector<MeasurementPackage> &scan);
+  void AssociateCluster(const std::vector<MeasurementPackage> &scan, size_t begin, size_t end);
+  void Hungarian(int n, int m);
+  void Update(int slot, const MeasurementPackage &m);
+  void Birth(const MeasurementPackage &m);
+  void Delete(int slot);
+
+  int Find(int node);
+  long long Cell(double px, double py) const;
+  void Position(const MeasurementPackage &m, double &px, double &py) const;
+  double Distance(int slot, const MeasurementPackage &m);
+  void Load(int slot, Eigen::Vector4d &x, Eigen::Matrix4d &P) const;
+  void Store(int slot, const Eigen::Vector4d &x, const Eigen::Matrix4d &P);
+};
+
+#endif /* MULTI_TRACKER_H_ */
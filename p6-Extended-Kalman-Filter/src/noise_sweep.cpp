@@ -0,0 +1,59 @@
+#include <vector>
+#include "Eigen/Dense"
+#include "FusionEKF.h"
+#include "estimation_metrics.h"
+#include "measurement_package.h"
+#include "measurement_reader.h"
+#include "parameter_sweep.h"
+
+using namespace std;
+using Eigen::VectorXd;
+
+/*
+ * Tunes FusionEKF's process noise, noise_ax and noise_ay, on one log.
+ *
+ *   ./noise_sweep path/to/input.txt grid|random|descent [n] [output.txt]
+ *
+ * See parameter_sweep.h. Every configuration replays the log like
+ * ExtendedKF does, so the one with the defaults has its RMSE and NIS.
+ */
+static void RunEKF(const vector<MeasurementRecord> &records, const double *values,
+                   EstimationMetrics &metrics) {
+
+  MeasurementPackage laser_package;
+  laser_package.sensor_type_ = MeasurementPackage::LASER;
+  laser_package.raw_measurements_ = VectorXd(2);
+  MeasurementPackage radar_package;
+  radar_package.sensor_type_ = MeasurementPackage::RADAR;
+  radar_package.raw_measurements_ = VectorXd(3);
+
+  FusionEKF fusionEKF;
+  fusionEKF.noise_ax_ = values[0];
+  fusionEKF.noise_ay_ = values[1];
+  fusionEKF.tools.warnings_ = false;  // the workers would print over the table
+
+  for (size_t k = 0; k < records.size(); k++) {
+    const MeasurementRecord &record = records[k];
+    MeasurementPackage &meas_package =
+        record.sensor_type == MeasurementRecord::LASER ? laser_package : radar_package;
+    meas_package.timestamp_ = record.timestamp;
+    meas_package.raw_measurements_ = Eigen::Map<const VectorXd>(record.raw, record.size);
+
+    fusionEKF.ProcessMeasurement(meas_package);
+
+    if (fusionEKF.ekf_.updated_) {
+      metrics.AddNIS(fusionEKF.ekf_.nis_, record.size);
+    }
+    metrics.Add(fusionEKF.ekf_.x_, Eigen::Map<const Eigen::Vector4d>(record.ground_truth));
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  vector<SweepParameter> parameters;
+  parameters.push_back({"noise_ax", .1, 50, 9});
+  parameters.push_back({"noise_ay", .1, 50, 9});
+
+  ParameterSweep sweep(parameters, RunEKF);
+  return SweepMain(argc, argv, sweep);
+}
@@ -0,0 +1,299 @@
+#include "parameter_sweep.h"
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+#include "result_writer.h"
+
+using namespace std;
+
+static bool Better(const SweepResult &a, const SweepResult &b) {
+  return a.score < b.score;
+}
+
+ParameterSweep::ParameterSweep(const vector<SweepParameter> &parameters, const Filter &filter,
+                               unsigned threads)
+    : parameters_(parameters), filter_(filter), threads_(threads), skipped_(0) {
+
+  if (parameters_.size() > (size_t)SweepResult::kMaxParameters) {
+    parameters_.resize(SweepResult::kMaxParameters);
+  }
+  if (threads_ == 0) {
+    threads_ = max(1u, thread::hardware_concurrency());
+  }
+}
+
+bool ParameterSweep::Load(const string &path) {
+
+  // counted first, so the records are allocated once at their size
+  MeasurementReader reader;
+  if (!reader.Open(path)) {
+    return false;
+  }
+  MeasurementRecord record;
+  size_t count = 0;
+  while (reader.Next(record)) {
+    count++;
+  }
+  if (!reader.Open(path)) {
+    return false;
+  }
+  vector<MeasurementRecord>().swap(records_);
+  records_.reserve(count);
+  while (reader.Next(record)) {
+    records_.push_back(record);
+  }
+  skipped_ = reader.skipped();
+  return true;
+}
+
+/*****************************************************************************
+ *  Searches
+ ****************************************************************************/
+
+vector<SweepResult> ParameterSweep::Grid(int steps) {
+
+  steps = max(steps, 1);
+  size_t total = 1;
+  for (size_t i = 0; i < parameters_.size(); i++) {
+    total *= steps;
+  }
+
+  vector<SweepResult> results(total);
+  for (size_t n = 0; n < total; n++) {
+    // n in base steps, a digit per parameter
+    size_t rest = n;
+    for (size_t i = 0; i < parameters_.size(); i++) {
+      const SweepParameter &p = parameters_[i];
+      int step = rest % steps;
+      rest /= steps;
+      results[n].values[i] = steps == 1 ? p.start : p.low + (p.high - p.low) * step / (steps - 1);
+    }
+  }
+
+  Evaluate(results);
+  sort(results.begin(), results.end(), Better);
+  return results;
+}
+
+vector<SweepResult> ParameterSweep::Random(size_t count, unsigned seed) {
+
+  mt19937 rng(seed);
+  uniform_real_distribution<double> uniform(0, 1);
+
+  vector<SweepResult> results(count);
+  for (size_t n = 0; n < count; n++) {
+    for (size_t i = 0; i < parameters_.size(); i++) {
+      const SweepParameter &p = parameters_[i];
+      results[n].values[i] = p.low + (p.high - p.low) * uniform(rng);
+    }
+  }
+
+  Evaluate(results);
+  sort(results.begin(), results.end(), Better);
+  return results;
+}
+
+// whether results already has candidate's values
+static bool Tried(const vector<SweepResult> &results, const SweepResult &candidate) {
+  for (size_t r = 0; r < results.size(); r++) {
+    if (equal(candidate.values, candidate.values + SweepResult::kMaxParameters,
+              results[r].values)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+vector<SweepResult> ParameterSweep::Descent(int rounds) {
+
+  const size_t n = parameters_.size();
+  vector<SweepResult> results(1);
+  vector<double> step(n);
+  for (size_t i = 0; i < n; i++) {
+    results[0].values[i] = parameters_[i].start;
+    step[i] = (parameters_[i].high - parameters_[i].low) / 4;
+  }
+  Evaluate(results);
+  SweepResult best = results[0];
+
+  // values tried around the best per move, half on each side
+  const int half = max(1u, threads_ / 2);
+
+  for (int round = 0; round < rounds; round++) {
+    bool moving = false;
+    for (size_t i = 0; i < n; i++) {
+      const SweepParameter &p = parameters_[i];
+      if (step[i] < (p.high - p.low) * 1e-3) {
+        continue;
+      }
+      moving = true;
+
+      const size_t first = results.size();
+      for (int m = -half; m <= half; m++) {
+        double value = min(p.high, max(p.low, best.values[i] + step[i] * m / half));
+        SweepResult candidate = best;
+        candidate.values[i] = value;
+        if (!Tried(results, candidate)) {
+          results.push_back(candidate);
+        }
+      }
+      Evaluate(results, first);
+
+      const SweepResult *moved = &best;
+      for (size_t r = first; r < results.size(); r++) {
+        if (Better(results[r], *moved)) {
+          moved = &results[r];
+        }
+      }
+      if (moved == &best) {
+        step[i] /= 2;
+      } else {
+        best = *moved;
+      }
+    }
+    if (!moving) {
+      break;
+    }
+  }
+
+  sort(results.begin(), results.end(), Better);
+  return results;
+}
+
+/*****************************************************************************
+ *  Workers
+ ****************************************************************************/
+
+void ParameterSweep::Evaluate(vector<SweepResult> &results, size_t first) const {
+
+  atomic<size_t> next(first);
+  auto work = [&]() {
+    for (size_t r = next++; r < results.size(); r = next++) {
+      Run(results[r]);
+    }
+  };
+
+  const size_t workers = min((size_t)threads_, results.size() - min(first, results.size()));
+  vector<thread> pool;
+  for (size_t t = 1; t < workers; t++) {
+    pool.push_back(thread(work));
+  }
+  work();
+  for (size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+}
+
+void ParameterSweep::Run(SweepResult &result) const {
+
+  EstimationMetrics metrics(0);
+  filter_(records_, result.values, metrics);
+
+  const Eigen::Vector4d rmse = metrics.RMSE();
+  result.score = 0;
+  for (int i = 0; i < 4; i++) {
+    result.rmse[i] = rmse(i);
+    result.score += rmse(i);
+  }
+  // a filter that diverged is worse than any that didn't
+  if (!isfinite(result.score)) {
+    result.score = HUGE_VAL;
+  }
+  for (int sensor = 0; sensor < 2; sensor++) {
+    result.nis_mean[sensor] = metrics.MeanNIS(sensor + 2);
+    result.nis_above[sensor] = metrics.NISAbove95(sensor + 2);
+  }
+}
+
+/*****************************************************************************
+ *  Command line
+ ****************************************************************************/
+
+int SweepMain(int argc, char* argv[], ParameterSweep &sweep) {
+
+  string usage_instructions = "Usage instructions: ";
+  usage_instructions += argv[0];
+  usage_instructions += " path/to/input.txt grid|random|descent [n] [output.txt]";
+
+  if (argc < 3 || argc > 5) {
+    cerr << usage_instructions << endl;
+    return EXIT_FAILURE;
+  }
+  string mode = argv[2];
+  if (mode != "grid" && mode != "random" && mode != "descent") {
+    cerr << "Unknown search " << mode << ".\n" << usage_instructions << endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!sweep.Load(argv[1])) {
+    cerr << "Cannot open input file: " << argv[1] << endl;
+    return EXIT_FAILURE;
+  }
+  if (sweep.skipped()) {
+    cerr << "Skipped " << sweep.skipped() << " unreadable lines" << endl;
+  }
+
+  ResultWriter out_file;
+  const vector<SweepParameter> &parameters = sweep.parameters();
+  if (argc > 4) {
+    string header;
+    for (size_t i = 0; i < parameters.size(); i++) {
+      header += parameters[i].name + "\t";
+    }
+    header += "rmse_px\trmse_py\trmse_vx\trmse_vy\t"
+              "nis_laser\tnis_laser_above_95\tnis_radar\tnis_radar_above_95\tscore\n";
+    if (!out_file.Open(argv[4], ResultWriter::TEXT, header)) {
+      cerr << "Cannot open output file: " << argv[4] << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  vector<SweepResult> results;
+  if (mode == "grid") {
+    results = sweep.Grid(argc > 3 ? atoi(argv[3]) : 32);
+  } else if (mode == "random") {
+    results = sweep.Random(argc > 3 ? atol(argv[3]) : 1000);
+  } else {
+    results = sweep.Descent(argc > 3 ? atoi(argv[3]) : 20);
+  }
+
+  cout << results.size() << " configurations of " << sweep.size() << " measurements on "
+       << sweep.threads() << " threads, best first:" << endl;
+  for (size_t r = 0; r < results.size(); r++) {
+    const SweepResult &result = results[r];
+    ResultRecord row;
+    for (size_t i = 0; i < parameters.size(); i++) {
+      row.Add(result.values[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+      row.Add(result.rmse[i]);
+    }
+    for (int sensor = 0; sensor < 2; sensor++) {
+      row.Add(result.nis_mean[sensor]).Add(result.nis_above[sensor]);
+    }
+    row.Add(result.score);
+    if (out_file.is_open()) {
+      out_file.Push(row);
+    }
+
+    if (r < 10) {
+      for (size_t i = 0; i < parameters.size(); i++) {
+        cout << parameters[i].name << " " << result.values[i] << "  ";
+      }
+      cout << "RMSE " << result.rmse[0] << " " << result.rmse[1] << " "
+           << result.rmse[2] << " " << result.rmse[3]
+           << "  NIS laser " << result.nis_mean[0] << " (" << result.nis_above[0] << ")"
+           << " radar " << result.nis_mean[1] << " (" << result.nis_above[1] << ")" << endl;
+    }
+  }
+
+  if (out_file.is_open() && !out_file.Close()) {
+    cerr << "Cannot write output file: " << argv[4] << endl;
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
@@ -0,0 +1,126 @@
+#ifndef PARAMETER_SWEEP_H_
+#define PARAMETER_SWEEP_H_
+
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "estimation_metrics.h"
+#include "measurement_reader.h"
+
+/*
+ * A filter parameter to tune, swept between low and high. Descent starts
+ * from start, the filter's default.
+ */
+struct SweepParameter {
+  std::string name;
+  double low;
+  double high;
+  double start;
+};
+
+/*
+ * One configuration and how the filter did with it
+ */
+struct SweepResult {
+
+  static const int kMaxParameters = 4;
+
+  double values[kMaxParameters];
+  double rmse[4];         // px, py, vx, vy
+  double nis_mean[2];     // laser, radar
+  double nis_above[2];    // share above the chi-square 95 % point
+  double score;           // lower is better, the sum of the RMSE
+};
+
+/*
+ * Runs a filter over one measurement log with many noise configurations
+ * at once.
+ *
+ * Load() reads the log once. The records are then shared read only by a
+ * worker per core, each taking the next configuration, building its own
+ * filter and replaying all of the records through it into its own
+ * EstimationMetrics. Nothing is shared between the workers but the
+ * records and the index of the next configuration.
+ *
+ *  - Grid(), steps values of each parameter from low to high, every
+ *    combination
+ *  - Random(), count configurations drawn uniformly between low and high
+ *  - Descent(), coordinate descent from the start values: each parameter
+ *    in turn tries as many values around the best so far as there are
+ *    workers, moves to the best of them, or halves its step if none is
+ *    better. It ends after rounds rounds or once all steps are below a
+ *    thousandth of their range.
+ *
+ * Each returns every configuration it ran, best first.
+ *
+ * The drivers, noise_sweep here and in p7-Unscented-Kalman-Filter, only
+ * declare the parameters and the replay and share SweepMain() for the
+ * command line.
+ */
+class ParameterSweep {
+public:
+
+  /**
+   * Replays records through a filter configured with values, one per
+   * parameter, adding its estimates and NIS to metrics. Called from all
+   * workers at once.
+   */
+  typedef std::function<void(const std::vector<MeasurementRecord> &records,
+                             const double *values,
+                             EstimationMetrics &metrics)> Filter;
+
+  /**
+   * Constructor.
+   * @param parameters At most SweepResult::kMaxParameters
+   * @param threads Workers, 0 for one per core
+   */
+  ParameterSweep(const std::vector<SweepParameter> &parameters, const Filter &filter,
+                 unsigned threads = 0);
+
+  /**
+   * Reads the log at path, text or binary, into memory
+   * @return false if it can't be opened
+   */
+  bool Load(const std::string &path);
+
+  size_t size() const { return records_.size(); }
+  size_t skipped() const { return skipped_; }
+  unsigned threads() const { return threads_; }
+  const std::vector<SweepParameter> &parameters() const { return parameters_; }
+
+  std::vector<SweepResult> Grid(int steps);
+  std::vector<SweepResult> Random(size_t count, unsigned seed = 42);
+  std::vector<SweepResult> Descent(int rounds);
+
+  /**
+   * Runs the configurations in results[first] onwards, their values set,
+   * on all workers and fills in the rest
+   */
+  void Evaluate(std::vector<SweepResult> &results, size_t first = 0) const;
+
+private:
+
+  std::vector<SweepParameter> parameters_;
+  Filter filter_;
+  unsigned threads_;
+
+  // the log, read only once loaded
+  std::vector<MeasurementRecord> records_;
+  size_t skipped_;
+
+  void Run(SweepResult &result) const;
+};
+
+/**
+ * The drivers' command line:
+ *
+ *   ./noise_sweep path/to/input.txt grid|random|descent [n] [output.txt]
+ *
+ * n is the steps per parameter of a grid (default 32), the configurations
+ * drawn at random (1000) or the rounds of descent (20). The best
+ * configurations are printed, all of them written to output.txt if given.
+ */
+int SweepMain(int argc, char* argv[], ParameterSweep &sweep);
+
+#endif /* PARAMETER_SWEEP_H_ */
@@ -0,0 +1,156 @@
+#include "result_writer.h"
+#include <charconv>
+#include <chrono>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// longest a text row can get, 16 fields of at most 24 characters
+static const size_t kLongestRow = ResultRecord::kMaxFields * 25;
+
+ResultWriter::ResultWriter()
+    : fd_(-1), format_(TEXT), head_(0), tail_(0), closing_(false),
+      failed_(false), used_(0) {}
+
+ResultWriter::~ResultWriter() {
+  Close();
+}
+
+bool ResultWriter::Open(const string &path, Format format, const string &header) {
+
+  Close();
+
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    return false;
+  }
+  format_ = format;
+  ring_.resize(kRing);
+  buffer_.resize(kBuffer);
+  head_ = 0;
+  tail_ = 0;
+  closing_ = false;
+  failed_ = false;
+  used_ = 0;
+
+  if (format_ == TEXT) {
+    size_t n = min(header.size(), (size_t)kBuffer);
+    memcpy(buffer_.data(), header.data(), n);
+    used_ = n;
+  }
+
+  thread_ = thread(&ResultWriter::Run, this);
+  return true;
+}
+
+bool ResultWriter::Close() {
+
+  if (fd_ < 0) {
+    return true;
+  }
+  closing_.store(true, memory_order_release);
+  thread_.join();
+  if (close(fd_) != 0) {
+    failed_ = true;
+  }
+  fd_ = -1;
+  return !failed_;
+}
+
+void ResultWriter::Push(const ResultRecord &record) {
+
+  const size_t head = head_.load(memory_order_relaxed);
+  // full, the writer is a whole ring behind
+  while (head - tail_.load(memory_order_acquire) >= kRing) {
+    this_thread::yield();
+  }
+  ring_[head & (kRing - 1)] = record;
+  head_.store(head + 1, memory_order_release);
+}
+
+/*****************************************************************************
+ *  Writer thread
+ ****************************************************************************/
+
+void ResultWriter::Run() {
+
+  size_t tail = tail_.load(memory_order_relaxed);
+  for (;;) {
+    const size_t head = head_.load(memory_order_acquire);
+    if (tail == head) {
+      // closing_ is set after the last Push(), so with it seen an empty
+      // ring stays empty
+      if (closing_.load(memory_order_acquire) && head_.load(memory_order_acquire) == tail) {
+        break;
+      }
+      this_thread::sleep_for(chrono::microseconds(100));
+      continue;
+    }
+
+    for (; tail != head; tail++) {
+      Append(ring_[tail & (kRing - 1)]);
+    }
+    tail_.store(tail, memory_order_release);
+  }
+  Flush();
+}
+
+void ResultWriter::Append(const ResultRecord &record) {
+
+  if (used_ + kLongestRow > kBuffer) {
+    Flush();
+  }
+  char *p = buffer_.data() + used_;
+  char *end = buffer_.data() + kBuffer;
+
+  for (int i = 0; i < record.size; i++) {
+    const ResultRecord::Field &field = record.fields[i];
+
+    if (format_ == BINARY) {
+      if (record.types[i] == ResultRecord::LABEL) {
+        memset(p, 0, 8);
+        strncpy(p, field.label, 8);
+      } else {
+        memcpy(p, &field, 8);
+      }
+      p += 8;
+      continue;
+    }
+
+    switch (record.types[i]) {
+    case ResultRecord::REAL:
+      // what ostream << double gives with the default precision
+      p = to_chars(p, end, field.real, chars_format::general, 6).ptr;
+      break;
+    case ResultRecord::INTEGER:
+      p = to_chars(p, end, field.integer).ptr;
+      break;
+    case ResultRecord::LABEL: {
+      size_t n = min(strlen(field.label), (size_t)24);
+      memcpy(p, field.label, n);
+      p += n;
+      break;
+    }
+    }
+    *p++ = i + 1 < record.size ? '\t' : '\n';
+  }
+  used_ = p - buffer_.data();
+}
+
+void ResultWriter::Flush() {
+
+  const char *p = buffer_.data();
+  size_t left = used_;
+  while (!failed_ && left) {
+    ssize_t n = write(fd_, p, left);
+    if (n <= 0) {
+      failed_ = true;
+      break;
+    }
+    p += n;
+    left -= n;
+  }
+  used_ = 0;
+}
@@ -0,0 +1,133 @@
+#ifndef RESULT_WRITER_H_
+#define RESULT_WRITER_H_
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * One output row, fixed size: numbers, integers and short labels.
+ *
+ *   ResultRecord row;
+ *   row.Add(timestamp).Add(x(0)).Add(x(1)).AddLabel("lidar");
+ */
+struct ResultRecord {
+
+  enum FieldType {
+    REAL,
+    INTEGER,
+    LABEL
+  };
+
+  static const int kMaxFields = 16;
+
+  union Field {
+    double real;
+    long long integer;
+    const char *label;   // a string literal, it's printed after Add() returns
+  };
+
+  Field fields[kMaxFields];
+  unsigned char types[kMaxFields];
+  int size = 0;
+
+  ResultRecord &Add(double value) {
+    types[size] = REAL;
+    fields[size++].real = value;
+    return *this;
+  }
+
+  ResultRecord &Add(long long value) {
+    types[size] = INTEGER;
+    fields[size++].integer = value;
+    return *this;
+  }
+
+  ResultRecord &AddLabel(const char *value) {
+    types[size] = LABEL;
+    fields[size++].label = value;
+    return *this;
+  }
+};
+
+/*
+ * Writes rows off the filtering thread.
+ *
+ * Push() copies the row into a single producer, single consumer ring and
+ * returns, it only waits if the writer thread is a whole ring behind.
+ * The writer thread drains the ring in batches into a 1 MB buffer and
+ * writes that out when full:
+ *  - TEXT, fields tab separated, a row per line. Numbers are formatted
+ *    with to_chars like ostream's defaults (6 significant digits, %g), so
+ *    the file is the same as one written with <<.
+ *  - BINARY, every field 8 bytes in the machine's byte order: a double,
+ *    an int64, or a label's first 8 characters zero padded.
+ *
+ * Only one thread may Push().
+ */
+class ResultWriter {
+public:
+
+  enum Format {
+    TEXT,
+    BINARY
+  };
+
+  /**
+   * Constructor.
+   */
+  ResultWriter();
+
+  /**
+   * Destructor, writes what is queued and closes.
+   */
+  virtual ~ResultWriter();
+
+  /**
+   * Opens path and starts the writer thread
+   * @param header Written first as is, text only
+   * @return false if path can't be opened
+   */
+  bool Open(const std::string &path, Format format, const std::string &header = "");
+
+  /**
+   * Waits for the queued rows to be written and closes
+   * @return false if a write failed
+   */
+  bool Close();
+
+  bool is_open() const { return fd_ >= 0; }
+
+  /**
+   * Queues a row
+   */
+  void Push(const ResultRecord &record);
+
+private:
+
+  // a power of 2
+  static const size_t kRing = 4096;
+  static const size_t kBuffer = 1 << 20;
+
+  int fd_;
+  Format format_;
+  std::thread thread_;
+  std::vector<ResultRecord> ring_;
+
+  // head_ is the producer's next slot, tail_ the writer's, both only grow
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
+  alignas(64) std::atomic<bool> closing_;
+  bool failed_;
+
+  // the writer thread's
+  std::vector<char> buffer_;
+  size_t used_;
+
+  void Run();
+  void Append(const ResultRecord &record);
+  void Flush();
+};
+
+#endif /* RESULT_WRITER_H_ */
@@ -6,14 +6,15 @@ using Eigen::VectorXd;
 using Eigen::MatrixXd;
 using std::vector;
 
-Tools::Tools() {}
+Tools::Tools() : warnings_(true) {}
 
 Tools::~Tools() {}
 
 VectorXd Tools::CalculateRMSE(const vector<VectorXd> &estimations,
                               const vector<VectorXd> &ground_truth) {
 	/**
-	* 
+	* The same sums as EstimationMetrics, which gives this without keeping
+	* the estimates.
 	*/
 
 	VectorXd rmse(4);
@@ -30,37 +31,25 @@ VectorXd Tools::CalculateRMSE(const vector<VectorXd> &estimations,
 		return rmse;
 	}
 
-	auto estimations_size = estimations.size();
-
 	// accumlate squared residuals
-	for(unsigned int i = 0;  i < estimations_size;  ++i){
-
-		VectorXd residual = estimations[i] - ground_truth[i];
-
-		// coefficient-wise multiplication
-		auto residual_array = residual.array();
-		residual = residual_array * residual_array;
-		rmse += residual;
+	EstimationMetrics metrics(0);
+	for(unsigned int i = 0;  i < estimations.size();  ++i){
+		metrics.Add(estimations[i], ground_truth[i]);
 	}
 
-	// calculate mean
-	rmse = rmse / estimations_size;
-
-	// squared root
-	rmse = rmse.array().sqrt();
-
-	// returns result
+	// mean and squared root
+	rmse = metrics.RMSE();
 	return rmse;
 
 }
 
 
-MatrixXd Tools::CalculateJacobian(const VectorXd& x_state) {
+Eigen::Matrix<double, 3, 4> Tools::CalculateJacobian(const Eigen::Vector4d& x_state) {
 	/**
 	* 
 	*/
 
-	MatrixXd Hj(3, 4);
+	Eigen::Matrix<double, 3, 4> Hj;
 
 	// state parameters
 
@@ -75,7 +64,9 @@ MatrixXd Tools::CalculateJacobian(const VectorXd& x_state) {
 
 	// division by zero check
 	if(fabs(c1) < 0.0001) {
-		cout << "CalculateJacobian () - Warning - division by Zero" << endl;
+		if (warnings_) {
+			cout << "CalculateJacobian () - Warning - division by Zero" << endl;
+		}
 		c1 = .00001;
 	}
 
@@ -91,3 +82,23 @@ MatrixXd Tools::CalculateJacobian(const VectorXd& x_state) {
 		  return Hj;
 
 }
+
+
+Eigen::Vector3d Tools::CartesianToPolar(const Eigen::Vector4d& x_state) {
+
+	double px = x_state(0);
+	double py = x_state(1);
+
+	double vx = x_state(2);
+	double vy = x_state(3);
+
+	double rho = sqrt(px * px + py * py);
+	double phi = atan2(py, px);
+
+	// division by zero check
+	double d = rho;
+	if (d < 1e-6) d = 1e-6;
+
+	return Eigen::Vector3d(rho, phi, (px * vx + py * vy) / d);
+
+}
@@ -2,6 +2,7 @@
 #define TOOLS_H_
 #include <vector>
 #include "Eigen/Dense"
+#include "estimation_metrics.h"
 
 class Tools {
 public:
@@ -16,14 +17,24 @@ public:
   virtual ~Tools();
 
   /**
-  * A helper method to calculate RMSE.
+  * A helper method to calculate RMSE. EstimationMetrics gives it as the
+  * estimates come, without keeping them.
   */
   Eigen::VectorXd CalculateRMSE(const std::vector<Eigen::VectorXd> &estimations, const std::vector<Eigen::VectorXd> &ground_truth);
 
   /**
   * A helper method to calculate Jacobians.
   */
-  Eigen::MatrixXd CalculateJacobian(const Eigen::VectorXd& x_state);
+  Eigen::Matrix<double, 3, 4> CalculateJacobian(const Eigen::Vector4d& x_state);
+
+  /**
+  * Radar measurement function h(x): px, py, vx, vy to rho, phi, rho_dot.
+  */
+  Eigen::Vector3d CartesianToPolar(const Eigen::Vector4d& x_state);
+
+  // CalculateJacobian() prints a warning when px and py are both near zero,
+  // on by default, off for callers that run many filters at once
+  bool warnings_;
 
 };
 
@@ -0,0 +1,211 @@
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "measurement_package.h"
+#include "multi_tracker.h"
+
+using namespace std;
+
+/*
+ * Runs MultiTracker on a simulated scene and times it.
+ *
+ * Objects move at constant velocity in a square area, bouncing off its
+ * edges. Every scan is one sensor, laser and radar alternating, and sees
+ * each object with probability pd plus uniform clutter. The area is
+ * centred on the sensors, at the origin like in the project's data.
+ *
+ *   ./tracker_bench [objects] [scans] [pd] [clutter per scan]
+ *
+ * Every 10th scan the confirmed tracks are matched one to one to objects
+ * within 2 m, closest pairs first. Reported are the position RMSE of the
+ * matched tracks and, per evaluation, the confirmed tracks left over with
+ * an object near them (duplicate) or none (false) and the objects without
+ * a track (missed).
+ */
+
+struct Object {
+  double px, py, vx, vy;
+};
+
+// a track and an object within 2 m of it
+struct Candidate {
+  double sq_distance;
+  int track, object;
+  bool operator<(const Candidate &other) const { return sq_distance < other.sq_distance; }
+};
+
+int main(int argc, char* argv[]) {
+
+  int n_objects = argc > 1 ? atoi(argv[1]) : 1000;
+  int n_scans = argc > 2 ? atoi(argv[2]) : 400;
+  double pd = argc > 3 ? atof(argv[3]) : .95;
+  double clutter = argc > 4 ? atof(argv[4]) : 20;
+
+  // area from -half to half, about 25 m^2 per object
+  const double half = 2.5 * sqrt((double)n_objects);
+  const long long dt_us = 50000;  // 20 Hz
+  const double dt = dt_us / 1000000.0;
+
+  mt19937 rng(42);
+  uniform_real_distribution<double> uniform(0, 1);
+  normal_distribution<double> normal(0, 1);
+  poisson_distribution<int> n_clutter(clutter);
+
+  vector<Object> objects(n_objects);
+  for (int i = 0; i < n_objects; i++) {
+    double speed = 1 + 9 * uniform(rng);
+    double heading = 2 * M_PI * uniform(rng);
+    objects[i].px = half * (2 * uniform(rng) - 1);
+    objects[i].py = half * (2 * uniform(rng) - 1);
+    objects[i].vx = speed * cos(heading);
+    objects[i].vy = speed * sin(heading);
+  }
+
+  MultiTracker tracker;
+  vector<MeasurementPackage> scan;
+  vector<MultiTracker::TrackEstimate> tracks;
+  vector<Candidate> candidates;
+  vector<bool> track_taken, object_taken, track_near;
+
+  double total_s = 0;
+  double worst_s = 0;
+  size_t measurements = 0;
+  double sq_error = 0;
+  size_t matched = 0;
+  size_t false_tracks = 0;
+  size_t duplicates = 0;
+  size_t missed = 0;
+  size_t confirmed = 0;
+  size_t evaluations = 0;
+
+  for (int k = 0; k < n_scans; k++) {
+    long long timestamp = k * dt_us;
+    bool radar = k % 2;
+
+    // move
+    for (int i = 0; i < n_objects; i++) {
+      Object &o = objects[i];
+      o.px += dt * o.vx;
+      o.py += dt * o.vy;
+      if (fabs(o.px) > half) {
+        o.vx = -o.vx;
+      }
+      if (fabs(o.py) > half) {
+        o.vy = -o.vy;
+      }
+    }
+
+    // sense
+    scan.clear();
+    MeasurementPackage meas;
+    meas.timestamp_ = timestamp;
+    if (radar) {
+      meas.sensor_type_ = MeasurementPackage::RADAR;
+      meas.raw_measurements_ = Eigen::VectorXd(3);
+    } else {
+      meas.sensor_type_ = MeasurementPackage::LASER;
+      meas.raw_measurements_ = Eigen::VectorXd(2);
+    }
+    for (int i = 0; i < n_objects; i++) {
+      if (uniform(rng) >= pd) {
+        continue;
+      }
+      const Object &o = objects[i];
+      if (radar) {
+        double rho = sqrt(o.px * o.px + o.py * o.py);
+        meas.raw_measurements_ << rho + .3 * normal(rng),
+                                  atan2(o.py, o.px) + .03 * normal(rng),
+                                  (o.px * o.vx + o.py * o.vy) / rho + .3 * normal(rng);
+      } else {
+        meas.raw_measurements_ << o.px + .15 * normal(rng), o.py + .15 * normal(rng);
+      }
+      scan.push_back(meas);
+    }
+    int n_false = n_clutter(rng);
+    for (int i = 0; i < n_false; i++) {
+      double px = half * (2 * uniform(rng) - 1);
+      double py = half * (2 * uniform(rng) - 1);
+      if (radar) {
+        meas.raw_measurements_ << sqrt(px * px + py * py), atan2(py, px), 10 * (uniform(rng) - .5);
+      } else {
+        meas.raw_measurements_ << px, py;
+      }
+      scan.push_back(meas);
+    }
+
+    // track
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    tracker.ProcessScan(timestamp, scan);
+    double s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    total_s += s;
+    worst_s = max(worst_s, s);
+    measurements += scan.size();
+
+    // evaluate, brute force and not timed
+    if (k % 10 == 9) {
+      tracker.Tracks(tracks);
+      evaluations++;
+      confirmed += tracks.size();
+
+      candidates.clear();
+      for (size_t t = 0; t < tracks.size(); t++) {
+        for (int i = 0; i < n_objects; i++) {
+          double dx = tracks[t].px - objects[i].px;
+          double dy = tracks[t].py - objects[i].py;
+          if (dx * dx + dy * dy < 4) {
+            candidates.push_back({dx * dx + dy * dy, (int)t, i});
+          }
+        }
+      }
+      sort(candidates.begin(), candidates.end());
+
+      track_taken.assign(tracks.size(), false);
+      track_near.assign(tracks.size(), false);
+      object_taken.assign(n_objects, false);
+      size_t matched_now = 0;
+      for (size_t c = 0; c < candidates.size(); c++) {
+        const Candidate &candidate = candidates[c];
+        track_near[candidate.track] = true;
+        if (track_taken[candidate.track] || object_taken[candidate.object]) {
+          continue;
+        }
+        track_taken[candidate.track] = true;
+        object_taken[candidate.object] = true;
+        sq_error += candidate.sq_distance;
+        matched_now++;
+      }
+      for (size_t t = 0; t < tracks.size(); t++) {
+        if (!track_taken[t]) {
+          if (track_near[t]) {
+            duplicates++;
+          } else {
+            false_tracks++;
+          }
+        }
+      }
+      matched += matched_now;
+      missed += n_objects - matched_now;
+    }
+  }
+
+  cout << "objects " << n_objects << ", scans " << n_scans
+       << ", pd " << pd << ", clutter " << clutter << endl;
+  cout << "per scan:        " << total_s / n_scans * 1000 << " ms, worst "
+       << worst_s * 1000 << " ms" << endl;
+  cout << "per measurement: " << total_s / measurements * 1e9 << " ns" << endl;
+  if (evaluations) {
+    cout << "confirmed tracks " << (double)confirmed / evaluations
+         << " on average, duplicate " << (double)duplicates / evaluations
+         << ", false " << (double)false_tracks / evaluations
+         << ", objects missed " << (double)missed / evaluations << endl;
+  }
+  if (matched) {
+    cout << "position RMSE    " << sqrt(sq_error / matched) << " m" << endl;
+  }
+  return 0;
+}
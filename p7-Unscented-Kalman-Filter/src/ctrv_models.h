@@ -0,0 +1,137 @@
+#ifndef CTRV_MODELS_H_
+#define CTRV_MODELS_H_
+
+#include <math.h>
+#include "Eigen/Dense"
+
+/*
+ * The models of UKF, for UnscentedFilter (unscented_filter.h): constant
+ * turn rate and velocity, a radar and a lidar.
+ *
+ * The state is [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad.
+ * The functors run row by row across the sigma point lanes: the sines and
+ * cosines first, then the arithmetic, with no branches so those loops
+ * vectorize.
+ */
+
+/*
+ * CTRV, with longitudinal and yaw acceleration noise
+ */
+struct CTRVModel {
+
+  static const int kNx = 5;
+  static const int kNnoise = 2;
+  static const int kAngle = 3;
+
+  ///* Process noise standard deviations, longitudinal acceleration in m/s^2
+  ///* and yaw acceleration in rad/s^2
+  double std_a = 2;
+  double std_yawdd = .7;
+
+  Eigen::Vector2d NoiseDeviations() const {
+    return Eigen::Vector2d(std_a, std_yawdd);
+  }
+
+  template <int Lanes>
+  void operator()(const Eigen::Matrix<double, kNx + kNnoise, Lanes, Eigen::RowMajor> &Xsig_aug,
+                  double delta_t,
+                  Eigen::Matrix<double, kNx, Lanes, Eigen::RowMajor> &Xsig_pred) const {
+
+    const double *point_x          = &Xsig_aug(0, 0);
+    const double *point_y          = &Xsig_aug(1, 0);
+    const double *velocity         = &Xsig_aug(2, 0);
+    const double *yaw              = &Xsig_aug(3, 0);
+    const double *yaw_diff         = &Xsig_aug(4, 0);
+    const double *nu_a             = &Xsig_aug(5, 0);
+    const double *nu_yaw_diff_diff = &Xsig_aug(6, 0);
+
+    double sin_yaw[Lanes], cos_yaw[Lanes], sin_turned[Lanes], cos_turned[Lanes];
+    for (int i = 0;  i < Lanes;  i++) {
+      const double turned = yaw[i] + yaw_diff[i] * delta_t;
+      sin_yaw[i]    = sin(yaw[i]);
+      cos_yaw[i]    = cos(yaw[i]);
+      sin_turned[i] = sin(turned);
+      cos_turned[i] = cos(turned);
+    }
+
+    double * __restrict point_x_predicted  = &Xsig_pred(0, 0);
+    double * __restrict point_y_predicted  = &Xsig_pred(1, 0);
+    double * __restrict velocity_predicted = &Xsig_pred(2, 0);
+    double * __restrict yaw_predicted      = &Xsig_pred(3, 0);
+    double * __restrict yaw_diff_predicted = &Xsig_pred(4, 0);
+
+    const double delta_t_squared = delta_t * delta_t;
+
+    for (int i = 0;  i < Lanes;  i++) {
+      // turning, or straight to avoid division by zero
+      const bool turning = fabs(yaw_diff[i]) > 0.001;
+      const double v_over_yaw_diff = velocity[i] / (turning ? yaw_diff[i] : 1.);
+
+      const double turning_x  = point_x[i] + v_over_yaw_diff * (sin_turned[i] - sin_yaw[i]);
+      const double turning_y  = point_y[i] + v_over_yaw_diff * (cos_yaw[i] - cos_turned[i]);
+      const double straight_x = point_x[i] + velocity[i] * delta_t * cos_yaw[i];
+      const double straight_y = point_y[i] + velocity[i] * delta_t * sin_yaw[i];
+
+      // add noise
+      const double half_nu_a = .5 * nu_a[i];
+      point_x_predicted[i]  = (turning ? turning_x : straight_x) + half_nu_a * delta_t_squared * cos_yaw[i];
+      point_y_predicted[i]  = (turning ? turning_y : straight_y) + half_nu_a * delta_t_squared * sin_yaw[i];
+      velocity_predicted[i] = velocity[i] + nu_a[i] * delta_t;
+      yaw_predicted[i]      = (yaw[i] + yaw_diff[i] * delta_t) + .5 * nu_yaw_diff_diff[i] * delta_t_squared;
+      yaw_diff_predicted[i] = yaw_diff[i] + nu_yaw_diff_diff[i] * delta_t;
+    }
+  }
+};
+
+/*
+ * Radar: rho, phi and rho_dot, nonlinear
+ */
+struct RadarModel {
+
+  static const int kNz = 3;
+  static const int kAngle = 1;
+  static const bool kLinear = false;
+
+  Eigen::Matrix3d R;
+
+  template <int Lanes>
+  void operator()(const Eigen::Matrix<double, CTRVModel::kNx, Lanes, Eigen::RowMajor> &Xsig,
+                  Eigen::Matrix<double, kNz, Lanes, Eigen::RowMajor> &Zsig) const {
+
+    const double *x_point  = &Xsig(0, 0);
+    const double *y_point  = &Xsig(1, 0);
+    const double *velocity = &Xsig(2, 0);
+    const double *psi      = &Xsig(3, 0);
+    double * __restrict rho    = &Zsig(0, 0);
+    double * __restrict theta  = &Zsig(1, 0);
+    double * __restrict rhodot = &Zsig(2, 0);
+
+    double cos_psi[Lanes], sin_psi[Lanes];
+    for (int i = 0;  i < Lanes;  i++) {
+      theta[i]   = atan2(y_point[i], x_point[i]);
+      cos_psi[i] = cos(psi[i]);
+      sin_psi[i] = sin(psi[i]);
+    }
+    for (int i = 0;  i < Lanes;  i++) {
+      double r = sqrt(x_point[i] * x_point[i] + y_point[i] * y_point[i]);
+      r = r < 1e-6 ? 1e-6 : r;  // Divide by 0 safe for rhodot
+      rho[i] = r;
+      rhodot[i] = (x_point[i] * cos_psi[i] * velocity[i] + y_point[i] * sin_psi[i] * velocity[i]) / r;
+    }
+  }
+};
+
+/*
+ * Lidar: px and py, linear
+ */
+struct LidarModel {
+
+  static const int kNz = 2;
+  static const int kAngle = -1;
+  static const bool kLinear = true;
+
+  Eigen::Matrix2d R;
+  Eigen::Matrix<double, kNz, CTRVModel::kNx> H;
+};
+
+#endif /* CTRV_MODELS_H_ */
@@ -1,13 +1,13 @@
 
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <vector>
 #include <stdlib.h>
 #include "Eigen/Dense"
 #include "ukf.h"
-#include "ground_truth_package.h"
+#include "estimation_metrics.h"
 #include "measurement_package.h"
+#include "measurement_reader.h"
+#include "result_writer.h"
 
 using namespace std;
 using Eigen::MatrixXd;
@@ -37,8 +37,8 @@ void check_arguments(int argc, char* argv[]) {
   }
 }
 
-void check_files(ifstream& in_file, string& in_name,
-                 ofstream& out_file, string& out_name) {
+void check_files(MeasurementReader& in_file, string& in_name,
+                 ResultWriter& out_file, string& out_name) {
   if (!in_file.is_open()) {
     cerr << "Cannot open input file: " << in_name << endl;
     exit(EXIT_FAILURE);
@@ -55,10 +55,33 @@ int main(int argc, char* argv[]) {
   check_arguments(argc, argv);
 
   string in_file_name_ = argv[1];
-  ifstream in_file_(in_file_name_.c_str(), ifstream::in);
+  MeasurementReader in_file_;
+  in_file_.Open(in_file_name_);
 
+  // rows are written by a thread of their own, as binary records if the
+  // output is a .bin
   string out_file_name_ = argv[2];
-  ofstream out_file_(out_file_name_.c_str(), ofstream::out);
+  bool binary = out_file_name_.size() > 4 &&
+                out_file_name_.compare(out_file_name_.size() - 4, 4, ".bin") == 0;
+
+  // column names for output file
+  string header = "time_stamp\t"
+                  "px_state\t"
+                  "py_state\t"
+                  "v_state\t"
+                  "yaw_angle_state\t"
+                  "yaw_rate_state\t"
+                  "sensor_type\t"
+                  "NIS\t"
+                  "px_measured\t"
+                  "py_measured\t"
+                  "px_ground_truth\t"
+                  "py_ground_truth\t"
+                  "vx_ground_truth\t"
+                  "vy_ground_truth\n";
+
+  ResultWriter out_file_;
+  out_file_.Open(out_file_name_, binary ? ResultWriter::BINARY : ResultWriter::TEXT, header);
 
   check_files(in_file_, in_file_name_, out_file_, out_file_name_);
 
@@ -66,146 +89,84 @@ int main(int argc, char* argv[]) {
    *  Set Measurements                          *
    **********************************************/
 
-  vector<MeasurementPackage> measurement_pack_list;
-  vector<GroundTruthPackage> gt_pack_list;
-
-  string line;
-
-  // prep the measurement packages (each line represents a measurement at a
-  // timestamp)
-  while (getline(in_file_, line)) {
-    string sensor_type;
-    MeasurementPackage meas_package;
-    GroundTruthPackage gt_package;
-    istringstream iss(line);
-    long long timestamp;
-
-    // reads first element from the current line
-    iss >> sensor_type;
-
-    if (sensor_type.compare("L") == 0) {
-      // laser measurement
-
-      // read measurements at this timestamp
-      meas_package.sensor_type_ = MeasurementPackage::LASER;
-      meas_package.raw_measurements_ = VectorXd(2);
-      float px;
-      float py;
-      iss >> px;
-      iss >> py;
-      meas_package.raw_measurements_ << px, py;
-      iss >> timestamp;
-      meas_package.timestamp_ = timestamp;
-      measurement_pack_list.push_back(meas_package);
-    } else if (sensor_type.compare("R") == 0) {
-      // radar measurement
-
-      // read measurements at this timestamp
-      meas_package.sensor_type_ = MeasurementPackage::RADAR;
-      meas_package.raw_measurements_ = VectorXd(3);
-      float ro;
-      float phi;
-      float ro_dot;
-      iss >> ro;
-      iss >> phi;
-      iss >> ro_dot;
-      meas_package.raw_measurements_ << ro, phi, ro_dot;
-      iss >> timestamp;
-      meas_package.timestamp_ = timestamp;
-      measurement_pack_list.push_back(meas_package);
-    }
-
-      // read ground truth data to compare later
-      float x_gt;
-      float y_gt;
-      float vx_gt;
-      float vy_gt;
-      iss >> x_gt;
-      iss >> y_gt;
-      iss >> vx_gt;
-      iss >> vy_gt;
-      gt_package.gt_values_ = VectorXd(4);
-      gt_package.gt_values_ << x_gt, y_gt, vx_gt, vy_gt;
-      gt_pack_list.push_back(gt_package);
-  }
+  // The log is streamed a line at a time into one package per sensor,
+  // allocated once here
+  MeasurementRecord record;
+  MeasurementPackage laser_package;
+  laser_package.sensor_type_ = MeasurementPackage::LASER;
+  laser_package.raw_measurements_ = VectorXd(2);
+  MeasurementPackage radar_package;
+  radar_package.sensor_type_ = MeasurementPackage::RADAR;
+  radar_package.raw_measurements_ = VectorXd(3);
+  Eigen::Vector4d gt_values;
 
   // Create a UKF instance
   UKF ukf;
 
-  // used to compute the RMSE later
-  vector<VectorXd> estimations;
-  vector<VectorXd> ground_truth;
+  // RMSE and NIS, accumulated as the estimates come
+  EstimationMetrics metrics;
 
   // start filtering from the second frame (the speed is unknown in the first
   // frame)
 
-  size_t number_of_measurements = measurement_pack_list.size();
+  while (in_file_.Next(record)) {
+    MeasurementPackage &meas_package =
+        record.sensor_type == MeasurementRecord::LASER ? laser_package : radar_package;
+    meas_package.timestamp_ = record.timestamp;
+    meas_package.raw_measurements_ = Eigen::Map<const VectorXd>(record.raw, record.size);
+    gt_values = Eigen::Map<const Eigen::Vector4d>(record.ground_truth);
 
-  // column names for output file
-  out_file_ << "time_stamp" << "\t";  
-  out_file_ << "px_state" << "\t";
-  out_file_ << "py_state" << "\t";
-  out_file_ << "v_state" << "\t";
-  out_file_ << "yaw_angle_state" << "\t";
-  out_file_ << "yaw_rate_state" << "\t";
-  out_file_ << "sensor_type" << "\t";
-  out_file_ << "NIS" << "\t";  
-  out_file_ << "px_measured" << "\t";
-  out_file_ << "py_measured" << "\t";
-  out_file_ << "px_ground_truth" << "\t";
-  out_file_ << "py_ground_truth" << "\t";
-  out_file_ << "vx_ground_truth" << "\t";
-  out_file_ << "vy_ground_truth" << "\n";
-
-
-  for (size_t k = 0; k < number_of_measurements; ++k) {
     // Call the UKF-based fusion
-    ukf.ProcessMeasurement(measurement_pack_list[k]);
+    ukf.ProcessMeasurement(meas_package);
+
+    ResultRecord row;
 
     // timestamp
-    out_file_ << measurement_pack_list[k].timestamp_ << "\t"; // pos1 - est
+    row.Add((long long)meas_package.timestamp_);
 
     // output the state vector
-    out_file_ << ukf.x_(0) << "\t"; // pos1 - est
-    out_file_ << ukf.x_(1) << "\t"; // pos2 - est
-    out_file_ << ukf.x_(2) << "\t"; // vel_abs -est
-    out_file_ << ukf.x_(3) << "\t"; // yaw_angle -est
-    out_file_ << ukf.x_(4) << "\t"; // yaw_rate -est
+    row.Add(ukf.x_(0)); // pos1 - est
+    row.Add(ukf.x_(1)); // pos2 - est
+    row.Add(ukf.x_(2)); // vel_abs -est
+    row.Add(ukf.x_(3)); // yaw_angle -est
+    row.Add(ukf.x_(4)); // yaw_rate -est
 
     // output lidar and radar specific data
-    if (measurement_pack_list[k].sensor_type_ == MeasurementPackage::LASER) {
+    if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
       // sensor type
-      out_file_ << "lidar" << "\t";
+      row.AddLabel("lidar");
 
       // NIS value
-      out_file_ << ukf.NIS_laser_ << "\t";
+      row.Add(ukf.NIS_laser_);
 
       // output the lidar sensor measurement px and py
-      out_file_ << measurement_pack_list[k].raw_measurements_(0) << "\t";
-      out_file_ << measurement_pack_list[k].raw_measurements_(1) << "\t";
+      row.Add(meas_package.raw_measurements_(0));
+      row.Add(meas_package.raw_measurements_(1));
 
-    } else if (measurement_pack_list[k].sensor_type_ == MeasurementPackage::RADAR) {
+    } else if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
       // sensor type
-      out_file_ << "radar" << "\t";
+      row.AddLabel("radar");
 
       // NIS value
-      out_file_ << ukf.NIS_radar_ << "\t";
+      row.Add(ukf.NIS_radar_);
 
       // output radar measurement in cartesian coordinates
-      float ro = measurement_pack_list[k].raw_measurements_(0);
-      float phi = measurement_pack_list[k].raw_measurements_(1);
-      out_file_ << ro * cos(phi) << "\t"; // px measurement
-      out_file_ << ro * sin(phi) << "\t"; // py measurement
+      float ro = meas_package.raw_measurements_(0);
+      float phi = meas_package.raw_measurements_(1);
+      row.Add(ro * cos(phi)); // px measurement
+      row.Add(ro * sin(phi)); // py measurement
     }
 
     // output the ground truth
-    out_file_ << gt_pack_list[k].gt_values_(0) << "\t";
-    out_file_ << gt_pack_list[k].gt_values_(1) << "\t";
-    out_file_ << gt_pack_list[k].gt_values_(2) << "\t";
-    out_file_ << gt_pack_list[k].gt_values_(3) << "\n";
+    row.Add(gt_values(0));
+    row.Add(gt_values(1));
+    row.Add(gt_values(2));
+    row.Add(gt_values(3));
+
+    out_file_.Push(row);
 
     // convert ukf x vector to cartesian to compare to ground truth
-    VectorXd ukf_x_cartesian_ = VectorXd(4);
+    Eigen::Vector4d ukf_x_cartesian_;
 
     float x_estimate_ = ukf.x_(0);
     float y_estimate_ = ukf.x_(1);
@@ -214,23 +175,29 @@ int main(int argc, char* argv[]) {
     
     ukf_x_cartesian_ << x_estimate_, y_estimate_, vx_estimate_, vy_estimate_;
     
-    estimations.push_back(ukf_x_cartesian_);
-    ground_truth.push_back(gt_pack_list[k].gt_values_);
+    // no NIS for the first measurement, which only initializes, or an
+    // update that couldn't be applied
+    if (ukf.updated_) {
+      metrics.AddNIS(record.sensor_type == MeasurementRecord::LASER ? ukf.NIS_laser_ : ukf.NIS_radar_,
+                     record.size);
+    }
+    metrics.Add(ukf_x_cartesian_, gt_values);
 
   }
 
-  // compute the accuracy (RMSE)
-  Tools tools;
-  cout << "RMSE" << endl << tools.CalculateRMSE(estimations, ground_truth) << endl;
+  if (in_file_.skipped()) {
+    cerr << "Skipped " << in_file_.skipped() << " unreadable lines of " << in_file_.lines() << endl;
+  }
+
+  // the accuracy (RMSE) and the consistency (NIS)
+  metrics.PrintSummary(cout);
 
   // close files
-  if (out_file_.is_open()) {
-    out_file_.close();
+  if (!out_file_.Close()) {
+    cerr << "Cannot write output file: " << out_file_name_ << endl;
   }
 
-  if (in_file_.is_open()) {
-    in_file_.close();
-  }
+  in_file_.Close();
 
   cout << "Done!" << endl;
   return 0;
@@ -0,0 +1,69 @@
+#include <math.h>
+#include <vector>
+#include "Eigen/Dense"
+#include "ukf.h"
+#include "estimation_metrics.h"
+#include "measurement_package.h"
+#include "measurement_reader.h"
+#include "parameter_sweep.h"
+
+using namespace std;
+using Eigen::VectorXd;
+
+/*
+ * Tunes the UKF's process noise, std_a_ and std_yawdd_, on one log.
+ *
+ *   ./noise_sweep path/to/input.txt grid|random|descent [n] [output.txt]
+ *
+ * See parameter_sweep.h in p6-Extended-Kalman-Filter. Every configuration
+ * replays the log like UnscentedKF does, so the one with the defaults has
+ * its RMSE and NIS.
+ */
+static void RunUKF(const vector<MeasurementRecord> &records, const double *values,
+                   EstimationMetrics &metrics) {
+
+  MeasurementPackage laser_package;
+  laser_package.sensor_type_ = MeasurementPackage::LASER;
+  laser_package.raw_measurements_ = VectorXd(2);
+  MeasurementPackage radar_package;
+  radar_package.sensor_type_ = MeasurementPackage::RADAR;
+  radar_package.raw_measurements_ = VectorXd(3);
+
+  UKF ukf;
+  ukf.std_a_ = values[0];
+  ukf.std_yawdd_ = values[1];
+
+  Eigen::Vector4d ukf_x_cartesian_;
+  for (size_t k = 0; k < records.size(); k++) {
+    const MeasurementRecord &record = records[k];
+    MeasurementPackage &meas_package =
+        record.sensor_type == MeasurementRecord::LASER ? laser_package : radar_package;
+    meas_package.timestamp_ = record.timestamp;
+    meas_package.raw_measurements_ = Eigen::Map<const VectorXd>(record.raw, record.size);
+
+    ukf.ProcessMeasurement(meas_package);
+
+    // in float, as UnscentedKF compares them
+    float x_estimate_ = ukf.x_(0);
+    float y_estimate_ = ukf.x_(1);
+    float vx_estimate_ = ukf.x_(2) * cos(ukf.x_(3));
+    float vy_estimate_ = ukf.x_(2) * sin(ukf.x_(3));
+    ukf_x_cartesian_ << x_estimate_, y_estimate_, vx_estimate_, vy_estimate_;
+
+    if (ukf.updated_) {
+      metrics.AddNIS(record.sensor_type == MeasurementRecord::LASER ? ukf.NIS_laser_ : ukf.NIS_radar_,
+                     record.size);
+    }
+    metrics.Add(ukf_x_cartesian_, Eigen::Map<const Eigen::Vector4d>(record.ground_truth));
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  vector<SweepParameter> parameters;
+  parameters.push_back({"std_a", .1, 6, 2});
+  parameters.push_back({"std_yawdd", .05, 3, .7});
+
+  ParameterSweep sweep(parameters, RunUKF);
+  return SweepMain(argc, argv, sweep);
+}
@@ -27,24 +27,12 @@ VectorXd Tools::CalculateRMSE(const vector<VectorXd> &estimations,
 		return rmse;
 	}
 
-	auto estimations_size = estimations.size();
-
-	// accumlate squared residuals
-	for(unsigned int i = 0;  i < estimations_size;  ++i){
-
-		VectorXd residual = estimations[i] - ground_truth[i];
-
-		// coefficient-wise multiplication
-		auto residual_array = residual.array();
-		residual = residual_array * residual_array;
-		rmse += residual;
+	// accumlate squared residuals, then mean and squared root
+	EstimationMetrics metrics(0);
+	for(unsigned int i = 0;  i < estimations.size();  ++i){
+		metrics.Add(estimations[i], ground_truth[i]);
 	}
-
-	// calculate mean
-	rmse = rmse / estimations_size;
-
-	// squared root
-	rmse = rmse.array().sqrt();
+	rmse = metrics.RMSE();
 
 	// returns result
 	return rmse;
@@ -2,6 +2,7 @@
 #define TOOLS_H_
 #include <vector>
 #include "Eigen/Dense"
+#include "estimation_metrics.h"
 
 class Tools {
 public:
@@ -16,7 +17,8 @@ public:
   virtual ~Tools();
 
   /**
-  * A helper method to calculate RMSE.
+  * A helper method to calculate RMSE. EstimationMetrics, from the EKF's
+  * src, gives it as the estimates come, without keeping them.
   */
   Eigen::VectorXd CalculateRMSE(const std::vector<Eigen::VectorXd> &estimations, const std::vector<Eigen::VectorXd> &ground_truth);
 
@@ -7,13 +7,25 @@
 #include <string>
 #include <fstream>
 #include "tools.h"
+#include "ctrv_models.h"
+#include "unscented_filter.h"
 
 using Eigen::MatrixXd;
 using Eigen::VectorXd;
 
-class UKF {
+/*
+ * The project's filter, UnscentedFilter instantiated with the CTRV, radar
+ * and lidar models of ctrv_models.h. The state x_, its covariance P_, the
+ * predicted sigma points Xsig_pred_, weights_ and lambda_ are the
+ * filter's.
+ */
+class UKF : public UnscentedFilter<CTRVModel, RadarModel, LidarModel> {
 public:
 
+  ///* measurement<kRadar>() and measurement<kLidar>()
+  static const int kRadar = 0;
+  static const int kLidar = 1;
+
   ///* initially set to false, set to true in first call of ProcessMeasurement
   bool is_initialized_;
 
@@ -23,19 +35,12 @@ public:
   ///* if this is false, radar measurements will be ignored (except for init)
   bool use_radar_;
 
-  ///* state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
-  VectorXd x_;
-
-  ///* state covariance matrix
-  MatrixXd P_;
-
-  ///* predicted sigma points matrix
-  MatrixXd Xsig_pred_;
-
   ///* time when the state is true, in us
   long long time_us_;
 
-  ///* Process noise standard deviation longitudinal acceleration in m/s^2
+  ///* Process noise standard deviation longitudinal acceleration in m/s^2.
+  ///* It and std_yawdd_ are handed to the process model at every
+  ///* prediction, so they may be set after construction (noise_sweep does)
   double std_a_;
 
   ///* Process noise standard deviation yaw acceleration in rad/s^2
@@ -56,17 +61,15 @@ public:
   ///* Radar measurement noise standard deviation radius change in m/s
   double std_radrd_ ;
 
-  ///* Weights of sigma points
-  VectorXd weights_;
-
   ///* State dimension
   int n_x_;
 
   ///* Augmented state dimension
   int n_aug_;
 
-  ///* Sigma point spreading parameter
-  double lambda_;
+  ///* whether the last measurement updated the state, and so set
+  ///* NIS_laser_ or NIS_radar_
+  bool updated_;
 
   ///* the current NIS for radar
   double NIS_radar_;
@@ -74,31 +77,10 @@ public:
   ///* the current NIS for laser
   double NIS_laser_;
 
-
-  VectorXd x_aug;
-
-  MatrixXd P_aug;
-
-  MatrixXd Xsig_aug;
-
-  MatrixXd Zsig;
-
-  VectorXd z_pred;
-
-  MatrixXd S;
-
-  VectorXd z;
-
-  MatrixXd Tc;
-
-  MatrixXd R_laser;
-
-  MatrixXd H_laser_;
-
-  VectorXd z_laser;
-
   long long previous_timestamp_;
 
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
 
   /**
    * Constructor
@@ -114,7 +96,7 @@ public:
    * ProcessMeasurement
    * @param meas_package The latest measurement data of either radar or laser
    */
-  void ProcessMeasurement(MeasurementPackage meas_package);
+  void ProcessMeasurement(const MeasurementPackage &meas_package);
 
   /**
    * Prediction Predicts sigma points, the state, and the state covariance
@@ -127,13 +109,13 @@ public:
    * Updates the state and the state covariance matrix using a laser measurement
    * @param meas_package The measurement at k+1
    */
-  void UpdateLidar(MeasurementPackage meas_package);
+  void UpdateLidar(const MeasurementPackage &meas_package);
 
   /**
    * Updates the state and the state covariance matrix using a radar measurement
    * @param meas_package The measurement at k+1
    */
-  void UpdateRadar(MeasurementPackage meas_package);
+  void UpdateRadar(const MeasurementPackage &meas_package);
 };
 
 #endif /* UKF_H */
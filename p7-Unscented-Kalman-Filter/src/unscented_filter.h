@@ -0,0 +1,236 @@
+#ifndef UNSCENTED_FILTER_H_
+#define UNSCENTED_FILTER_H_
+
+#include <math.h>
+#include <tuple>
+#include <type_traits>
+#include "Eigen/Dense"
+#include "kalman_update.h"
+
+/*
+ * An angle wrapped into [-pi, pi], what adding or subtracting 2 pi until it
+ * is gives, without a loop or a branch: the turns to take off are rounded
+ * to nearest by adding and subtracting 1.5 * 2^52.
+ */
+inline double NormalizeAngle(double angle) {
+  const double kRound = 6755399441055744.0;
+  const double turns = (angle / (2. * M_PI) + kRound) - kRound;
+  return angle - turns * (2. * M_PI);
+}
+
+/*
+ * NormalizeAngle() on row Row of sigma point lanes, or of a vector.
+ * Models with no angle say -1, which does nothing.
+ */
+template <int Row>
+struct AngleRow {
+  template <typename Matrix>
+  static void Normalize(Matrix &m) {
+    double * __restrict angle = &m(Row, 0);
+    const int stride = Matrix::IsRowMajor ? 1 : m.outerStride();
+    for (int i = 0;  i < m.cols();  i++) {
+      angle[i * stride] = NormalizeAngle(angle[i * stride]);
+    }
+  }
+};
+
+template <>
+struct AngleRow<-1> {
+  template <typename Matrix>
+  static void Normalize(Matrix &) {}
+};
+
+/*
+ * An unscented Kalman filter with every dimension known at compile time.
+ *
+ * The process model is a functor over sigma point lanes, see CTRVModel in
+ * ctrv_models.h:
+ *
+ *   static const int kNx;       // state dimension
+ *   static const int kNnoise;   // process noise dimension, augmented
+ *   static const int kAngle;    // state row that is an angle, or -1
+ *   Eigen::Matrix<double, kNnoise, 1> NoiseDeviations() const;
+ *   template <int Lanes>
+ *   void operator()(const Eigen::Matrix<double, kNx + kNnoise, Lanes, Eigen::RowMajor> &Xsig_aug,
+ *                   double delta_t,
+ *                   Eigen::Matrix<double, kNx, Lanes, Eigen::RowMajor> &Xsig_pred) const;
+ *
+ * Each measurement model, RadarModel or LidarModel there, has:
+ *
+ *   static const int kNz;       // measurement dimension
+ *   static const int kAngle;    // measurement row that is an angle, or -1
+ *   static const bool kLinear;
+ *   Eigen::Matrix<double, kNz, kNz> R;
+ *
+ * and either, if linear, H and the measurement is applied with
+ * KalmanUpdate(), or a functor taking the predicted sigma points to
+ * measurement space, lane by lane, and it goes through UnscentedUpdate():
+ *
+ *   Eigen::Matrix<double, kNz, kNx> H;
+ *   template <int Lanes>
+ *   void operator()(const Eigen::Matrix<double, kNx, Lanes, Eigen::RowMajor> &Xsig,
+ *                   Eigen::Matrix<double, kNz, Lanes, Eigen::RowMajor> &Zsig) const;
+ *
+ * The models are held by value and reached with process() and
+ * measurement<I>(), I the model's place in MeasurementModels. Adding a
+ * sensor is adding a model to the list: Update<I>() is instantiated for
+ * it with its sizes, nothing is sized or copied at run time.
+ */
+template <class ProcessModel, class... MeasurementModels>
+class UnscentedFilter {
+public:
+
+  static const int kNx = ProcessModel::kNx;
+  static const int kNaug = ProcessModel::kNx + ProcessModel::kNnoise;
+  static const int kNsig = 2 * kNaug + 1;
+
+  // a row per dimension and a column (lane) per sigma point, row major
+  template <int Rows>
+  using SigmaPoints = Eigen::Matrix<double, Rows, kNsig, Eigen::RowMajor>;
+
+  template <int I>
+  using Measurement = typename std::tuple_element<I, std::tuple<MeasurementModels...> >::type;
+
+  ///* state vector and covariance matrix
+  Eigen::Matrix<double, kNx, 1> x_;
+  Eigen::Matrix<double, kNx, kNx> P_;
+
+  ///* predicted sigma points
+  SigmaPoints<kNx> Xsig_pred_;
+
+  ///* weights of sigma points and the spreading parameter
+  Eigen::Matrix<double, kNsig, 1> weights_;
+  double lambda_;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * Constructor.
+   * @param lambda Sigma point spreading parameter
+   */
+  explicit UnscentedFilter(double lambda = 3 - kNx) : lambda_(lambda) {
+    x_.setZero();
+    P_.setIdentity();
+    Xsig_pred_.setZero();
+
+    double lambda_n_aug = lambda_ + kNaug;
+    weights_.fill(.5 / lambda_n_aug);
+    weights_(0) = lambda_ / lambda_n_aug;
+  }
+
+  ProcessModel &process() { return process_; }
+
+  template <int I>
+  Measurement<I> &measurement() { return std::get<I>(measurements_); }
+
+  /**
+   * Predicts sigma points, the state, and the state covariance matrix
+   * @param delta_t Time between k and k+1 in s
+   */
+  void Predict(double delta_t) {
+
+    // The augmented covariance is block diagonal, P_ and the process
+    // noise variances, so its square root is P_'s and the deviations
+    Eigen::Matrix<double, kNaug, kNaug> L;
+    L.setZero();
+    L.template topLeftCorner<kNx, kNx>() = P_.llt().matrixL();
+    L.template bottomRightCorner<ProcessModel::kNnoise, ProcessModel::kNnoise>().diagonal() =
+        process_.NoiseDeviations();
+
+    Eigen::Matrix<double, kNaug, 1> x_aug;
+    x_aug.template head<kNx>() = x_;
+    x_aug.template tail<ProcessModel::kNnoise>().setZero();
+
+    const double spread = sqrt(lambda_ + kNaug);
+    SigmaPoints<kNaug> Xsig_aug;
+    Xsig_aug.col(0) = x_aug;
+    Xsig_aug.template block<kNaug, kNaug>(0, 1) = (spread * L).colwise() + x_aug;
+    Xsig_aug.template block<kNaug, kNaug>(0, 1 + kNaug) = (-spread * L).colwise() + x_aug;
+
+    process_(Xsig_aug, delta_t, Xsig_pred_);
+
+    // mean, and covariance from the differences with normalized angles
+    x_ = Xsig_pred_ * weights_;
+
+    SigmaPoints<kNx> x_diff = Xsig_pred_.colwise() - x_;
+    AngleRow<ProcessModel::kAngle>::Normalize(x_diff);
+
+    P_ = (x_diff.array().rowwise() * weights_.transpose().array()).matrix() * x_diff.transpose();
+  }
+
+  /**
+   * Updates the state and the state covariance matrix with a measurement
+   * of model I
+   * @param nis Set to the update's NIS
+   * @return false if the innovation covariance can't be inverted, the
+   * state is left as it was
+   */
+  template <int I>
+  bool Update(const Eigen::Matrix<double, Measurement<I>::kNz, 1> &z, double &nis) {
+    return Update(std::get<I>(measurements_), z, nis,
+                  std::integral_constant<bool, Measurement<I>::kLinear>());
+  }
+
+protected:
+
+  ProcessModel process_;
+  std::tuple<MeasurementModels...> measurements_;
+
+private:
+
+  // a linear model, H and R
+  template <class Model>
+  bool Update(const Model &model, const Eigen::Matrix<double, Model::kNz, 1> &z, double &nis,
+              std::true_type) {
+    Eigen::Matrix<double, Model::kNz, 1> y = z - model.H * x_;
+    AngleRow<Model::kAngle>::Normalize(y);
+
+    // gain, new estimate (Joseph form) and NIS in one pass
+    KalmanGain<kNx, Model::kNz> gain;
+    if (!KalmanUpdate<kNx, Model::kNz>(x_, P_, y, model.H, model.R, gain)) {
+      return false;
+    }
+    nis = gain.nis;
+    return true;
+  }
+
+  // a nonlinear model, through the predicted sigma points
+  template <class Model>
+  bool Update(const Model &model, const Eigen::Matrix<double, Model::kNz, 1> &z, double &nis,
+              std::false_type) {
+    const int kNz = Model::kNz;
+
+    SigmaPoints<kNz> Zsig;
+    model(Xsig_pred_, Zsig);
+
+    //calculate mean predicted measurement
+    const Eigen::Matrix<double, kNz, 1> z_pred = Zsig * weights_;
+
+    // residuals, angles normalized
+    SigmaPoints<kNz> z_diff_sig = Zsig.colwise() - z_pred;
+    AngleRow<Model::kAngle>::Normalize(z_diff_sig);
+    SigmaPoints<kNx> x_diff = Xsig_pred_.colwise() - x_;
+    AngleRow<ProcessModel::kAngle>::Normalize(x_diff);
+
+    // weighted residuals, shared by S and the cross correlation
+    const SigmaPoints<kNz> z_diff_weighted =
+        (z_diff_sig.array().rowwise() * weights_.transpose().array()).matrix();
+
+    const Eigen::Matrix<double, kNz, kNz> S = z_diff_weighted * z_diff_sig.transpose() + model.R;
+    const Eigen::Matrix<double, kNx, kNz> Tc = x_diff * z_diff_weighted.transpose();
+
+    Eigen::Matrix<double, kNz, 1> z_diff = z - z_pred;
+    AngleRow<Model::kAngle>::Normalize(z_diff);
+
+    // Kalman gain, state mean and covariance matrix update and NIS, all
+    // from one factorization of S
+    KalmanGain<kNx, kNz> gain;
+    if (!UnscentedUpdate<kNx, kNz>(x_, P_, z_diff, Tc, S, gain)) {
+      return false;
+    }
+    nis = gain.nis;
+    return true;
+  }
+};
+
+#endif /* UNSCENTED_FILTER_H_ */
@@ -1,6 +1,8 @@
 #include <iostream>
 #include "Dense"
 #include <vector>
+// from p6-Extended-Kalman-Filter/src, on the include path like Dense
+#include "estimation_metrics.h"
 
 using namespace std;
 using Eigen::MatrixXd;
@@ -38,6 +40,16 @@ int main() {
 	//call the CalculateRMSE and print out the result
 	cout << CalculateRMSE(estimations, ground_truth) << endl;
 
+	//the same as the estimates come, nothing kept, and over two halves
+	//accumulated apart then merged, like parallel runs would be
+	EstimationMetrics first_half, second_half;
+	for(unsigned int i=0; i < estimations.size(); ++i){
+		EstimationMetrics &half = i < estimations.size() / 2 ? first_half : second_half;
+		half.Add(estimations[i], ground_truth[i]);
+	}
+	first_half.Merge(second_half);
+	cout << first_half.RMSE() << endl;
+
 
 	return 0;
 }
@@ -57,21 +69,12 @@ VectorXd CalculateRMSE(const vector<VectorXd> &estimations,
 		return rmse;
 	}
 
-	//accumulate squared residuals
+	//accumulate squared residuals, then the mean and the squared root
+	EstimationMetrics metrics(0);
 	for(unsigned int i=0; i < estimations.size(); ++i){
-
-		VectorXd residual = estimations[i] - ground_truth[i];
-
-		//coefficient-wise multiplication
-		residual = residual.array()*residual.array();
-		rmse += residual;
+		metrics.Add(estimations[i], ground_truth[i]);
 	}
-
-	//calculate the mean
-	rmse = rmse/estimations.size();
-
-	//calculate the squared root
-	rmse = rmse.array().sqrt();
+	rmse = metrics.RMSE();
 
 	//return the result
 	return rmse;
@@ -1,5 +1,8 @@
 #include "kalman_filter.h"
 
+//shared with the EKF, needs p6-Extended-Kalman-Filter/src on the include path
+#include "kalman_update.h"
+
 KalmanFilter::KalmanFilter() {
 }
 
@@ -14,17 +17,18 @@ void KalmanFilter::Predict() {
 
 void KalmanFilter::Update(const VectorXd &z) {
 	VectorXd z_pred = H_ * x_;
-	VectorXd y = z - z_pred;
-	MatrixXd Ht = H_.transpose();
-	MatrixXd S = H_ * P_ * Ht + R_;
-	MatrixXd Si = S.inverse();
-	MatrixXd PHt = P_ * Ht;
-	MatrixXd K = PHt * Si;
+	Eigen::Vector2d y = z - z_pred;
 
-	//new estimate
-	x_ = x_ + (K * y);
-	long x_size = x_.size();
-	MatrixXd I = MatrixXd::Identity(x_size, x_size);
-	P_ = (I - K * H_) * P_;
+	//gain without S.inverse() and the new estimate, P_ in Joseph form.
+	//The kernel takes fixed size types.
+	Eigen::Vector4d x = x_;
+	Eigen::Matrix4d P = P_;
+	const Eigen::Matrix<double, 2, 4> H = H_;
+	const Eigen::Matrix2d R = R_;
+	KalmanGain<4, 2> gain;
+	if (KalmanUpdate<4, 2>(x, P, y, H, R, gain)) {
+		x_ = x;
+		P_ = P;
+	}
 }
 
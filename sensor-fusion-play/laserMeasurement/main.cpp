@@ -1,9 +1,8 @@
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <vector>
 #include "Dense"
 #include "measurement_package.h"
+#include "measurement_reader.h"
 #include "tracking.h"
 
 using namespace std;
@@ -19,39 +18,33 @@ int main() {
 	 *******************************************************************************/
 	vector<MeasurementPackage> measurement_pack_list;
 
-	// hardcoded input file with laser and radar measurements
+	// hardcoded input file with laser and radar measurements, the text log
+	// or one converted by p6's log_convert (measurement_reader.h, like
+	// kalman_update.h, comes from p6-Extended-Kalman-Filter/src)
 	string in_file_name_ = "obj_pose-laser-radar-synthetic-input.txt";
-	ifstream in_file(in_file_name_.c_str(),std::ifstream::in);
+	MeasurementReader in_file;
+	in_file.Open(in_file_name_);
 
 	if (!in_file.is_open()) {
 		cout << "Cannot open input file: " << in_file_name_ << endl;
 	}
 
-	string line;
+	MeasurementRecord record;
 	// set i to get only first 3 measurments
 	int i = 0;
-	while(getline(in_file, line) && (i<=3)){
+	while(i<=3 && in_file.Next(record)){
 
 		MeasurementPackage meas_package;
 
-		istringstream iss(line);
-		string sensor_type;
-		iss >> sensor_type;	//reads first element from the current line
-		long timestamp;
-		if(sensor_type.compare("L") == 0){	//laser measurement
+		if(record.sensor_type == MeasurementRecord::LASER){	//laser measurement
 			//read measurements
 			meas_package.sensor_type_ = MeasurementPackage::LASER;
 			meas_package.raw_measurements_ = VectorXd(2);
-			float x;
-			float y;
-			iss >> x;
-			iss >> y;
-			meas_package.raw_measurements_ << x,y;
-			iss >> timestamp;
-			meas_package.timestamp_ = timestamp;
+			meas_package.raw_measurements_ << record.raw[0], record.raw[1];
+			meas_package.timestamp_ = record.timestamp;
 			measurement_pack_list.push_back(meas_package);
 
-		}else if(sensor_type.compare("R") == 0){
+		}else if(record.sensor_type == MeasurementRecord::RADAR){
 			//Skip Radar measurements
 			continue;
 		}
@@ -69,8 +62,6 @@ int main() {
 		
 	}
 
-	if(in_file.is_open()){
-		in_file.close();
-	}
+	in_file.Close();
 	return 0;
 }